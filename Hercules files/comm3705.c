@@ -14,6 +14,23 @@
 /*                                                                 */
 /*  This coding is such, that it is (should be) independent from   */
 /* the Hercules version (as well as Linux as Windows).             */
+/*                                                                 */
+/* On Linux the bus and tag connections can instead use a shared   */
+/* memory segment created by the 3705 simulator (SHM=name, with    */
+/* SET CAn TRANSPORT=SHM:name on the 3705 side).  This needs       */
+/* i3705_shm.h from the simulator next to this file.               */
+/*                                                                 */
+/* READ data is preceded by a 2 byte length, so a READ needs a     */
+/* 3705 simulator that sends it (and vice versa).                  */
+/*                                                                 */
+/* With SET CAn FAILOVER=msec the 3705 sends a heartbeat byte X'FF'*/
+/* on the tag connection; it is echoed and never presented as an   */
+/* attention.  A hot standby Hercules on the other (B) port takes  */
+/* over when the active one stops answering.                       */
+/*                                                                 */
+/* SNDBUF=bytes, RCVBUF=bytes and BUSYPOLL=usec set SO_SNDBUF,     */
+/* SO_RCVBUF and SO_BUSY_POLL on the bus and tag sockets, as       */
+/* SET CA SNDBUF/RCVBUF/BUSYPOLL do on the 3705 side (0 = default).*/
 /*******************************************************************/
 
 #include "hstdinc.h"
@@ -23,6 +40,16 @@
 #include "parser.h"
 #include "stdbool.h"
 
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "i3705_shm.h"
+#endif
+
+/* Pseudo socket numbers for the shared memory bus and tag rings     */
+#define SHM_BUSFD 0x40000000
+#define SHM_TAGFD 0x40000001
+
 #if defined(WIN32) && defined(OPTION_DYNAMIC_LOAD) && !defined(HDL_USE_LIBTOOL) && !defined(_MSVC_)
   SYSBLK *psysblk;
   #define sysblk (*psysblk)
@@ -33,6 +60,7 @@
 #endif
 
 #define BUFPD 0x1C
+#define TAG_HBEAT 0xFF                  /* Tag heartbeat from the 3705 */
 
 static BYTE commadpt_immed_command[256]=
 { 0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,
@@ -60,6 +88,10 @@ static PARSER ptab[] = {
     {"adaptip", "%s"},
     {"debug",   "%s"},
     {"tracesna", "%s"},
+    {"shm",     "%s"},
+    {"sndbuf",  "%s"},
+    {"rcvbuf",  "%s"},
+    {"busypoll", "%s"},
     {NULL, NULL}
 };
 
@@ -68,7 +100,11 @@ enum {
   COMMADPT_KW_PORT = 1,
     COMMADPT_KW_ADAPTIP,
     COMMADPT_KW_DEBUG,
-    COMMADPT_KW_TRACESNA
+    COMMADPT_KW_TRACESNA,
+    COMMADPT_KW_SHM,
+    COMMADPT_KW_SNDBUF,
+    COMMADPT_KW_RCVBUF,
+    COMMADPT_KW_BUSYPOLL
 } comm3705_kw;
 
 struct COMMADPT
@@ -88,6 +124,11 @@ struct COMMADPT
     int pipe[2];                /* pipe used for I/O to thread signaling    */
     U16  devnum;                /* devnum copy from DEVBLK                  */
     struct sockaddr_in servaddr;
+    char shmname[64];           /* Shared memory segment, "" = TCP          */
+    struct SHM_CHAN *shm;       /* Attached shared memory segment           */
+    int sndbuf;                 /* SO_SNDBUF bytes, 0 = system default      */
+    int rcvbuf;                 /* SO_RCVBUF bytes, 0 = system default      */
+    int busypoll;               /* SO_BUSY_POLL usec, 0 = off               */
 
     U32 have_cthread:1;         /* the comm thread is running               */
     U32 attn_run;               /* the ATTN thread is running               */
@@ -183,6 +224,122 @@ static bool IsSocketConnected(int sockfd, U16 ssid, U16 devnum)
    return true;
 }
 
+// ********************************************************************
+// Bus/tag I/O on a TCP socket or on the shared memory rings
+// ********************************************************************
+static int adpt_send(COMMADPT *ca, int sockfd, void *buf, int len)
+{
+#if defined(__linux__)
+   if (ca->shm != NULL && (sockfd == SHM_BUSFD || sockfd == SHM_TAGFD))
+      return shm_send(&ca->shm->ring[(sockfd == SHM_TAGFD) ? SHM_TAG_H2C : SHM_BUS_H2C],
+                      buf, len, &ca->shm->ccu_up);
+#endif
+   return send(sockfd, buf, len, 0);
+}
+
+static int adpt_recv(COMMADPT *ca, int sockfd, void *buf, int len)
+{
+#if defined(__linux__)
+   if (ca->shm != NULL && (sockfd == SHM_BUSFD || sockfd == SHM_TAGFD))
+      return shm_recv(&ca->shm->ring[(sockfd == SHM_TAGFD) ? SHM_TAG_C2H : SHM_BUS_C2H],
+                      buf, len, &ca->shm->ccu_up);
+#endif
+   return recv(sockfd, buf, len, 0);
+}
+
+static bool adpt_connected(COMMADPT *ca, int sockfd)
+{
+#if defined(__linux__)
+   if (ca->shm != NULL && (sockfd == SHM_BUSFD || sockfd == SHM_TAGFD))
+      return ca->shm->ccu_up && ca->shm->host_up;
+#endif
+   return IsSocketConnected(sockfd, ca->dev->ssid, ca->dev->devnum);
+}
+
+// ********************************************************************
+// Function to attach to the shared memory segment of the 3705 CA
+// ********************************************************************
+static int shm_attach(COMMADPT *ca) {
+#if defined(__linux__)
+   struct SHM_CHAN *ch;
+   struct stat st;
+   char name[80];
+   char cua[2];
+   int fd;
+
+   snprintf(name, sizeof(name), "%s%s", (ca->shmname[0] != '/') ? "/" : "", ca->shmname);
+   logmsg("ADX00019I %1d:%04X: Waiting for shared memory %s to be created\n", ca->dev->ssid, ca->dev->devnum, name);
+   while ((fd = shm_open(name, O_RDWR, 0)) < 0) {
+      if (ca->attn_halt)
+         return(-1);
+      sleep(1);
+   }
+   if (fstat(fd, &st) != 0 || st.st_size != sizeof(struct SHM_CHAN)) {
+      logmsg("ADX00002E %1d:%04X: shared memory %s has the wrong size\n", ca->dev->ssid, ca->dev->devnum, name);
+      close(fd);
+      return(-1);
+   }
+   ch = mmap(NULL, sizeof(struct SHM_CHAN), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   close(fd);
+   if (ch == MAP_FAILED) {
+      logmsg("ADX00002E %1d:%04X: shared memory mmap failed: %s\n", ca->dev->ssid, ca->dev->devnum, strerror(errno));
+      return(-1);
+   }
+   // Wait for the 3705 side to initialise the segment
+   while (ch->magic != SHM_MAGIC || !__atomic_load_n(&ch->ccu_up, __ATOMIC_ACQUIRE)) {
+      if (ca->attn_halt) {
+         munmap(ch, sizeof(struct SHM_CHAN));
+         return(-1);
+      }
+      sleep(1);
+   }
+   if (ch->version != SHM_VERSION) {
+      logmsg("ADX00002E %1d:%04X: shared memory version %d, expected %d\n", ca->dev->ssid, ca->dev->devnum, ch->version, SHM_VERSION);
+      munmap(ch, sizeof(struct SHM_CHAN));
+      return(-1);
+   }
+   shm_reset(ch);
+   __atomic_add_fetch(&ch->host_gen, 1, __ATOMIC_RELEASE);
+   __atomic_store_n(&ch->host_up, 1, __ATOMIC_RELEASE);
+   ca->shm = ch;
+   ca->busfd = SHM_BUSFD;
+   ca->tagfd = SHM_TAGFD;
+
+   cua[0] = (ca->devnum & 0x0000FF00) >> 8;
+   cua[1] = (ca->devnum & 0x000000FF);
+   adpt_send(ca, ca->busfd, cua, 2);
+   logmsg("ADX00003I %1d:%04X: bus and tag connection established on shared memory %s\n", ca->dev->ssid, ca->dev->devnum, name);
+   return(0);
+#else
+   logmsg("ADX00002E %1d:%04X: shared memory transport is only supported on Linux\n", ca->dev->ssid, ca->dev->devnum);
+   return(-1);
+#endif
+}
+
+// ********************************************************************
+// Function to tune a bus or tag socket: the channel protocol is lock-
+// step with 1 byte acks, Nagle plus delayed ack would stall each CCW.
+// Same options as sock_tune() (i3705_sock.h) on the 3705 side, the
+// buffer sizes and busy poll come from the sndbuf=, rcvbuf= and
+// busypoll= device statement keywords (0 = system default / off).
+// ********************************************************************
+static void tune_adpt(COMMADPT *ca, int sockfd) {
+   int on = 1;
+
+   setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (void *)&on, sizeof(on));
+#if defined(TCP_QUICKACK)
+   setsockopt(sockfd, IPPROTO_TCP, TCP_QUICKACK, (void *)&on, sizeof(on));
+#endif
+   if (ca->sndbuf)
+      setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, (void *)&ca->sndbuf, sizeof(int));
+   if (ca->rcvbuf)
+      setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, (void *)&ca->rcvbuf, sizeof(int));
+#if defined(SO_BUSY_POLL)
+   if (ca->busypoll)
+      setsockopt(sockfd, SOL_SOCKET, SO_BUSY_POLL, (void *)&ca->busypoll, sizeof(int));
+#endif
+}
+
 // ********************************************************************
 // Function to enable TCP socket and connect to Remote channel adapter
 // ********************************************************************
@@ -191,6 +348,9 @@ static int connect_adpt(COMMADPT *ca) {
   int rc;
   char cua[2];
 
+  if (ca->shmname[0] != 0)
+     return shm_attach(ca);
+
   // Bus socket creation
   ca->busfd = socket(AF_INET, SOCK_STREAM, 0);
    if (ca->busfd <= 0 ) {
@@ -204,6 +364,8 @@ static int connect_adpt(COMMADPT *ca) {
      logmsg("ADX00002E %1d:%04X: tag socket creation failed\n", ca->dev->ssid, ca->dev->devnum);
      return(-1);
   }
+  tune_adpt(ca, ca->busfd);
+  tune_adpt(ca, ca->tagfd);
 
 #ifdef WIN32
    u_long bmode = 0;     // Socket read blocking mode flag
@@ -263,6 +425,21 @@ static int connect_adpt(COMMADPT *ca) {
 // Function to close the bus and tag TCP sockets
 // ********************************************************************
 static void close_adpt(COMMADPT *ca) {
+#if defined(__linux__)
+   int i;
+
+   if (ca->shm != NULL) {
+      __atomic_store_n(&ca->shm->host_up, 0, __ATOMIC_RELEASE);
+      for (i = 0; i < 4; i++)
+         shm_bell(&ca->shm->ring[i]);
+      munmap(ca->shm, sizeof(struct SHM_CHAN));
+      ca->shm = NULL;
+      ca->busfd = -1;
+      ca->tagfd = -1;
+      logmsg("ADX000016I %1d:%04X: shared memory bus and tag connection closed\n",  ca->dev->ssid, ca->dev->devnum);
+      return;
+   }
+#endif
 
    // Bus socket close
    if (ca->busfd > 0) {
@@ -283,12 +460,12 @@ static void close_adpt(COMMADPT *ca) {
 /* Subroutine to send ack to remote channel adapter                  */
 /*-------------------------------------------------------------------*/
 static void
-send_ack(int sockfd, U16 ssid, U16 devnum, U32 debug) {
+send_ack(COMMADPT *ca, int sockfd, U16 ssid, U16 devnum, U32 debug) {
    int rc;                              /* Return code               */
    uint8_t ackbuf = 0x8F;
 
    if (sockfd > 0) {
-      rc = send (sockfd, &ackbuf, 1, 0);
+      rc = adpt_send(ca, sockfd, &ackbuf, 1);
       if (debug)
          logmsg("ADX00004I %1d:%04X: send ack(%d) completed with rc=%d \n", ssid, devnum, sockfd, rc);
   }
@@ -303,11 +480,11 @@ send_ack(int sockfd, U16 ssid, U16 devnum, U32 debug) {
 /* Subroutine to receive ack from remote channel adapter             */
 /*-------------------------------------------------------------------*/
 static void
-recv_ack(int sockfd, U16 ssid, U16 devnum, U32 debug) {
+recv_ack(COMMADPT *ca, int sockfd, U16 ssid, U16 devnum, U32 debug) {
    int rc;                              /* Return code               */
    uint8_t ackbuf;
    if (sockfd > 0) {
-      rc = recv(sockfd, &ackbuf, 1, 0);
+      rc = adpt_recv(ca, sockfd, &ackbuf, 1);
       if (debug)
          logmsg("ADX00004I %1d:%04X: recv ack(%d) completed with rc=%d \n", ssid, devnum, sockfd, rc);
    }
@@ -328,7 +505,7 @@ write_adpt(BYTE *bufferp, int len, COMMADPT *ca) {
    int rc;                              /* Return code               */
 
    if (ca->busfd > 0) {
-      rc = send (ca->busfd, bufferp, len, 0);
+      rc = adpt_send(ca, ca->busfd, bufferp, len);
       if (ca->debug)
          logmsg("ADX00004I %1d:%04X: write adpt(%d) completed. Bytes sent: %d \n", ca->dev->ssid, ca->dev->devnum, ca->busfd, rc);
   }
@@ -349,7 +526,7 @@ read_adpt(BYTE *bufferp, COMMADPT *ca) {
    int rc;                              /* Return code               */
 
    if (ca->busfd > 0)
-      rc = recv(ca->busfd, bufferp, sizeof(bufferp), 0);
+      rc = adpt_recv(ca, ca->busfd, bufferp, sizeof(bufferp));
    else
       rc = -1;
 
@@ -360,6 +537,49 @@ read_adpt(BYTE *bufferp, COMMADPT *ca) {
    return rc;
 }  /* End function read_adpt */
 
+/*-------------------------------------------------------------------*/
+/* Subroutine to read the data of a READ CCW: a 2 byte length        */
+/* followed by that many bytes, which may arrive in pieces.  More    */
+/* than max bytes: max are kept, the rest is read and dropped so the */
+/* next READ stays in step, and *over is set.  Returns the bytes     */
+/* kept, -1 when the bus connection fails.                           */
+/*-------------------------------------------------------------------*/
+static int
+read_block(BYTE *bufferp, int max, COMMADPT *ca, int *over) {
+   BYTE hdr[2];                         /* Data length               */
+   BYTE scrap[256];                     /* Data beyond max           */
+   int len, got, rc, n;
+
+   *over = 0;
+   for (got = 0; got < 2; got += rc) {
+      rc = adpt_recv(ca, ca->busfd, hdr + got, 2 - got);
+      if (rc <= 0)
+         goto error;
+   }
+   len = (hdr[0] << 8) | hdr[1];
+   n = len;
+   if (len > max) {
+      logmsg("ADX00004E %1d:%04X: read_block() %d bytes for a %d byte READ\n", ca->dev->ssid, ca->dev->devnum, len, max);
+      *over = 1;
+      n = max;
+   }
+   for (got = 0; got < n; got += rc) {
+      rc = adpt_recv(ca, ca->busfd, bufferp + got, n - got);
+      if (rc <= 0)
+         goto error;
+   }
+   for (got = n; got < len; got += rc) {
+      rc = adpt_recv(ca, ca->busfd, scrap, (len - got < (int) sizeof(scrap)) ? len - got : (int) sizeof(scrap));
+      if (rc <= 0)
+         goto error;
+   }
+   return n;
+
+error:
+   logmsg("ADX00004E %1d:%04X: read_block() %s\n", ca->dev->ssid, ca->dev->devnum, strerror(HSO_errno));
+   return -1;
+}  /* End function read_block */
+
 char EBCDIC2ASCII (char s) {
    static char etoa[] =
         "................................"
@@ -570,7 +790,7 @@ static void *ATTN_adpt(void *vca) {
    ca = (COMMADPT*)vca;
    ca->dev->commadpt->attn_run = 1;
 
-   while ((!IsSocketConnected(ca->busfd, ca->dev->ssid, ca->dev->devnum)) && !ca->dev->commadpt->attn_halt) {
+   while ((!adpt_connected(ca, ca->busfd)) && !ca->dev->commadpt->attn_halt) {
       if (ca->dev->commadpt->debug)
          logmsg("ADX00002D %1d:%04X: Preparing connection with remote channel adapter\n", ca->dev->ssid, ca->dev->devnum);
 
@@ -584,10 +804,15 @@ static void *ATTN_adpt(void *vca) {
          ca->dev->scsw.unitstat |= CSW_UC;    // Signal unit check
       }
 
-      while ((IsSocketConnected(ca->tagfd, ca->dev->ssid, ca->dev->devnum)) && !ca->dev->commadpt->attn_halt) {
+      while ((adpt_connected(ca, ca->tagfd)) && !ca->dev->commadpt->attn_halt) {
          // Wait for Channel Adapter status byte
-         rc = recv(ca->tagfd, &ca->carnstat, 1, 0);
+         rc = adpt_recv(ca, ca->tagfd, &ca->carnstat, 1);
 
+         if (rc > 0 && ca->carnstat == TAG_HBEAT) {
+            // Heartbeat of a 3705 with FAILOVER set: just echo it
+            adpt_send(ca, ca->tagfd, &ca->carnstat, 1);
+            continue;
+         }
          if (rc > 0) {
             if (ca->dev->commadpt->debug)
                logmsg("ADX00002D %1d:%04X: Status received %d\n", ca->dev->ssid, ca->dev->devnum, ca->carnstat);
@@ -610,7 +835,7 @@ static void *ATTN_adpt(void *vca) {
                // Acknowledge attention received to the remote channel adapter
                if (ca->tagfd > 0) {
                   ackbuf = 0x8F;            // Indicate ATTN processed
-                  rc = send (ca->tagfd, &ackbuf, 1, 0);
+                  rc = adpt_send(ca, ca->tagfd, &ackbuf, 1);
                   if (ca->dev->commadpt->debug)
                      logmsg("ADX00009D %1d:%04X: ACK send %02X, rc = %d\n", ca->dev->ssid, ca->dev->devnum, ackbuf, rc);
                }
@@ -626,7 +851,7 @@ static void *ATTN_adpt(void *vca) {
                   logmsg("ADX00002D %1d:%04X: Lock held, cancel ATTN\n", ca->dev->ssid, ca->dev->devnum);
                if (ca->tagfd > 0) {
                   ackbuf = 0xF8;   // Indicate ATTN cancelled
-                  rc = send (ca->tagfd, &ackbuf, 1, 0);
+                  rc = adpt_send(ca, ca->tagfd, &ackbuf, 1);
                   if (ca->dev->commadpt->debug)
                      logmsg("ADX00009D %1d:%04X: ACK cancelled %02X, rc = %d\n", ca->dev->ssid, ca->dev->devnum, ackbuf, rc);
                }
@@ -729,6 +954,11 @@ static int commadpt_init_handler (DEVBLK *dev, int argc, char *argv[]) {
    dev->commadpt->busfd = -1;
    dev->commadpt->tagfd = -1;
    dev->commadpt->port = 0;
+   dev->commadpt->shmname[0] = 0;
+   dev->commadpt->shm = NULL;
+   dev->commadpt->sndbuf = 0;
+   dev->commadpt->rcvbuf = 0;
+   dev->commadpt->busypoll = 0;
 
    for (i = 0; i < argc; i++) {
       pc = parser(ptab, argv[i], &res);
@@ -769,6 +999,33 @@ static int commadpt_init_handler (DEVBLK *dev, int argc, char *argv[]) {
             dev->commadpt->port = rc;
             break;
 
+         case COMMADPT_KW_SHM:
+            if (strlen(res.text) == 0 || strlen(res.text) >= sizeof(dev->commadpt->shmname)) {
+               msg013e(dev, "SHM", res.text);
+               errcnt++;
+               break;
+            }
+            strcpy(dev->commadpt->shmname, res.text);
+            break;
+
+         case COMMADPT_KW_SNDBUF:
+         case COMMADPT_KW_RCVBUF:
+         case COMMADPT_KW_BUSYPOLL:
+            rc = atoi(res.text);
+            if (rc < 0 || rc > ((pc == COMMADPT_KW_BUSYPOLL) ? 1000000 : 64 * 1024 * 1024)) {
+               msg013e(dev, (pc == COMMADPT_KW_SNDBUF) ? "SNDBUF" :
+                            (pc == COMMADPT_KW_RCVBUF) ? "RCVBUF" : "BUSYPOLL", res.text);
+               errcnt++;
+               break;
+            }
+            if (pc == COMMADPT_KW_SNDBUF)
+               dev->commadpt->sndbuf = rc;
+            else if (pc == COMMADPT_KW_RCVBUF)
+               dev->commadpt->rcvbuf = rc;
+            else
+               dev->commadpt->busypoll = rc;
+            break;
+
          case COMMADPT_KW_ADAPTIP:
             if (strcmp(res.text, "*") == 0) {
                dev->commadpt->adaptip = INADDR_ANY;
@@ -900,6 +1157,7 @@ static void commadpt_execute_ccw (DEVBLK *dev, BYTE code, BYTE flags,
    U32 num;    /* Work : Actual CCW transfer count                   */
    char    buf[80];
    int     rc;
+   int     over;   /* READ data longer than the CCW count            */
 
    struct CCW {
       BYTE code;
@@ -926,7 +1184,7 @@ static void commadpt_execute_ccw (DEVBLK *dev, BYTE code, BYTE flags,
 
    *residual = 0;
 
-   if (IsSocketConnected(dev->commadpt->busfd, dev->ssid, dev->devnum)) {
+   if (adpt_connected(dev->commadpt, dev->commadpt->busfd)) {
       /* Obtain the COMMADPT lock */
       obtain_lock(&dev->commadpt->lock);
       dev->commadpt->ccwactive = 0x01;
@@ -936,7 +1194,7 @@ static void commadpt_execute_ccw (DEVBLK *dev, BYTE code, BYTE flags,
 
       rc = write_adpt((void*)&ccw, sizeof(ccw), dev->commadpt);
       /* Wait for ACK */
-      recv_ack(dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
+      recv_ack(dev->commadpt, dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
 
       switch (code) {
          /*----------------------------------------------------------*/
@@ -952,10 +1210,10 @@ static void commadpt_execute_ccw (DEVBLK *dev, BYTE code, BYTE flags,
          case 0x03:
             *residual = count;
             /* Get Channel Return Status */
-            rc = recv(dev->commadpt->busfd, &dev->commadpt->carnstat, 1, 0);
+            rc = adpt_recv(dev->commadpt, dev->commadpt->busfd, &dev->commadpt->carnstat, 1);
             *unitstat = dev->commadpt->carnstat;
             /* Send ACK */
-            send_ack(dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
+            send_ack(dev->commadpt, dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
             break;
 
          /*----------------------------------------------------------*/
@@ -963,7 +1221,7 @@ static void commadpt_execute_ccw (DEVBLK *dev, BYTE code, BYTE flags,
          /*----------------------------------------------------------*/
          case 0x04:
             /* Wait for the sense data */
-            rc = recv(dev->commadpt->busfd, dev->sense, 256, 0);
+            rc = adpt_recv(dev->commadpt, dev->commadpt->busfd, dev->sense, 256);
             dev->numsense = rc;
             dev->commadpt->unack_attn_count = 0;
             num = count < dev->numsense?count:dev->numsense;
@@ -974,12 +1232,12 @@ static void commadpt_execute_ccw (DEVBLK *dev, BYTE code, BYTE flags,
             memcpy (iobuf, dev->sense, rc);
             *residual = count-num;
             /* Send the ACK */
-            send_ack(dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
+            send_ack(dev->commadpt, dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
             /* Get Channel Return Status */
-            rc = recv(dev->commadpt->busfd, &dev->commadpt->carnstat, 1, 0);
+            rc = adpt_recv(dev->commadpt, dev->commadpt->busfd, &dev->commadpt->carnstat, 1);
             *unitstat = CSW_CE | CSW_DE;
             /* Send the ACK */
-            send_ack(dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
+            send_ack(dev->commadpt, dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
             break;
 
          /*----------------------------------------------------------*/
@@ -991,14 +1249,14 @@ static void commadpt_execute_ccw (DEVBLK *dev, BYTE code, BYTE flags,
             tracesna("WRITE", dev, iobuf);
             rc = write_adpt(iobuf, count, dev->commadpt);
             /* Wait for the ACK from the remote channel adapter      */
-            recv_ack(dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
+            recv_ack(dev->commadpt, dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
             if (rc == 0) {
                *residual = 0;
                /* Get Channel Return Status */
-               rc = recv(dev->commadpt->busfd, &dev->commadpt->carnstat, 1, 0);
+               rc = adpt_recv(dev->commadpt, dev->commadpt->busfd, &dev->commadpt->carnstat, 1);
                *unitstat = dev->commadpt->carnstat;
                /* send ACK */
-               send_ack(dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
+               send_ack(dev->commadpt, dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
             } else {
                *unitstat |= CSW_ATTN;
                *unitstat |= CSW_UX | CSW_ATTN;
@@ -1019,11 +1277,11 @@ static void commadpt_execute_ccw (DEVBLK *dev, BYTE code, BYTE flags,
          case 0x93:
             dev->commadpt->unack_attn_count = 0;
             /* Get Channel Return Status */
-            rc = recv(dev->commadpt->busfd, &dev->commadpt->carnstat, 1, 0);
+            rc = adpt_recv(dev->commadpt, dev->commadpt->busfd, &dev->commadpt->carnstat, 1);
             *residual = count;
             *unitstat = dev->commadpt->carnstat;
             /* send ACK */
-            send_ack(dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
+            send_ack(dev->commadpt, dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
             break;
 
          /*----------------------------------------------------------*/
@@ -1031,24 +1289,33 @@ static void commadpt_execute_ccw (DEVBLK *dev, BYTE code, BYTE flags,
          /*----------------------------------------------------------*/
          case 0x02:     /* READ */
             /* Wait for the remote channel adapter data */
-            rc = recv(dev->commadpt->busfd, dev->commadpt->inpbuf, count, 0);
-
+            rc = read_block(dev->commadpt->inpbuf, count, dev->commadpt, &over);
             dev->commadpt->read_ccw_count++;
             dev->commadpt->unack_attn_count = 0;
-            *more = 0;
+            if (rc < 0) {
+               /* Bus connection lost: no data, unit check           */
+               *more = 0;
+               *residual = count;
+               dev->sense[0] = SENSE_EC;
+               dev->sense[1] = 0;
+               *unitstat = CSW_CE + CSW_DE + CSW_UC;
+               break;
+            }
+            /* Data dropped past the count: incorrect length         */
+            *more = over;
             /* Copy data to I/O buffer */
             memcpy (iobuf, dev->commadpt->inpbuf, rc);
             *residual = count - rc;
             logdump("READ", dev, iobuf, rc);
             tracesna("READ", dev, iobuf);
             /* Send the ACK */
-            send_ack(dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
+            send_ack(dev->commadpt, dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
 
             /* Get Channel Return Status */
-            rc = recv(dev->commadpt->busfd, &dev->commadpt->carnstat, 1, 0);
+            rc = adpt_recv(dev->commadpt, dev->commadpt->busfd, &dev->commadpt->carnstat, 1);
             *unitstat = dev->commadpt->carnstat;
             /* send ACK */
-            send_ack(dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
+            send_ack(dev->commadpt, dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
             break;
 
          /*----------------------------------------------------------*/
@@ -1062,14 +1329,14 @@ static void commadpt_execute_ccw (DEVBLK *dev, BYTE code, BYTE flags,
             tracesna("WRITE", dev, iobuf);
             rc = write_adpt(iobuf, count, dev->commadpt);
             /* Wait for the ACK from the remote channel adapter   */
-            recv_ack(dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
+            recv_ack(dev->commadpt, dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
             if (rc == 0) {
                *residual = 0;
                /* Get Channel Return Status */
-               rc = recv(dev->commadpt->busfd, &dev->commadpt->carnstat, 1, 0);
+               rc = adpt_recv(dev->commadpt, dev->commadpt->busfd, &dev->commadpt->carnstat, 1);
                *unitstat = dev->commadpt->carnstat;
                /* Send ACK */
-               send_ack(dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
+               send_ack(dev->commadpt, dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
             } else {
                *unitstat |= CSW_ATTN;
                *unitstat |= CSW_UX | CSW_ATTN;
@@ -1081,7 +1348,7 @@ static void commadpt_execute_ccw (DEVBLK *dev, BYTE code, BYTE flags,
          /*----------------------------------------------------------*/
          default:
             /* Wait for the sense data */
-            rc = recv(dev->commadpt->busfd, dev->sense, 256, 0);
+            rc = adpt_recv(dev->commadpt, dev->commadpt->busfd, dev->sense, 256);
             dev->numsense = rc;
             dev->commadpt->unack_attn_count = 0;
             num = count < dev->numsense?count:dev->numsense;
@@ -1092,12 +1359,12 @@ static void commadpt_execute_ccw (DEVBLK *dev, BYTE code, BYTE flags,
             memcpy (iobuf, dev->sense, rc);
             *residual = count-num;
             /* Send the ACK */
-            send_ack(dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
+            send_ack(dev->commadpt, dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
             /* Get Channel Return Status */
-            rc = recv(dev->commadpt->busfd, &dev->commadpt->carnstat, 1, 0);
+            rc = adpt_recv(dev->commadpt, dev->commadpt->busfd, &dev->commadpt->carnstat, 1);
             *unitstat = dev->commadpt->carnstat;
             /* Send the ACK */
-            send_ack(dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
+            send_ack(dev->commadpt, dev->commadpt->busfd, dev->ssid, dev->devnum, dev->commadpt->debug);
             break;
 
       } // End of switch (code)
@@ -1120,7 +1387,7 @@ static void commadpt_execute_ccw (DEVBLK *dev, BYTE code, BYTE flags,
       else
          *unitstat = CSW_CE + CSW_DE;
 
-   } // End if IsSocketConnected...
+   } // End if adpt_connected...
 }
 
 /*-------------------------------------------------------------------*/
@@ -32,6 +32,7 @@
 #include "htypes.h"
 #include "i3705_sdlc.h"
 #include "codepage.c"
+#include "i3705_sock.h"
 #include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
@@ -1205,6 +1206,7 @@ void *PU2_thread(void *arg)
            free(pu2[j]);
            exit(EXIT_FAILURE);
        }
+       sock_tune(pu2[j]->pu_fd);
        /* Listen and verify */
        if ((listen(pu2[j]->pu_fd, 10)) != 0) {
           printf("\nPU2: 3174-%dSocket listen failed %s\n\r",j, strerror(errno));
@@ -1241,6 +1243,7 @@ void *PU2_thread(void *arg)
             if (pu2[k]->lu_fd[pu2[k]->lunum] < 1) {
                printf("\nPU2: accept failed for 3174-%d %s\n",k, strerror(errno));
              } else {
+               sock_tune(pu2[k]->lu_fd[pu2[k]->lunum]);
                if (connect_client(&pu2[k]->lu_fd[pu2[k]->lunum], &pu2[k]->punum, &pu2[k]->lunum))  {
                   pu2[k]->is_3270[pu2[k]->lunum] = 1;
                } else {
@@ -156,6 +156,10 @@
 #define SYSDSPR2   0x72         // Display register 2
 #define SYSPRKEY   0x73         // Set system protection key
 #define SYSSTKEY   0x73         // Set system storage key
+                                // X'0400' on: bits 13-15 are the L5
+                                // program key.  Off: bits 13-15 are the
+                                // key of the 2K block addressed by the
+                                // value.  Checked with SET CPU PROTECT=ON
 #define SYSMSCTL   0x77         // Miscellaneous Control.
 #define SYSDIAG    0x78         // Force CCU checks.
 #define SYSUTILO   0x79         // Utility.
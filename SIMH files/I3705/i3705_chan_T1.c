@@ -89,6 +89,7 @@ extern int32 Eregs_Inp[];
 extern int32 Eregs_Out[];
 extern int8  CA1_DS_req_L3;  /* Chan Adap Data/Status request flag */
 extern int8  CA1_IS_req_L3;  /* Chan Adap Initial/Sel request flag */
+extern void  cpu_wake(void); /* Wake an idle CCU */
 char data_buffer[IMAX];
 char response_buffer[RMAX];
 int i;
@@ -306,6 +307,7 @@ void *CA1_ATTN(void *arg) {
         Eregs_Inp[0x62] |= 0x0100;               // Set Program requested L3 interrupt
         Eregs_Inp[0x77] |= 0x0010;               // Set L3 Data Service Request
         CA1_DS_req_L3 = ON;                      // Chan Adap Data Service  request flag
+        cpu_wake();
         while (Ireg_bit(0x77, 0x0010) == ON) wait();
         Eregs_Out[0x67] &= ~0x0040;              // Reset L3 DS/ request
         printf("CA1: Sending Return status\n\r");
@@ -447,6 +449,7 @@ void *CA1_thread(void *arg) {
             Eregs_Inp[0x62] |= 0x8000;                       // Set outbound data transfer request
             Eregs_Inp[0x77] |= 0x0008;                       // Set Initial select lvl 3 interrupt
             CA1_IS_req_L3 = ON;                              // Chan Adap Initial Sel request flag
+            cpu_wake();
 
             while (Ireg_bit(0x77, 0x008) == ON) wait();      // Wait for initial selection reset
             i = 0;                                           // Data to be send counter
@@ -480,6 +483,7 @@ void *CA1_thread(void *arg) {
                }
                Eregs_Inp[0x77] |= 0x0010;                          // Set L3 Data Service Request
                CA1_DS_req_L3 = ON;                                 // Chan Adap Data Service request flag
+               cpu_wake();
                while (Ireg_bit(0x77, 0x0010) == ON) wait();        // Wait for reset of Data/Status interrupt
             }
 
@@ -513,6 +517,7 @@ void *CA1_thread(void *arg) {
             Eregs_Inp[0x60] |= 0x8000;                       // Set initial selection
             Eregs_Inp[0x77] |= 0x0008;                       // Set Initial select lvl 3 interrupt
             CA1_IS_req_L3 = ON;                              // Chan Adap Initial Sel request flag
+            cpu_wake();
             while (Ireg_bit(0x77, 0x0008) == ON) wait();     // Wait for initial selection reset
 
             nobytes = (Eregs_Out[0x62] & 0x0003);            // Get nr of bytes
@@ -551,6 +556,7 @@ void *CA1_thread(void *arg) {
             Eregs_Inp[0x60] |= 0x8000;                       // Set initial selection
             Eregs_Inp[0x77] |= 0x0008;                       // Set Initial select lvl 3 interrupt
             CA1_IS_req_L3 = ON;                              /* Chan Adap Initial Sel request flag */
+            cpu_wake();
             while (Ireg_bit(0x77, 0x0008) == ON) wait();     // Wait for initial selection reset
 
             Eregs_Inp[0x62] &= ~0x0400;                      // Reset channel stop
@@ -607,6 +613,7 @@ void *CA1_thread(void *arg) {
                    Eregs_Inp[0X62] = (Eregs_Inp[0X62] & ~0x0007) | tcount;  // Set number of bytes transferred
                    Eregs_Inp[0x77] |= 0x0010;                // Set L3 Data Service Request
                    CA1_DS_req_L3 = ON;                       // Chan Adap Data Service request flag */
+                   cpu_wake();
  //                printf("\nCA1: Transfer %04X, Data = %04X \n\r",  i, Eregs_Inp[0x64]);
                }
 
@@ -616,6 +623,7 @@ void *CA1_thread(void *arg) {
             Eregs_Inp[0X62] &= ~0x0007;                      // Set number of bytes transferred to 0
             Eregs_Inp[0x77] |= 0x0010;                       // Set data/serv lvl 3 interrupt
             CA1_DS_req_L3 = ON;                              /* Chan Adap Data Service request flag */
+            cpu_wake();
             printf("CA1: Channel Stop\n\r");
 
             if (Eregs_Out[0x62] & 0x1000) {                  // Present Channel end
@@ -647,6 +655,7 @@ void *CA1_thread(void *arg) {
             Eregs_Inp[0x60] |= 0x8000;                       // Set initial selection
             Eregs_Inp[0x77] |= 0x0008;                       // Set Initial select lvl 3 interrupt
             CA1_IS_req_L3 = ON;                              // Chan Adap Initial Sel request flag
+            cpu_wake();
             while (Ireg_bit(0x77, 0x0008) == ON) wait();     // Wait for initial selection reset
 
             // Send CA return status to host
@@ -29,26 +29,33 @@
 #include "sim_defs.h"
 #include "i3705_defs.h"
 #include "i3705_Eregs.h"     // Exernal regs defs
+#include "i3705_stats.h"     // Performance counters
+#include "i3705_shm.h"       // Shared memory channel transport
+#include "i3705_chan_T2.h"   // Per CA state and register banks
+#include "i3705_sock.h"      // TCP socket tuning
+#include "i3705_mem.h"       // Storage access
+#include "i3705_ckpt.h"      // Checkpoint state
+#include "sim_shmem.h"
 #include <signal.h>
 #include <ctype.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <netdb.h>
+#include <netinet/tcp.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
 #include <sys/syscall.h>
+#include <sys/uio.h>
 
-#define IMAX 4096            // Input buffer size Random. Need to define a more rational value
-#define RMAX 64              // Response buffer size Random. Need to define a more rational value
 
 #define CAA 0                // Channel Adapter channel connection A
 #define CAB 1                // Channel Adapter channel connection B
-#define MAXPORTS 4
 #define PORTCA1A 37051       // TCP/IP port number CA1 A
 #define PORTCA1B 37052       // TCP/IP port number CA1 B
 #define PORTCA2A 37053       // TCP/IP port number CA2 A
@@ -70,72 +77,128 @@
 #define SENSE_CR 0x80         // Command Reject
 
 #define MAXHOSTS 4
+#define CA_IOV   256         // Max CW data segments gathered for one Read
 
 #define checkrc(expr) if(!(expr)) { perror(#expr); return -1; }
 
+// A CA on the shared memory transport gets pseudo file descriptors for
+// its bus and tag connections; ch_send/ch_recv route them to the rings.
+#define SHM_FD        0x40000000
+#define SHM_FD_TAG    0x00000001
+#define SHM_FD_CA(fd) (((fd) >> 1) & 1)
+
 typedef enum { false, true } bool;
 
 extern int32 debug_reg;
 extern int32 Eregs_Inp[];
 extern int32 Eregs_Out[];
 extern uint8 M[];
-extern int8  CA1_DS_req_L3;  /* Chan Adap Data/Status request flag */
-extern int8  CA1_IS_req_L3;  /* Chan Adap Initial/Sel request flag */
+extern UNIT cpu_unit;
+extern void  cpu_wake(void); /* Wake an idle CCU */
 
 void *CAx_thread(void *args);
 void *CA_ATTN_thread(void *args);
+void ca_attn_post(int reg);
 
-char data_buffer[IMAX];
-char response_buffer[RMAX];
 uint16_t CAPORTS[2][2] = {{37051, 37052}, {37053, 37054}};
-int i;
-uint8_t nobytes, tcount;
 
 // Declaration of thread condition variable
-pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+pthread_cond_t cond = PTHREAD_COND_INITIALIZER;     // ATTN thread wakeup
+pthread_mutex_t attn_lock = PTHREAD_MUTEX_INITIALIZER;
+uint32_t ca_attn_delay[2];           // Hold a new attention this many usec to batch PIUs
+uint32_t ca_failover_ms[2];          // Switch to the other port after this much host silence, 0 = off
+uint32_t ca_io_timeout[2];           // Seconds the host may take for a step within a CCW, 0 = off
+int ca_wake_fd = -1;                 // Wakes the reactor, e.g. to listen after a failover
+struct SOCK_OPT sock_opt = { 1, 0, 0, 0 };   // TCP options of all emulator sockets
+
+static struct IO3705 ca_iob[2];
+struct IO3705 *iob1 = &ca_iob[0], *iob2 = &ca_iob[1];   // CA1 and CA2
+int   ca_sel;                        // CA selected by OUT X'57': 0 = CA1, 1 = CA2
+int32 CA2_Inp[0x80];                 // CA2 register bank, only X'50'-X'5F' used
+int32 CA2_Out[0x80];
+
+struct CKPT_ITEM ca_ckpt[] = {       // CA2 bank and selection, CA1 is in Eregs
+   CKPT(CA2_Inp), CKPT(CA2_Out), CKPT(ca_sel),
+   CKPT(ca_iob[0].IS_req_L3), CKPT(ca_iob[0].DS_req_L3),
+   CKPT(ca_iob[1].IS_req_L3), CKPT(ca_iob[1].DS_req_L3),
+   { NULL }
+};
+
+#define SOCK_SET_NODELAY   0         // SET CA socket options, MTAB val
+#define SOCK_SET_NONODELAY 1
+#define SOCK_SET_SNDBUF    2
+#define SOCK_SET_RCVBUF    3
+#define SOCK_SET_BUSYPOLL  4
+
+#define ATTN_PRA        0x01         // OUT X'55': program requested attention
+#define ATTN_L3         0x02         // OUT X'57': program requested L3 interrupt
+#define ATTN_RETRY      0x04         // A refused attention is due again
+#define ATTN_HBEAT      0x08         // A tag heartbeat is due (FAILOVER)
+#define TAG_HBEAT       0xFF         // Tag heartbeat, echoed by the host, never a status
+#define ATTN_RETRY_MS   10           // First retry of a cancelled attention, msec
+#define ATTN_RETRY_MAX  1000         // Retry backoff limit, msec
 
-// Declaring mutex
-pthread_mutex_t lock;
 extern pthread_mutex_t r77_lock;
 
 int reg_bit(int reg, int bit_mask);
 int Ireg_bit(int reg, int bit_mask);
 void wait();
 
-struct CCW     /* Channel Command Word */
-   {
-   uint8_t  code;
-   uint8_t  dataddress[3];
-   uint8_t  flags;
-   uint8_t  chain;           // Format 0. Chain is not correct (yet), but aligned to Hercules
-   uint16_t count;
-} ccw;
-
-struct CSW     /* Channel Status Word */
-   {
-   uint8_t  key;
-   uint8_t  dataddress[3];
-   uint8_t  unit_conditions;
-   uint8_t  channel_conditions;
-   uint16_t count;
-} csw;
-
-struct IO3705  /* IBM 3705 I/O */
-   {
-   char CA_id;
-   int CA_active;
-   int CA_socket[2];
-   uint16_t CA_mask;
-   int addrlen[MAXPORTS];
-   int bus_socket[2];
-   int tag_socket[2];
-   int abswitch;
-   int abswhist;
-   uint16_t devnum;
-   uint8_t buffer[1024];     // Data buffer of 1K
-   uint32_t bufferl;         // Received data length
-   struct sockaddr_in address[2];
-   } *iob1, *iob2;
+struct CA_STATS ca_stats[2];         // CA1 and CA2 performance counters
+#define CA_STAT(id) ca_stats[(id) - '1']
+
+char ca_shm_name[2][64];             // Shared memory segment per CA, "" = TCP
+struct SHM_CHAN *ca_shm[2];          // Attached segment, NULL = TCP
+SHMEM *ca_shmem[2];
+uint32_t ca_shm_gen[2];              // Last host attach seen
+int ca_started = FALSE;              // Channel adapters are listening
+
+t_stat ca_show_stats (FILE *st, UNIT *uptr, int32 val, void *desc);
+t_stat ca_set_transport (UNIT *uptr, int32 val, char *cptr, void *desc);
+t_stat ca_show_transport (FILE *st, UNIT *uptr, int32 val, void *desc);
+t_stat ca_set_attndelay (UNIT *uptr, int32 val, char *cptr, void *desc);
+t_stat ca_show_attndelay (FILE *st, UNIT *uptr, int32 val, void *desc);
+t_stat ca_set_failover (UNIT *uptr, int32 val, char *cptr, void *desc);
+t_stat ca_set_iotimeout (UNIT *uptr, int32 val, char *cptr, void *desc);
+t_stat ca_show_iotimeout (FILE *st, UNIT *uptr, int32 val, void *desc);
+t_stat ca_set_sockopt (UNIT *uptr, int32 val, char *cptr, void *desc);
+t_stat ca_show_sockopt (FILE *st, UNIT *uptr, int32 val, void *desc);
+t_stat ca_show_failover (FILE *st, UNIT *uptr, int32 val, void *desc);
+t_value get_uint (char *cptr, uint32 radix, t_value max, t_stat *status);
+
+/* CA data structures
+   ca_unit      CA units: CA1 and CA2 are units 1 and 2, unit 0 is unused
+   ca_dev       CA device descriptor
+   ca_mod       CA modifiers list
+*/
+
+UNIT ca_unit[] = {
+    { UDATA (NULL, UNIT_DIS, 0) },
+    { UDATA (NULL, 0, 0) },
+    { UDATA (NULL, 0, 0) }
+};
+
+MTAB ca_mod[] = {
+    { MTAB_XTD|MTAB_VDV|MTAB_NMO, 0, "STATS", NULL, NULL, &ca_show_stats },
+    { MTAB_XTD|MTAB_VUN|MTAB_NC, 0, "TRANSPORT", "TRANSPORT", &ca_set_transport, &ca_show_transport },
+    { MTAB_XTD|MTAB_VUN, 0, "ATTNDELAY", "ATTNDELAY", &ca_set_attndelay, &ca_show_attndelay },
+    { MTAB_XTD|MTAB_VUN, 0, "FAILOVER", "FAILOVER", &ca_set_failover, &ca_show_failover },
+    { MTAB_XTD|MTAB_VUN, 0, "IOTIMEOUT", "IOTIMEOUT", &ca_set_iotimeout, &ca_show_iotimeout },
+    { MTAB_XTD|MTAB_VDV|MTAB_NMO, 0, "SOCKETS", NULL, NULL, &ca_show_sockopt },
+    { MTAB_XTD|MTAB_VDV, SOCK_SET_NODELAY, NULL, "NODELAY", &ca_set_sockopt, NULL },
+    { MTAB_XTD|MTAB_VDV, SOCK_SET_NONODELAY, NULL, "NONODELAY", &ca_set_sockopt, NULL },
+    { MTAB_XTD|MTAB_VDV, SOCK_SET_SNDBUF, NULL, "SNDBUF", &ca_set_sockopt, NULL },
+    { MTAB_XTD|MTAB_VDV, SOCK_SET_RCVBUF, NULL, "RCVBUF", &ca_set_sockopt, NULL },
+    { MTAB_XTD|MTAB_VDV, SOCK_SET_BUSYPOLL, NULL, "BUSYPOLL", &ca_set_sockopt, NULL },
+    { 0 }
+};
+
+DEVICE ca_dev = {
+    "CA", ca_unit, NULL, ca_mod,
+    3, 16, 16, 1, 16, 8,
+    NULL, NULL, NULL, NULL,
+    NULL, NULL
+};
 
 struct pth_args
    {
@@ -184,16 +247,204 @@ static bool IsSocketConnected(int sockfd) {
 }
 
 
+// ************************************************************
+// Channel I/O on a TCP socket or a shared memory ring
+// ************************************************************
+// With IOTIMEOUT, a host that does not answer within that time in the
+// middle of a CCW is cut off: every further step on the socket then fails at once,
+// the CCW ends and the CA thread drops the connection.
+static int ch_timeout(int sockfd, int rc) {
+   if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      printf("\nCA: Host not responding on socket %d, disconnecting\n\r", sockfd);
+      shutdown(sockfd, SHUT_RDWR);
+   }
+   return rc;
+}
+
+static int ch_send(int sockfd, void *buf, int len) {
+   struct SHM_CHAN *ch;
+
+   if (sockfd & SHM_FD) {
+      ch = ca_shm[SHM_FD_CA(sockfd)];
+      return shm_send(&ch->ring[(sockfd & SHM_FD_TAG) ? SHM_TAG_C2H : SHM_BUS_C2H],
+                      buf, len, &ch->host_up);
+   }
+   return ch_timeout(sockfd, send(sockfd, buf, len, MSG_NOSIGNAL));
+}
+
+// Send a chain of storage segments as one transfer
+static int ch_sendv(int sockfd, struct iovec *iov, int iovcnt) {
+   struct SHM_CHAN *ch;
+   struct msghdr msg = { 0 };
+
+   if (sockfd & SHM_FD) {
+      ch = ca_shm[SHM_FD_CA(sockfd)];
+      return shm_sendv(&ch->ring[SHM_BUS_C2H], iov, iovcnt, &ch->host_up);
+   }
+   msg.msg_iov = iov;
+   msg.msg_iovlen = iovcnt;
+   return ch_timeout(sockfd, sendmsg(sockfd, &msg, MSG_NOSIGNAL));
+}
+
+static int ch_recv(int sockfd, void *buf, int len) {
+   struct SHM_CHAN *ch;
+
+   if (sockfd & SHM_FD) {
+      ch = ca_shm[SHM_FD_CA(sockfd)];
+      return shm_recv(&ch->ring[(sockfd & SHM_FD_TAG) ? SHM_TAG_H2C : SHM_BUS_H2C],
+                      buf, len, &ch->host_up);
+   }
+   return ch_timeout(sockfd, recv(sockfd, buf, len, 0));
+}
+
+static void ch_close(int sockfd) {
+   if ((sockfd & SHM_FD) == 0)
+      close(sockfd);
+}
+
+// Clip a cycle steal transfer to the end of 3705 storage
+static int cs_len(struct IO3705 *iob, uint32_t addr, int len) {
+   if (addr + len <= MEMSIZE)
+      return len;
+   printf("\nCA%c: Cycle steal address %05X beyond storage, count %d \n\r", iob->CA_id, addr, len);
+   return (addr < MEMSIZE) ? MEMSIZE - addr : 0;
+}
+
+
+// ************************************************************
+// Function to create the shared memory segment of a CA
+// ************************************************************
+static void shm_open_ca(struct IO3705 *iob) {
+   struct SHM_CHAN *ch;
+   void *addr;
+   int ca = iob->CA_id - '1';
+
+   if (ca_shm_name[ca][0] == 0)
+      return;                                   // TCP transport
+   if (sim_shmem_open(ca_shm_name[ca], sizeof(struct SHM_CHAN), &ca_shmem[ca], &addr) != SCPE_OK) {
+      printf("\nCA%c: Shared memory channel %s not available, using TCP\n\r", iob->CA_id, ca_shm_name[ca]);
+      ca_shm_name[ca][0] = 0;
+      return;
+   }
+   ch = addr;
+   ch->ccu_up  = 0;
+   ch->host_up = 0;                             // Force a host from a previous run to re-attach
+   shm_reset(ch);
+   ch->magic   = SHM_MAGIC;
+   ch->version = SHM_VERSION;
+   ca_shm_gen[ca] = ch->host_gen;
+   __atomic_store_n(&ch->ccu_up, 1, __ATOMIC_RELEASE);
+   ca_shm[ca] = ch;
+   iob->bus_socket[iob->abswitch] = -1;
+   iob->tag_socket[iob->abswitch] = -1;
+   printf("CA%c: Waiting for channel connection on shared memory %s \n\r", iob->CA_id, ca_shm_name[ca]);
+}
+
+
+// ************************************************************
+// Function to pick up a host attach on a shared memory CA
+// ************************************************************
+static int shm_connect(struct IO3705 *iob) {
+   struct SHM_CHAN *ch;
+   uint32_t gen;
+   int ca = iob->CA_id - '1';
+
+   ch = ca_shm[ca];
+   gen = __atomic_load_n(&ch->host_gen, __ATOMIC_ACQUIRE);
+   if (!__atomic_load_n(&ch->host_up, __ATOMIC_ACQUIRE) || gen == ca_shm_gen[ca] ||
+       iob->bus_socket[iob->abswitch] > 0)
+      return -1;
+   ca_shm_gen[ca] = gen;
+   iob->bus_socket[iob->abswitch] = SHM_FD | (ca << 1);
+   iob->tag_socket[iob->abswitch] = SHM_FD | (ca << 1) | SHM_FD_TAG;
+   printf("\nCA%c: New bus and tag connection on shared memory %s\n\r", iob->CA_id, ca_shm_name[ca]);
+   return 0;
+}
+
+
 // ************************************************************
 // Function to accept TCP connection from host
 // ************************************************************
+// Bound every blocking step on a bus or tag socket by IOTIMEOUT. Taken at
+// connect time, so a new value applies from the next host connection.
+static void ca_set_timeout(struct IO3705 *iob, int sockfd) {
+   struct timeval tv = { ca_io_timeout[iob->CA_id - '1'], 0 };
+
+   if (tv.tv_sec == 0)
+      return;                          // Off: a slow host is waited for
+   setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+   setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+// With FAILOVER, data the host does not ack within that time breaks the connection
+static void ca_set_user_timeout(struct IO3705 *iob, int sockfd) {
+   unsigned int ms = ca_failover_ms[iob->CA_id - '1'];
+
+   if (ms != 0 && setsockopt(sockfd, IPPROTO_TCP, TCP_USER_TIMEOUT, &ms, sizeof(ms)))
+      perror("ERROR: setsockopt(), TCP_USER_TIMEOUT");
+}
+
+// ************************************************************
+// Function to switch a CA to its other channel port after the
+// host on the active port is lost (FAILOVER). The NCP sees a
+// system reset on the CA, as when the host resets the channel,
+// and its sessions stay up for the standby host to take over.
+// ************************************************************
+static void ca_failover(struct IO3705 *iob) {
+   uint64_t one = 1;
+
+   printf("\nCA%c: Channel %c lost, failing over to channel %c\n\r",
+          iob->CA_id, abswid[iob->abswitch], abswid[iob->abswitch ^ 1]);
+   STAT_INC(CA_STAT(iob->CA_id).failover);
+   iob->abswitch ^= 1;                  // Same as throwing the panel A/B switch
+   iob->inp[0x55] &= ~0x0100;           // Reset Channel Active
+   iob->inp[0x55] |= 0x0010;            // Flag System Reset
+   pthread_mutex_lock(&r77_lock);
+   Eregs_Inp[0x77] |= iob->CA_mask;     // Set CA L3 interrupt request
+   pthread_mutex_unlock(&r77_lock);
+   iob->IS_req_L3 = ON;
+   cpu_wake();
+   if (write(ca_wake_fd, &one, sizeof(one)) < 0)   // Reactor listens on the new port
+      printf("\nCA%c: Reactor wakeup failed with error %s \n\r", iob->CA_id, strerror(errno));
+}
+
+// ************************************************************
+// Function for the CA thread to ask the reactor (CA_T2_thread)
+// to ring its doorbell when the next CCW arrives, and to wait
+// for it. Idle CA's so never sit in a blocking recv.
+// ************************************************************
+static void ca_wait_ccw(struct IO3705 *iob) {
+   struct epoll_event ev;
+   int fd = iob->bus_socket[iob->abswitch];
+
+   ev.events = EPOLLIN | EPOLLONESHOT;
+   ev.data.fd = fd;
+   if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) && (errno != ENOENT ||
+       epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev))) {
+      printf("\nCA%c: Add polling event failed for bus socket with error %s \n\r", iob->CA_id, strerror(errno));
+      return;                          // Fall back to a blocking read
+   }
+   pthread_mutex_lock(&iob->ccw_lock);
+   while (!iob->ccw_ready)
+      pthread_cond_wait(&iob->ccw_cond, &iob->ccw_lock);
+   iob->ccw_ready = FALSE;
+   pthread_mutex_unlock(&iob->ccw_lock);
+}
+
+// Reactor side: the bus socket of iob is readable (CCW, or hangup)
+static void ca_ring_ccw(struct IO3705 *iob) {
+   pthread_mutex_lock(&iob->ccw_lock);
+   iob->ccw_ready = TRUE;
+   pthread_cond_signal(&iob->ccw_cond);
+   pthread_mutex_unlock(&iob->ccw_lock);
+}
+
 int host_connect(struct IO3705 *iob, int abport) {
    int alive = 1;     // Enable KEEP_ALIVE
    int idle = 5;      // First  probe after 5 seconds
    int intvl = 3;     // Subsequent probes after 3 seconds
    int cntpkt = 3;    // Timeout after 3 failed probes
    int timeout = 1000;
-   int rc;
 
    // Accept the incoming connection
    iob->addrlen[abport] = sizeof(iob->address[abport]);
@@ -224,6 +475,9 @@ int host_connect(struct IO3705 *iob, int abport) {
          return -1;
       }
 
+      sock_tune(iob->bus_socket[abport]);
+      ca_set_timeout(iob, iob->bus_socket[abport]);
+      ca_set_user_timeout(iob, iob->bus_socket[abport]);
       printf("\nCA%c: New bus connection on 3705 port %d, socket fd is %d, ip is : %s, port : %d \n\r",
             iob->CA_id,iob->CA_socket[abport], iob->bus_socket[abport], inet_ntoa(iob->address[abport].sin_addr),
             (ntohs(iob->address[abport].sin_port)));
@@ -234,6 +488,9 @@ int host_connect(struct IO3705 *iob, int abport) {
       iob->tag_socket[abport] = accept(iob->CA_socket[abport], (struct sockaddr *)&iob->address[abport], (socklen_t*)&iob->addrlen[abport]);
 
       if (iob->tag_socket[abport] > 0) {
+         sock_tune(iob->tag_socket[abport]);
+         ca_set_timeout(iob, iob->tag_socket[abport]);
+         ca_set_user_timeout(iob, iob->tag_socket[abport]);
          printf("\nCA%c: New tag connection on 3705 port %d, socket fd is %d, ip is : %s, port : %d \n\r",
                   iob->CA_id, iob->CA_socket[abport], iob->tag_socket[abport], inet_ntoa(iob->address[abport].sin_addr),
                   (ntohs(iob->address[abport].sin_port)));
@@ -252,22 +509,23 @@ int host_connect(struct IO3705 *iob, int abport) {
 // ************************************************************
 // Function to send CA return status to the host
 // ************************************************************
-void send_carnstat(int sockptr, char *carnstat, uint8_t *ackbuf, char CA_id) {
+void send_carnstat(struct IO3705 *iob, int sockptr, uint8_t *carnstat, uint8_t *ackbuf) {
    int rc;                         // Return code
+   char CA_id = iob->CA_id;
 
-   while (Ireg_bit(0x77, 0x0028) == ON)
-      wait();                      // Wait for CA 1 L3 interrupt reset
+   while (Ireg_bit(0x77, iob->CA_mask) == ON)
+      wait();                      // Wait for CA L3 interrupt reset
 
    // If DE and CE and reset Write Break Remember and Channel Active
    if (*carnstat & CSW_DEND) {
-      Eregs_Inp[0x55] &= ~0x0040;  // Reset Write Break Remember
-      Eregs_Inp[0x55] &= ~0x0100;  // Reset Channel Active
+      iob->inp[0x55] &= ~0x0040;  // Reset Write Break Remember
+      iob->inp[0x55] &= ~0x0100;  // Reset Channel Active
       *carnstat |= CSW_CEND;       // CA sets channel end
    }
    if (debug_reg & 0x80)
       printf("CA%c: CARNSTAT %04X via socket %d\n\r", CA_id, *carnstat, sockptr);
    if (sockptr != -1) {
-      rc = send(sockptr, carnstat, 1, 0);
+      rc = ch_send(sockptr, carnstat, 1);
       if (debug_reg & 0x80)
          printf("CA%c: Send %d bytes on socket %d\n\r", CA_id, rc, sockptr);
    } else
@@ -275,17 +533,22 @@ void send_carnstat(int sockptr, char *carnstat, uint8_t *ackbuf, char CA_id) {
 
    if (rc < 0) {
       printf("\nCA%c: CA status send to host failed...\n\r", CA_id);
+      STAT_INC(CA_STAT(CA_id).sock_err);
       return;
    }
    // Wait for the ACK from the host
-   rc = recv(sockptr, ackbuf, 1,0);
+   rc = ch_recv(sockptr, ackbuf, 1);
+   while (rc == 1 && *ackbuf == TAG_HBEAT && iob->hb_wait && sockptr == iob->tag_socket[iob->abswitch]) {
+      iob->hb_wait = FALSE;        // Heartbeat echo ahead of the ack
+      rc = ch_recv(sockptr, ackbuf, 1);
+   }
    if (debug_reg & 0x80)
       printf("CA%c: Ack received %02X on socket %d\n\r", CA_id, *ackbuf, sockptr);
-   Eregs_Out[0x54] &= ~0xFFFF;                      // Reset CA status bytes
+   iob->out[0x54] &= ~0xFFFF;                      // Reset CA status bytes
    if (CA_id == '1')
-      Eregs_Inp[0x55] &= ~0x0101;                   // Reset CA Active and CA 1 selected
+      iob->inp[0x55] &= ~0x0101;                   // Reset CA Active and CA 1 selected
    else
-      Eregs_Inp[0x55] &= ~0x0102;                   // Reset CA Active  and CA 2 selected
+      iob->inp[0x55] &= ~0x0102;                   // Reset CA Active  and CA 2 selected
    return;
 }  /* end function send_carnstat */
 
@@ -296,7 +559,7 @@ void send_carnstat(int sockptr, char *carnstat, uint8_t *ackbuf, char CA_id) {
 void recv_ack(int sockptr) {
    uint8_t ackbuf;
    int rc;
-   rc = read(sockptr, &ackbuf, 1);
+   rc = ch_recv(sockptr, &ackbuf, 1);
    return;
 }
 
@@ -307,7 +570,7 @@ void recv_ack(int sockptr) {
 void send_ack(int sockptr) {
    uint8_t ackbuf;
    int rc;
-   rc = send(sockptr, &ackbuf, 1, 0);
+   rc = ch_send(sockptr, &ackbuf, 1);
    return;
 }
 
@@ -315,16 +578,93 @@ void send_ack(int sockptr) {
 // ************************************************************
 // Function to read data from TCP socket
 // ************************************************************
-int read_socket(int sockptr, char *buffptr, int buffsize) {
+int read_socket(int sockptr, uint8_t *buffptr, int buffsize) {
    int reclen;
    bzero(buffptr, buffsize);
-   reclen = read(sockptr, buffptr, buffsize);
+   reclen = ch_recv(sockptr, buffptr, buffsize);
    if (reclen < 1)
       printf("\nCA: Read failed with error %s \n\r", strerror(errno));
    return reclen;
 }
 
 
+// ************************************************************
+// Function to receive Write data until need bytes are buffered
+// or the whole CCW count is in. Returns the buffered bytes.
+// ************************************************************
+static int recv_data(struct IO3705 *iob, uint32_t need) {
+   int rc;
+
+   while (iob->bufferl < need && iob->rcvd < iob->ccw.count) {
+      rc = ch_recv(iob->bus_socket[iob->abswitch], iob->buffer + iob->rcvd, iob->ccw.count - iob->rcvd);
+      if (debug_reg & 0x80)
+         printf("CA%c: received: %d bytes from host\n\r", iob->CA_id, rc);
+      if (rc <= 0) {
+         printf("\nCA%c: Write data short by %d bytes \n\r", iob->CA_id, iob->ccw.count - iob->rcvd);
+         STAT_INC(CA_STAT(iob->CA_id).sock_err);
+         iob->rcvd = iob->ccw.count;                 // Give up on the rest
+         break;
+      }
+      if (debug_reg & 0x80)
+         print_hex(iob->buffer + iob->rcvd, rc);
+      if (iob->rcvd == 0)
+         lat_chan_write();
+      STAT_ADD(CA_STAT(iob->CA_id).bytes_in, rc);
+      iob->rcvd += rc;
+      iob->bufferl += rc;
+   }
+   return iob->bufferl;
+}
+
+
+// ************************************************************
+// Function to throw away the Write data of a CCW that cannot
+// be buffered, so the next recv on the bus is a CCW again.
+// ************************************************************
+static void drain_data(struct IO3705 *iob) {
+   uint8_t junk[1024];
+   int rc;
+
+   while (iob->rcvd < iob->ccw.count) {
+      rc = ch_recv(iob->bus_socket[iob->abswitch], junk,
+                   (iob->ccw.count - iob->rcvd < sizeof(junk)) ? iob->ccw.count - iob->rcvd : sizeof(junk));
+      if (rc <= 0)
+         break;
+      iob->rcvd += rc;
+   }
+}
+
+
+// ************************************************************
+// Function to make room in a full Read iov, or to take a private copy
+// before a mid-chain L3 lets the NCP reuse its buffers: the storage
+// segments gathered so far are copied to iob->buffer and sent from
+// there.  Returns the new iov count, unchanged if there is no storage.
+// ************************************************************
+static int ca_iov_fold(struct IO3705 *iob, struct iovec *iov, int niov) {
+   uint32_t len = 0;
+   uint8_t *nbuf;
+   int i = 1;
+
+   if (iov[1].iov_base == iob->buffer) {       // Folded before, keep that part
+      len = iov[1].iov_len;
+      i = 2;
+   } else if (iob->ccw.count > iob->buffersz) {
+      if ((nbuf = realloc(iob->buffer, iob->ccw.count)) == NULL)
+         return niov;
+      iob->buffer = nbuf;
+      iob->buffersz = iob->ccw.count;
+   }
+   for (; i < niov; i++) {                     // Never more than the CCW count
+      memcpy(iob->buffer + len, iov[i].iov_base, iov[i].iov_len);
+      len += iov[i].iov_len;
+   }
+   iov[1].iov_base = iob->buffer;
+   iov[1].iov_len = len;
+   return 2;
+}
+
+
 // ************************************************************
 // Function to close TCP socket
 // ************************************************************
@@ -354,7 +694,7 @@ int close_socket(struct IO3705 *iob, int abchannel) {
 // ************************************************************
 int send_socket(int sockptr, char *respp, int respsize) {
    int rc;                      /* Return code */
-   rc = send (sockptr, respp, respsize, 0);
+   rc = ch_send(sockptr, respp, respsize);
 
    if (rc < 0) {
       printf("\nCA: Send to host failed...\n\r");
@@ -387,6 +727,7 @@ void start_listen(struct IO3705 *iob, int abport) {
       printf("\nCA%c: bind failed for port %d\n\r",iob->CA_id, CAPORTS[(iob->CA_id - '0')-1][abport] );
       exit(EXIT_FAILURE);
    }
+   sock_tune(iob->CA_socket[abport]);
    // Listen and verify
    if ((listen(iob->CA_socket[abport], 5)) != 0) {
       printf("\nCA%c: Listen failed for port %c\n\r", iob->CA_id,abswid[abport]);
@@ -404,94 +745,240 @@ void start_listen(struct IO3705 *iob, int abport) {
    printf("CA%c: Waiting for channel connection on TCP port %d \n\r", iob->CA_id, CAPORTS[(iob->CA_id - '0')-1][abport] );
 }
 
+// Clock of the ATTN thread condition variable
+static uint64_t attn_now_ns(void) {
+   struct timespec ts;
+
+   clock_gettime(CLOCK_REALTIME, &ts);
+   return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
 // ************************************************************
-// Thread for sending Attention interrupts to the host
-// or Level 3 interrupts to the NCP
+// Function called by the CCU on OUT X'55' and X'57' to post
+// an attention or L3 request for the selected CA to the ATTN
+// thread. reg 0 only wakes the thread, e.g. when a CA becomes
+// active.
 // ************************************************************
+void ca_attn_post(int reg) {
+   struct IO3705 *iob;
+   int ev = 0;
 
-void *CA_ATTN_thread(void *pthrargs) {
-   struct IO3705 *iob, *iob1, *iob2;
-   struct pth_args *args = pthrargs;
-   iob1 = args->arg1;
-   iob2 = args->arg2;
-   int rc,retry;
+   iob = ca_sel ? iob2 : iob1;
+   if (iob == NULL)
+      return;
+   if (reg == 0x55 && (iob->out[0x55] & 0x0200))
+      ev = ATTN_PRA;
+   if (reg == 0x57 && (Eregs_Out[0x57] & 0x0080))
+      ev = ATTN_L3;
+   if (ev == 0 && reg != 0)
+      return;
+   pthread_mutex_lock(&attn_lock);
+   iob->attn_pend |= ev;
+   pthread_cond_signal(&cond);
+   pthread_mutex_unlock(&attn_lock);
+}
+
+// Take the requests of one CA that are due now, with attn_lock held.
+// Lowers *due to when its next held or refused attention is due.
+static int attn_take(struct IO3705 *iob, uint64_t now, uint64_t *due) {
+   uint32_t ms;
+   int pend;
+
+   if (iob->CA_active != TRUE)
+      return 0;
+   if (iob->attn_retry && now >= iob->attn_retry) {
+      iob->attn_retry = 0;
+      iob->attn_pend |= ATTN_RETRY;
+   }
+   if ((iob->attn_pend & ATTN_PRA) && iob->attn_hold == 0)
+      iob->attn_hold = now + ca_attn_delay[iob->CA_id - '1'] * 1000ULL;
+   pend = iob->attn_pend & (ATTN_L3 | ATTN_RETRY);
+   if ((iob->attn_pend & ATTN_PRA) && now >= iob->attn_hold) {
+      pend |= ATTN_PRA;                          // Posts while held are one attention
+      iob->attn_hold = 0;
+   }
+   iob->attn_pend &= ~pend;
+   // FAILOVER: a heartbeat on the tag socket every half failover time
+   ms = ca_failover_ms[iob->CA_id - '1'];
+   if (ms != 0 && ca_shm[iob->CA_id - '1'] == NULL) {
+      if (iob->hb_next == 0)
+         iob->hb_wait = FALSE;                   // New connection, nothing outstanding
+      if (iob->hb_next != 0 && now >= iob->hb_next)
+         pend |= ATTN_HBEAT;
+      if (iob->hb_next == 0 || now >= iob->hb_next)
+         iob->hb_next = now + ms * 500000ULL;
+      if (*due == 0 || iob->hb_next < *due)
+         *due = iob->hb_next;
+   }
+   if ((iob->attn_pend & ATTN_PRA) && (*due == 0 || iob->attn_hold < *due))
+      *due = iob->attn_hold;
+   if (iob->attn_retry && (*due == 0 || iob->attn_retry < *due))
+      *due = iob->attn_retry;
+   return pend;
+}
+
+// Send a tag heartbeat every half failover time. The echo of the
+// previous one must be in by then, else the connection is cut and
+// the CA thread fails over. Never waits: the ATTN thread serves
+// both CAs, and the echo is picked up on this pass or by the
+// attention ack read in send_carnstat.
+static void ca_heartbeat(struct IO3705 *iob) {
+   uint8_t hb;
+   int fd = iob->tag_socket[iob->abswitch];
+
+   if (fd < 1)
+      return;
+   if (iob->hb_wait && !(recv(fd, &hb, 1, MSG_DONTWAIT) == 1 && hb == TAG_HBEAT)) {
+      printf("\nCA%c: No heartbeat from host on channel %c, disconnecting\n\r", iob->CA_id, abswid[iob->abswitch]);
+      STAT_INC(CA_STAT(iob->CA_id).sock_err);
+      shutdown(iob->bus_socket[iob->abswitch], SHUT_RDWR);
+      shutdown(fd, SHUT_RDWR);
+      iob->hb_wait = FALSE;
+      return;
+   }
+   hb = TAG_HBEAT;
+   iob->hb_wait = (send(fd, &hb, 1, MSG_NOSIGNAL) == 1);
+}
+
+// Act on the requests taken for one CA
+static void attn_serve(struct IO3705 *iob, int pend) {
+   int retry, merged;
    uint8_t carnstat;
    uint8_t ackbuf;
    ackbuf = 0x00;
+   carnstat = 0x00;                             // Host adds the attention bit
 
-   printf("\nCA-T2: ATTN thread %ld started succesfully...  \n\r", syscall(SYS_gettid));
+   retry = pend & ATTN_RETRY;
 
-   while (1) {
-      while (iob1->CA_active == FALSE && iob2->CA_active == FALSE)
+   // A new attention, or one the host kept cancelling, raises the L3 interrupt again
+   if (((pend & ATTN_PRA) && (iob->out[0x55] & 0x0200)) || (retry && iob->attn_tries > 3)) {
+      // Grab the lock to avoid sync issues
+      pthread_mutex_lock(&iob->lock);
+      if (debug_reg & 0x80)
+         printf("CA%c: L3 register 55 %04X \n\r", iob->CA_id, iob->out[0x55]);
+      iob->inp[0x55] |= 0x0200;                 // Set Program Requested Attention
+      pthread_mutex_lock(&r77_lock);
+      Eregs_Inp[0x77] |= iob->CA_mask;           // Set CA L3 Interrupt Request
+      pthread_mutex_unlock(&r77_lock);
+      iob->IS_req_L3 = ON;
+      cpu_wake();
+      STAT_INC(CA_STAT(iob->CA_id).l3_req);
+      while (Ireg_bit(0x77, iob->CA_mask) == ON)
          wait();
+      iob->out[0x55] &= ~0x0200;                // Reset attention request
+      pthread_mutex_unlock(&iob->lock);
+      // While the host has an attention it has not read for yet, the
+      // Read it is about to do takes this data too: no new attention
+      pthread_mutex_lock(&attn_lock);
+      merged = iob->attn_out;
+      iob->attn_retry = 0;
+      pthread_mutex_unlock(&attn_lock);
+      iob->attn_tries = 0;
+      iob->attn_backoff = 0;
+      if (merged) {
+         STAT_INC(CA_STAT(iob->CA_id).attn_merged);
+         retry = FALSE;
+      } else
+         retry = TRUE;
+   }
 
-      if (((Eregs_Out[0x55] & 0x0200) == 0x0200) || ackbuf == 0xF8 ) {
-         // Grab the lock to avoid sync issues
-         pthread_mutex_lock(&lock);
-         // Determine which CA needs to react
-         if ((Eregs_Out[0x57] & 0x0008) == 0x0008)
-            iob = iob1;
+   if (retry) {
+      pthread_mutex_lock(&iob->lock);
+      if (debug_reg & 0x80)
+         printf("CA%c: Sending Return status\n\r", iob->CA_id);
+      // Send CA retun status to host
+      send_carnstat(iob, iob->tag_socket[iob->abswitch], &carnstat, &ackbuf);
+      if (debug_reg & 0x80)
+         printf("CA%c: ACK received=%02X\n\r", iob->CA_id,ackbuf);
+      // Release the lock
+      pthread_mutex_unlock(&iob->lock);
+      if (ackbuf == 0x8F) {
+         STAT_INC(CA_STAT(iob->CA_id).attn);
+         pthread_mutex_lock(&attn_lock);
+         iob->attn_out = TRUE;
+         pthread_mutex_unlock(&attn_lock);
+         iob->attn_backoff = 0;
+      } else {
+         // Retry on a timer with doubling delay, the ATTN thread stays free for L3 requests
+         iob->attn_backoff = iob->attn_backoff ? iob->attn_backoff * 2 : ATTN_RETRY_MS;
+         if (iob->attn_backoff > ATTN_RETRY_MAX)
+            iob->attn_backoff = ATTN_RETRY_MAX;
+         if (++iob->attn_tries > 3)
+            printf("CA%c: Failed to inject ATTN, cancelled\n\r", iob->CA_id);
          else
-            iob = iob2;
-         if (debug_reg & 0x80)
-            printf("CA%c: L3 register 55 %04X \n\r", iob->CA_id, Eregs_Out[0x55]);
-         Eregs_Inp[0x55] |= 0x0200;              // Set Program Requested Attention
-         pthread_mutex_lock(&r77_lock);
-         Eregs_Inp[0x77] |= iob->CA_mask;        // Set CA1 L3 Interrupt Request                  // Chan Adap  L3 Interrupt request flag
-         pthread_mutex_unlock(&r77_lock);
-         CA1_IS_req_L3 = ON;   
-         while (Ireg_bit(0x77, iob->CA_mask) == ON)
-            wait();
-         Eregs_Out[0x55] &= ~0x0200;             // Reset attention request
-         if (debug_reg & 0x80)
-            printf("CA%c: Sending Return status\n\r", iob->CA_id);
-         // Send CA retun status to host
-         retry = 0;
-         while (retry < 4) {
-		      send_carnstat(iob->tag_socket[iob->abswitch], &carnstat, &ackbuf,iob->CA_id);
-            if (ackbuf == 0x8F) break;
-            printf("CA%c: Negative ACK received for ATTN, retrying in 1 sec...\n\r", iob->CA_id);
-            pthread_mutex_unlock(&lock);   //Free lock to solve possible deadlock
-            sleep(1);
-            retry++;
-            pthread_mutex_lock(&lock);    //Grab lock
-         }
-         if (retry > 3) printf("CA%c: Failed to inject ATTN, cancelled\n\r", iob->CA_id);
-         if (debug_reg & 0x80)
-            printf("CA%c: ACK received=%02X\n\r", iob->CA_id,ackbuf);
-         // Release the lock
-         pthread_mutex_unlock(&lock);
+            printf("CA%c: Negative ACK received for ATTN, retrying in %d msec...\n\r", iob->CA_id, iob->attn_backoff);
+         pthread_mutex_lock(&attn_lock);
+         iob->attn_retry = attn_now_ns() + iob->attn_backoff * 1000000ULL;
+         pthread_mutex_unlock(&attn_lock);
       }
+   }
 
-      // Check if the 3705 has requested the CA to request a L3 interrupt
-      if ((Eregs_Out[0x57] & 0x0080) == 0x0080) {
-         // Grab the lock to avoid sync issues
-         pthread_mutex_lock(&lock);
-         // Determine which CA needs to react
-         if ((Eregs_Out[0x57] & 0x0008) == 0x0008)
-           iob = iob1;
-         else
-           iob = iob2;
-         if (debug_reg & 0x80)
-            printf("CA%c: L3 register 57 %04X \n\r", iob->CA_id, Eregs_Out[0x57]);
-         while (Ireg_bit(0x77, iob->CA_mask) == ON)
-            wait();
-         Eregs_Inp[0x55] |= 0x0800;              // Set Program Requested L3 interrupt
-         Eregs_Out[0x55] |= 0x3000;              // Set INCWAR and OUTCWAR valid for IPL
-         pthread_mutex_lock(&r77_lock);
-         Eregs_Inp[0x77] |= iob->CA_mask;        // Set CA L3 interrupt request
-         pthread_mutex_unlock(&r77_lock);
-         CA1_IS_req_L3 = ON;
-         if (debug_reg & 0x80)
-            printf("CA%c: Requested L3 interrupt\n\r", iob->CA_id);
-         while (Ireg_bit(0x77, iob->CA_mask) == ON) wait();
-            wait();
-         Eregs_Out[0x57] &= ~0x0080;             // Reset attention request
+   // Check if the 3705 has requested the CA to request a L3 interrupt
+   if ((pend & ATTN_L3) && (Eregs_Out[0x57] & 0x0080)) {
+      // Grab the lock to avoid sync issues
+      pthread_mutex_lock(&iob->lock);
+      if (debug_reg & 0x80)
+         printf("CA%c: L3 register 57 %04X \n\r", iob->CA_id, Eregs_Out[0x57]);
+      while (Ireg_bit(0x77, iob->CA_mask) == ON)
+         wait();
+      iob->inp[0x55] |= 0x0800;                 // Set Program Requested L3 interrupt
+      iob->out[0x55] |= 0x3000;                 // Set INCWAR and OUTCWAR valid for IPL
+      pthread_mutex_lock(&r77_lock);
+      Eregs_Inp[0x77] |= iob->CA_mask;           // Set CA L3 interrupt request
+      pthread_mutex_unlock(&r77_lock);
+      iob->IS_req_L3 = ON;
+      cpu_wake();
+      STAT_INC(CA_STAT(iob->CA_id).l3_req);
+      if (debug_reg & 0x80)
+         printf("CA%c: Requested L3 interrupt\n\r", iob->CA_id);
+      while (Ireg_bit(0x77, iob->CA_mask) == ON)
+         wait();
+      Eregs_Out[0x57] &= ~0x0080;                // Reset attention request
+      // Release the lock
+      pthread_mutex_unlock(&iob->lock);
+   }
 
-         // Send CA retun status to host
-         // Release the lock
-         pthread_mutex_unlock(&lock);
+   if (pend & ATTN_HBEAT)
+      ca_heartbeat(iob);
+}
+
+// ************************************************************
+// Thread for sending Attention interrupts to the host
+// or Level 3 interrupts to the NCP
+// ************************************************************
+
+void *CA_ATTN_thread(void *pthrargs) {
+   int pend1, pend2;
+   uint64_t now, due;
+   struct timespec ts;
+
+   printf("\nCA-T2: ATTN thread %ld started succesfully...  \n\r", syscall(SYS_gettid));
+   stats_thread("ATTN");
+
+   while (1) {
+      // Sleep until the CCU posts a request, a held attention is due
+      // or a cancelled attention is due again, on either CA
+      pthread_mutex_lock(&attn_lock);
+      while (1) {
+         now = attn_now_ns();
+         due = 0;
+         pend1 = attn_take(iob1, now, &due);
+         pend2 = attn_take(iob2, now, &due);
+         if (pend1 || pend2)
+            break;
+         if (due) {
+            ts.tv_sec  = due / 1000000000ULL;
+            ts.tv_nsec = due % 1000000000ULL;
+            pthread_cond_timedwait(&cond, &attn_lock, &ts);
+         } else
+            pthread_cond_wait(&cond, &attn_lock);
       }
+      pthread_mutex_unlock(&attn_lock);
+
+      if (pend1)
+         attn_serve(iob1, pend1);
+      if (pend2)
+         attn_serve(iob2, pend2);
    }
    return 0;
 }
@@ -512,17 +999,26 @@ void *CA_T2_thread(void *arg) {
    } epoll_Data_t;
 
    printf("\nCA-T2: Main thread %ld started succesfully...  \n", syscall(SYS_gettid));
+   stats_thread("CA-T2");
 
-   pthread_t id1, id2, id3;
+   pthread_t id1 = 0, id2 = 0, id3;
    args = malloc(sizeof(struct pth_args) * 1);
-   iob1 = malloc(sizeof(struct IO3705) * 1);
-   iob2 = malloc(sizeof(struct IO3705) * 1);
    iob1->CA_id = '1';
    iob1->abswitch = 0;                 // A/B switch for CA1 defaults to A
    iob1->CA_mask = 0x0008;             // CA1 select mask
    iob2->CA_id = '2';
    iob2->abswitch = 0;                 // A/B switch for CA2 defaults to A
    iob2->CA_mask = 0x0020;             // CA2 select mask
+   iob1->inp = Eregs_Inp;              // CA1 registers are the CCU's own
+   iob1->out = Eregs_Out;
+   iob2->inp = CA2_Inp;
+   iob2->out = CA2_Out;
+   pthread_mutex_init(&iob1->lock, NULL);
+   pthread_mutex_init(&iob2->lock, NULL);
+   pthread_mutex_init(&iob1->ccw_lock, NULL);
+   pthread_cond_init(&iob1->ccw_cond, NULL);
+   pthread_mutex_init(&iob2->ccw_lock, NULL);
+   pthread_cond_init(&iob2->ccw_cond, NULL);
    args->arg1 = iob1;
    args->arg2 = iob2;
 
@@ -539,6 +1035,9 @@ void *CA_T2_thread(void *arg) {
    iob2->CA_active = FALSE;
    iob1->abswhist = CAB;               // This forces a listen on CA1 port A
    iob2->abswhist = CAB;               // This forces a listen on CA2 port A
+   shm_open_ca(iob1);                  // Unless it is on shared memory
+   shm_open_ca(iob2);
+   ca_started = TRUE;
 
 
    pthread_create(&id3, NULL, CA_ATTN_thread, args);
@@ -548,23 +1047,28 @@ void *CA_T2_thread(void *arg) {
       printf("\nCA_T2: failed to created epoll file descriptor\n\r");
       return 0;
    }
+   ca_wake_fd = eventfd(0, EFD_NONBLOCK);
+   event.events = EPOLLIN;
+   event.data.fd = ca_wake_fd;
+   if (ca_wake_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, ca_wake_fd, &event))
+      printf("\nCA_T2: failed to create reactor wakeup, error %s\n\r", strerror(errno));
 
    while(1) {
       // check if the CA1 A/B switch has been thrown
-      if (iob1->abswhist != iob1->abswitch) {
+      if (iob1->abswhist != iob1->abswitch && ca_shm[0] == NULL) {
          close_socket(iob1, iob1->abswhist);     // Close previous port
          start_listen(iob1, iob1->abswitch);     // Listen and add polling
          iob1->abswhist = iob1->abswitch;
       }
 
       // check if the CA2 A/B switch has been thrown
-      if (iob2->abswhist != iob2->abswitch) {
+      if (iob2->abswhist != iob2->abswitch && ca_shm[1] == NULL) {
          close_socket(iob2,iob2->abswhist);      // Close previous port
          start_listen(iob2, iob2->abswitch);     // Listen and add polling
          iob2->abswhist = iob2->abswitch;
       }
 
-      if (!IsSocketConnected(iob1->CA_socket[iob1->abswitch])) {
+      if (ca_shm[0] == NULL && !IsSocketConnected(iob1->CA_socket[iob1->abswitch])) {
          event.events = EPOLLIN | EPOLLONESHOT;
          event.data.fd = iob1->CA_socket[iob1->abswitch];
          if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, iob1->CA_socket[iob1->abswitch], &event)) {
@@ -574,7 +1078,7 @@ void *CA_T2_thread(void *arg) {
          }
       }
 
-      if (!IsSocketConnected(iob2->CA_socket[iob2->abswitch])) {
+      if (ca_shm[1] == NULL && !IsSocketConnected(iob2->CA_socket[iob2->abswitch])) {
          event.events = EPOLLIN | EPOLLONESHOT;
          event.data.fd = iob2->CA_socket[iob2->abswitch];
          if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, iob2->CA_socket[iob2->abswitch], &event)) {
@@ -584,18 +1088,75 @@ void *CA_T2_thread(void *arg) {
          }
       }
 
-      event_count = epoll_wait(epoll_fd, events, MAXPORTS, 5000);
+      // Shared memory CA's have no listen socket: poll for a host attach
+      event_count = epoll_wait(epoll_fd, events, MAXPORTS, (ca_shm[0] || ca_shm[1]) ? SHM_WAIT_MS : 5000);
+
+      if (ca_shm[0] && shm_connect(iob1) == 0) {
+         // Get device number
+         rc = read_socket(iob1->bus_socket[iob1->abswitch], iob1->cmd, sizeof(iob1->cmd));
+         if (rc > 0) {
+            iob1->devnum = (iob1->cmd[0] << 8) | iob1->cmd[1];
+            printf("CA%c: Connected to device %04X\n\r", iob1->CA_id, iob1->devnum);
+            if (id1 != 0)
+               sig = pthread_kill(id1, SIGCONT);
+            if (id1 == 0 || sig != 0) {
+               iob1->ccw_ready = FALSE;
+               pthread_create(&id1, NULL, CAx_thread, iob1);
+               CAx_tid[0] = id1;
+            }
+         } else {
+            iob1->bus_socket[iob1->abswitch] = -1;
+            iob1->tag_socket[iob1->abswitch] = -1;
+         }
+      }
+
+      if (ca_shm[1] && shm_connect(iob2) == 0) {
+         // Get device number
+         rc = read_socket(iob2->bus_socket[iob2->abswitch], iob2->cmd, sizeof(iob2->cmd));
+         if (rc > 0) {
+            iob2->devnum = (iob2->cmd[0] << 8) | iob2->cmd[1];
+            printf("CA%c: Connected to device %04X\n\r", iob2->CA_id, iob2->devnum);
+            if (id2 != 0)
+               sig = pthread_kill(id2, SIGCONT);
+            if (id2 == 0 || sig != 0) {
+               iob2->ccw_ready = FALSE;
+               pthread_create(&id2, NULL, CAx_thread, iob2);
+               CAx_tid[1] = id2;
+            }
+         } else {
+            iob2->bus_socket[iob2->abswitch] = -1;
+            iob2->tag_socket[iob2->abswitch] = -1;
+         }
+      }
 
       for (int i = 0; i < event_count; i++) {
 
+         // Woken up to look at the A/B switches again
+         if (events[i].data.fd == ca_wake_fd) {
+            uint64_t n;
+            if (read(ca_wake_fd, &n, sizeof(n)) < 0 && errno != EAGAIN)
+               printf("\nCA_T2: Reactor wakeup read failed with error %s\n\r", strerror(errno));
+            continue;
+         }
+
+         // A CCW (or a hangup) on the bus socket of an idle CA
+         if (iob1->CA_active == TRUE && events[i].data.fd == iob1->bus_socket[iob1->abswitch]) {
+            ca_ring_ccw(iob1);
+            continue;
+         }
+         if (iob2->CA_active == TRUE && events[i].data.fd == iob2->bus_socket[iob2->abswitch]) {
+            ca_ring_ccw(iob2);
+            continue;
+         }
+
          if ((events[i].data.fd == iob1->CA_socket[CAA]) && (iob1->abswitch == 0)) {
             // Accept the incoming connection
             rc = host_connect(iob1, CAA);
             if (rc == 0) {
                // Get device number
-               rc = read_socket(iob1->bus_socket[iob1->abswitch], iob1->buffer, sizeof(iob1->buffer));
+               rc = read_socket(iob1->bus_socket[iob1->abswitch], iob1->cmd, sizeof(iob1->cmd));
                if (rc != 0) {
-                  iob1->devnum = (iob1->buffer[0] << 8) | iob1->buffer[1];
+                  iob1->devnum = (iob1->cmd[0] << 8) | iob1->cmd[1];
                   printf("CA1: Connected to device %04X\n\r", iob1->devnum);
 
                   if (id1 != 0) {
@@ -603,8 +1164,8 @@ void *CA_T2_thread(void *arg) {
                      printf("CA1: Thread check result %d\n\r", sig);
                   }
                   if (id1 == 0 || sig != 0) {
-                     args->arg1 = iob1;
-                     pthread_create(&id1, NULL, CAx_thread, args);
+                     iob1->ccw_ready = FALSE;
+                     pthread_create(&id1, NULL, CAx_thread, iob1);
                      printf("CA1: Started. Thread id %p\n\r", id1);
                      CAx_tid[0] = id1;
                   }
@@ -621,9 +1182,9 @@ void *CA_T2_thread(void *arg) {
             rc = host_connect(iob1, CAB);
             if (rc == 0) {
                // Get device number
-               rc = read_socket(iob1->bus_socket[iob1->abswitch], iob1->buffer, sizeof(iob1->buffer));
+               rc = read_socket(iob1->bus_socket[iob1->abswitch], iob1->cmd, sizeof(iob1->cmd));
                if (rc != 0) {
-                  iob1->devnum = (iob1->buffer[0] << 8) | iob1->buffer[1];
+                  iob1->devnum = (iob1->cmd[0] << 8) | iob1->cmd[1];
                   printf("CA%c: Connected to device %04X\n\r", iob1->CA_id, iob1->devnum);
 
                   if (id1 != 0) {
@@ -631,8 +1192,8 @@ void *CA_T2_thread(void *arg) {
                      printf("CA%c: Thread check result %d\n\r", iob1->CA_id, sig);
                   }
                   if (id1 == 0 || sig != 0) {
-                     args->arg1 = iob1;
-                     pthread_create(&id1, NULL, CAx_thread, args);
+                     iob1->ccw_ready = FALSE;
+                     pthread_create(&id1, NULL, CAx_thread, iob1);
                      printf("CA%c: Started. Thread id %p\n\r", iob1->CA_id, id1);
                      CAx_tid[0] = id1;
                   }
@@ -649,18 +1210,18 @@ void *CA_T2_thread(void *arg) {
             rc = host_connect(iob2, CAA);
             if (rc == 0) {
                // Get device number
-               rc = read_socket(iob2->bus_socket[iob2->abswitch], iob2->buffer, sizeof(iob2->buffer));
+               rc = read_socket(iob2->bus_socket[iob2->abswitch], iob2->cmd, sizeof(iob2->cmd));
                if (rc != 0) {
-                  iob2->devnum = (iob2->buffer[0] << 8) | iob2->buffer[1];
+                  iob2->devnum = (iob2->cmd[0] << 8) | iob2->cmd[1];
                   printf("CA%c: Connected to device %04X\n\r", iob2->CA_id, iob2->devnum);
 
                   if (id2 != 0) {
                      sig  = pthread_kill(id2, SIGCONT);
                      printf("CA%c: Thread check result %d\n\r", iob2->CA_id, sig);
                   }
-                  if (id1 == 0 || sig != 0) {
-                     args->arg1 = iob2;
-                     pthread_create(&id2, NULL, CAx_thread, args);
+                  if (id2 == 0 || sig != 0) {
+                     iob2->ccw_ready = FALSE;
+                     pthread_create(&id2, NULL, CAx_thread, iob2);
                      printf("CA%c: Started. Thread id %p\n\r", iob2->CA_id, id2);
                      CAx_tid[1] = id2;
                   }
@@ -677,18 +1238,18 @@ void *CA_T2_thread(void *arg) {
             rc = host_connect(iob2, CAB);
             if (rc == 0) {
                // Get device number
-               rc = read_socket(iob2->bus_socket[iob2->abswitch], iob2->buffer, sizeof(iob2->buffer));
+               rc = read_socket(iob2->bus_socket[iob2->abswitch], iob2->cmd, sizeof(iob2->cmd));
                if (rc != 0) {
-                  iob2->devnum = (iob2->buffer[0] << 8) | iob2->buffer[1];
+                  iob2->devnum = (iob2->cmd[0] << 8) | iob2->cmd[1];
                   printf("CA%c: Connected to device %04X\n\r", iob2->CA_id, iob2->devnum);
 
                   if (id2 != 0) {
                      sig  = pthread_kill(id2, SIGCONT);
                      printf("CA%c: Thread check result %d\n\r", iob2->CA_id, sig);
                   }
-                  if (id1 == 0 || sig != 0) {
-                     args->arg1 = iob2;
-                     pthread_create(&id2, NULL, CAx_thread, args);
+                  if (id2 == 0 || sig != 0) {
+                     iob2->ccw_ready = FALSE;
+                     pthread_create(&id2, NULL, CAx_thread, iob2);
                      printf("CA%c: Started. Thread id %p\n\r", iob2->CA_id, id2);
                      CAx_tid[1] = id2;
                   }
@@ -716,36 +1277,38 @@ void *CA_T2_thread(void *arg) {
 /* Function to be run as a thread always must have the same
    signature: it has one void* parameter and returns void    */
 void *CAx_thread(void *pthargs) {
-   struct pth_args *args = pthargs;
-   struct IO3705 *iob = args->arg1;
+   struct IO3705 *iob = pthargs;
 
    int rc;
    int cc = 0;
    int sockfc = -1;
-   int bufbase, condition;
+   int bufbase, condition, niov, n, remain, rd_uchk;
+   uint8_t rdlen[2];
+   struct iovec iov[CA_IOV + 1];
    pthread_t id;
-   char carnstat, ackbuf;
-   uint16_t incwar, outcwar, wdcnt, wdcnttmp, wdcnttot, cacw1, cacw2;
+   uint8_t carnstat, ackbuf;
+   char sense;
+   uint16_t incwar, outcwar, wdcnt = 0, wdcnttmp = 0, wdcnttot, cacw1, cacw2;
+   uint64_t ccw_start;
 
    printf("\nCA%c: thread %d started sucessfully... \n\r", iob->CA_id, getpid());
-
-   // Init the lock
-   if (pthread_mutex_init(&lock, NULL) != 0)  {
-      printf("\nCA%c: Lock initialization failed \n\r", iob->CA_id);
-      exit(EXIT_FAILURE);
-   }
+   stats_thread((iob->CA_id == '1') ? "CA1" : "CA2");
 
    pthread_mutex_lock(&r77_lock);
-   Eregs_Inp[0x77] &= ~0x0028;         // Reset CA1 L3 interrupt
+   Eregs_Inp[0x77] &= ~iob->CA_mask;   // Reset CA L3 interrupt
    pthread_mutex_unlock(&r77_lock);
-   CA1_DS_req_L3 = OFF;                // Chan Adap Data/Status request flag
-   CA1_IS_req_L3 = OFF;                // Chan Adap Initial Sel request flag
-   Eregs_Inp[0x55]  = 0x0000;          // Reset CA control register
-   Eregs_Inp[0x58] |= 0x0008;          // Enable CA I/F A
-   Eregs_Inp[0x55] |= 0x0010;          // Flag System Reset
+   iob->DS_req_L3 = OFF;               // Chan Adap Data/Status request flag
+   iob->IS_req_L3 = OFF;               // Chan Adap Initial Sel request flag
+   iob->inp[0x55]  = 0x0000;          // Reset CA control register
+   iob->inp[0x58] |= 0x0008;          // Enable CA I/F A
+   iob->inp[0x55] |= 0x0010;          // Flag System Reset
 
    // Change the CA status to active
+   pthread_mutex_lock(&attn_lock);
+   iob->hb_next = 0;                   // First heartbeat half a failover time from now
+   pthread_mutex_unlock(&attn_lock);
    iob->CA_active = TRUE;
+   ca_attn_post(0);                    // Let the ATTN thread look at pending requests
 
    while(1) {
       // We do this for ever and ever...
@@ -761,92 +1324,115 @@ void *CAx_thread(void *pthargs) {
          return 0;
       }
 
-      rc = read_socket( iob->bus_socket[iob->abswitch], iob->buffer, sizeof(iob->buffer));
+      if (ca_shm[iob->CA_id - '1'] == NULL)
+         ca_wait_ccw(iob);               // Sleep until the reactor sees the CCW
+      rc = read_socket( iob->bus_socket[iob->abswitch], iob->cmd, sizeof(iob->cmd));
 
-      if (rc == 0) {
+      if (rc <= 0) {
          // Host disconnected, get details and print it
          printf("\nCA%c: Error reading CCW, closing channel connection\n\r", iob->CA_id);
+         STAT_INC(CA_STAT(iob->CA_id).sock_err);
          // Change the CA status to inactive
          iob->CA_active = FALSE;
 
          // Close the bus and tag socket and mark for reuse
-         close(iob->bus_socket[iob->abswitch]);
-         close(iob->tag_socket[iob->abswitch]);
+         ch_close(iob->bus_socket[iob->abswitch]);
+         ch_close(iob->tag_socket[iob->abswitch]);
 
          iob->bus_socket[iob->abswitch] = -1;
          iob->tag_socket[iob->abswitch] = -1;
+         if (ca_failover_ms[iob->CA_id - '1'] != 0 && ca_shm[iob->CA_id - '1'] == NULL)
+            ca_failover(iob);           // Hot standby host takes over on the other port
       } else {
          // Grab the lock to avoid sync issues
-         rc = pthread_mutex_lock(&lock);
+         rc = pthread_mutex_lock(&iob->lock);
          if (debug_reg & 0x80)
                printf("CA%c: Allocate main lock, rc = %d \n\r", iob->CA_id,rc);
 
          // All data transfers are preceded by a CCW.
-         ccw.code  =  0x00;
-         ccw.code  =  iob->buffer[0];
-         ccw.flags =  iob->buffer[4];
-         ccw.chain =  iob->buffer[5];
-         ccw.count = (iob->buffer[6] << 8) | iob->buffer[7];
-
-         Eregs_Inp[0x5A] = ccw.code << 8;        // Set Chan command in CA Data Buffer
-         Eregs_Inp[0x5C] &= ~0xFFFF;             // Clear command flags CA Command Register
+         ccw_start =  stats_now_ns();
+         iob->ccw.code  =  0x00;
+         iob->ccw.code  =  iob->cmd[0];
+         iob->ccw.flags =  iob->cmd[4];
+         iob->ccw.chain =  iob->cmd[5];
+         iob->ccw.count = (iob->cmd[6] << 8) | iob->cmd[7];
+         STAT_INC(CA_STAT(iob->CA_id).ccw[iob->ccw.code]);
+
+         iob->inp[0x5A] = iob->ccw.code << 8;        // Set Chan command in CA Data Buffer
+         iob->inp[0x5C] &= ~0xFFFF;             // Clear command flags CA Command Register
          if (debug_reg & 0x80)
             printf("\nCA%c: Channel Command: %02X, length: %d, Flags: %02X, Chained: %02X \n\r",
-                iob->CA_id, ccw.code, ccw.count, ccw.flags, ccw.chain);
+                iob->CA_id, iob->ccw.code, iob->ccw.count, iob->ccw.flags, iob->ccw.chain);
          // Send an ACK to the host
          send_ack(iob->bus_socket[iob->abswitch]);
 
          // **************************************************************
          // Check and process channel command.
          // **************************************************************
-         switch (ccw.code) {
+         switch (iob->ccw.code) {
             case 0x00:       // Test I/O
-               Eregs_Inp[0x5C] |= 0x8000;                  // Set CA Command Register
+               iob->inp[0x5C] |= 0x8000;                  // Set CA Command Register
                // Send channel end and device end to the host. Sufficient for now (might need to send x00).
                // Send CA return status to host
-               carnstat = ((Eregs_Out[0x54] >> 8 ) & 0x00FF);  // Get CA return status
-               send_carnstat(iob->bus_socket[iob->abswitch], &carnstat, &ackbuf, iob->CA_id);
+               carnstat = ((iob->out[0x54] >> 8 ) & 0x00FF);  // Get CA return status
+               send_carnstat(iob, iob->bus_socket[iob->abswitch], &carnstat, &ackbuf);
                break;
 
             case 0x02:       // Read
-               Eregs_Inp[0x55] |= 0x0100;                  // Set Channel Active
-               Eregs_Inp[0x5C] |= 0x2000;                  // Set CA Command Register
-               Eregs_Inp[0x53] &= 0x0000;                  // Reset sense register
-
-               while (reg_bit(0x55, 0x1000) == OFF)
+               pthread_mutex_lock(&attn_lock);
+               iob->attn_out = FALSE;                      // Attentions from now on need a new Read
+               pthread_mutex_unlock(&attn_lock);
+               iob->inp[0x55] |= 0x0100;                  // Set Channel Active
+               iob->inp[0x5C] |= 0x2000;                  // Set CA Command Register
+               iob->inp[0x53] &= 0x0000;                  // Reset sense register
+
+               while ((iob->out[0x55] & 0x1000) == 0)
                   wait();                                  // Wait for OUTCWAR to become valid
-               bufbase = 0;                                // Set buffer base...
+               niov = 1;                                   // Storage segments to send after the length...
+               rd_uchk = FALSE;
                wdcnttot = 0;                               // ... we will need this in case of chaining
+               remain = iob->ccw.count;                         // Room left in the host's Read buffer
 
                do {   // While condition remains 0
                   condition = 0;
-                  outcwar = Eregs_Out[0x51];
-                  cacw1 = (M[outcwar] << 8) | M[outcwar+1] & 0x00FF;      // Get first half of CA Control word
+                  outcwar = iob->out[0x51];
+                  cacw1 = mem_rd16(outcwar);                               // Get first half of CA Control word
                   wdcnt = (cacw1 >> 2) & 0x03FF;           // Fetch Counter
-                  Eregs_Inp[0x52] &= 0x0000;               // Clear Byte Count Register
-                  Eregs_Inp[0x52] = wdcnt;
-                  cacw2 = ((M[outcwar+2] << 8) | M[outcwar+3] & 0x00FF)
+                  iob->inp[0x52] &= 0x0000;               // Clear Byte Count Register
+                  iob->inp[0x52] = wdcnt;
+                  cacw2 = mem_rd16(outcwar+2)
                             + (cacw1 << 14);               // Get data fetch address
                   if (debug_reg & 0x80)
                      printf("OUTCWAR %04X, CW %02X%02X %02X%02X\n\r",
                           outcwar, M[outcwar], M[outcwar+1], M[outcwar+2], M[outcwar+3]);
-                  Eregs_Out[0x51] = Eregs_Out[0x51] + 4;
+                  iob->out[0x51] = iob->out[0x51] + 4;
 
-                  Eregs_Inp[0x5C] |= 0x0080;               // Set command register to OUT Control Word
-                  Eregs_Inp[0x59]  = cacw2;                // Load cycle steal address with data load start address
+                  iob->inp[0x5C] |= 0x0080;               // Set command register to OUT Control Word
+                  iob->inp[0x59]  = cacw2;                // Load cycle steal address with data load start address
                   if (debug_reg & 0x80) {
                      printf("CW %04X\n\r", cacw1);
                      printf("Fetch starts at %04X, count = %04X\n\r", cacw2, wdcnt);
                   }
-                  wdcnttmp = wdcnt;                        // Bytes to be transferred for this CW
-                  wdcnttot = wdcnttot + wdcnt;             // Total byte count
-                  for (i = 0; i < wdcnttmp; i++) {
-                     data_buffer[bufbase+i] = M[cacw2+i];  // Load data directly into memory
-                     Eregs_Inp[0x59] = Eregs_Inp[0x59] + 1;  // Increment cycle steal counter
-                     wdcnt = wdcnt - 1;                    // Decrement byte counter
-                     Eregs_Inp[0x52] = Eregs_Inp[0x52] - 1;
-                  }  // End for stmt
-                  bufbase = bufbase + i;                   // Point after last byte stored in buffer
+                  // Cycle steal the whole CW at once: the data is sent straight from storage.
+                  // The host's CCW count ends the transfer, the rest stays in the byte count.
+                  n = wdcnt < remain ? wdcnt : remain;
+                  n = cs_len(iob, cacw2, n);
+                  if (n > 0 && niov > CA_IOV)              // iov full: fold it into iob->buffer
+                     niov = ca_iov_fold(iob, iov, niov);
+                  if (n > 0 && niov <= CA_IOV) {
+                     iov[niov].iov_base = &M[cacw2];
+                     iov[niov].iov_len = n;
+                     niov++;
+                     wdcnttot = wdcnttot + n;              // Total byte count
+                  } else if (n > 0 && !rd_uchk) {
+                     printf("\nCA%c: No storage to gather Read data, unit check \n\r", iob->CA_id);
+                     STAT_INC(CA_STAT(iob->CA_id).sock_err);
+                     rd_uchk = TRUE;                       // The rest of the data is lost
+                  }
+                  remain = remain - n;
+                  iob->inp[0x59] = iob->inp[0x59] + n;  // Cycle steal address past the data
+                  iob->inp[0x52] = iob->inp[0x52] - n;
+                  wdcnt = wdcnt - n;
 
                   if (cacw1 & 0x4000) {                    // If OUT STOP
                      if ((cacw1 & 0x1000) && !(cacw1 & 0x2000))  // Chaining On, Zero Override Off
@@ -855,13 +1441,23 @@ void *CAx_thread(void *pthargs) {
                         condition = 1;
                      if ((cacw1 & 0x3000) == 0x3000) {     // Chaning On, Zero Override On
                         condition = 0;
+                        // The L3 lets the NCP reuse the buffers gathered so far: copy them first
+                        if (niov > 1 && (niov = ca_iov_fold(iob, iov, niov)) > 2) {
+                           printf("\nCA%c: No storage to gather Read data, unit check \n\r", iob->CA_id);
+                           STAT_INC(CA_STAT(iob->CA_id).sock_err);
+                           rd_uchk = TRUE;                 // The data so far is lost
+                           niov = 1;
+                           wdcnttot = 0;
+                        }
                         while (Ireg_bit(0x77, iob->CA_mask) == ON)
                            wait();                         // Wait for CA1 L3 interrupt reset
                         pthread_mutex_lock(&r77_lock);
                         Eregs_Inp[0x77] |= iob->CA_mask;   // Set CA1 L3 interrupt
                         pthread_mutex_unlock(&r77_lock);
-                        CA1_IS_req_L3 = ON;                // Chan Adap Initial Sel request flag
-                        while (Ireg_bit(0x77, 0x008) == ON)
+                        iob->IS_req_L3 = ON;                // Chan Adap Initial Sel request flag
+                        cpu_wake();
+                        STAT_INC(CA_STAT(iob->CA_id).l3_req);
+                        while (Ireg_bit(0x77, iob->CA_mask) == ON)
                            wait();                         // Wait for initial selection reset
                      }
                   } else {
@@ -872,43 +1468,64 @@ void *CAx_thread(void *pthargs) {
                      if (cacw1 & 0x2000)                   // Zero Override On
                         condition = 3;
                   }
+                  if (remain == 0 && condition == 0) {
+                     condition = 1;                        // Host count exhausted...
+                     iob->inp[0x55] |= 0x0020;            // ...set channel stop
+                  }
                   if (debug_reg & 0x80)
                      printf("Condition = %d\n\r", condition);
 
                }  while (condition == 0);   // End of do stmt.
 
+               // Send the data before the final L3 interrupt lets the NCP reuse its buffers.
+               // The length goes first, so the host knows where the data ends however
+               // the transport splits it.
+               rdlen[0] = wdcnttot >> 8;
+               rdlen[1] = wdcnttot & 0xFF;
+               iov[0].iov_base = rdlen;
+               iov[0].iov_len = 2;
+               rc = ch_sendv(iob->bus_socket[iob->abswitch], iov, niov);
+               if (rc > 2) {
+                  STAT_ADD(CA_STAT(iob->CA_id).bytes_out, rc - 2);
+                  lat_chan_read();
+               } else if (rc < 0)
+                  STAT_INC(CA_STAT(iob->CA_id).sock_err);
+
                if (condition != 2) {
                   while (Ireg_bit(0x77, iob->CA_mask) == ON)
                      wait();                               // Wait for CA1 L3 interrupt reset
                   pthread_mutex_lock(&r77_lock);
                   Eregs_Inp[0x77] |= iob->CA_mask;         // Set CA1  L3 interrupt
                   pthread_mutex_unlock(&r77_lock);
-                  CA1_IS_req_L3 = ON;                      // Chan Adap Initial Sel request flag
-                  while (Ireg_bit(0x77, 0x008) == ON)
+                  iob->IS_req_L3 = ON;                      // Chan Adap Initial Sel request flag
+                  cpu_wake();
+                  STAT_INC(CA_STAT(iob->CA_id).l3_req);
+                  while (Ireg_bit(0x77, iob->CA_mask) == ON)
                      wait();                               // Wait for initial selection reset
                }
 
-               rc = send(iob->bus_socket[iob->abswitch], (void*)&data_buffer, wdcnttot,0);
                // Wait for the ACK from the host
                recv_ack(iob->bus_socket[iob->abswitch]);
 
                // Send CA return status to host
                if (condition != 3) {
-                  carnstat = ((Eregs_Out[0x54] >> 8 ) & 0x00FF);  // Get CA return status
+                  carnstat = ((iob->out[0x54] >> 8 ) & 0x00FF);  // Get CA return status
                   if (condition == 2)
                      carnstat = CSW_DEND;
-                  send_carnstat(iob->bus_socket[iob->abswitch], &carnstat, &ackbuf, iob->CA_id);
+                  if (rd_uchk)
+                     carnstat |= CSW_UCHK;                 // Read data was cut short
+                  send_carnstat(iob, iob->bus_socket[iob->abswitch], &carnstat, &ackbuf);
                }
                break;
 
             case 0x03:       // NO-OP ?
-               Eregs_Inp[0x5C] |= 0x0100;                  // Set CA Command Register
+               iob->inp[0x5C] |= 0x0100;                  // Set CA Command Register
                // Send channel end and device end to host. Sufficient for now (might need to send x00).
                while (Ireg_bit(0x77, iob->CA_mask) == ON)
                   wait();                                  // Wait for CA1 L3 interrupt request reset
                carnstat = 0x00;
                carnstat |= CSW_DEND;
-               send_carnstat(iob->bus_socket[iob->abswitch], &carnstat, &ackbuf, iob->CA_id);
+               send_carnstat(iob, iob->bus_socket[iob->abswitch], &carnstat, &ackbuf);
                break;
 
             case 0x04:       // Sense ?
@@ -917,114 +1534,131 @@ void *CAx_thread(void *pthargs) {
                pthread_mutex_lock(&r77_lock);
                Eregs_Inp[0x77] |= iob->CA_mask;            // Set CA1 L3 interrupt request
                pthread_mutex_unlock(&r77_lock);
-               CA1_IS_req_L3 = ON;                         // Chan Adap L3 request flag
+               iob->IS_req_L3 = ON;                         // Chan Adap L3 request flag
+               cpu_wake();
+               STAT_INC(CA_STAT(iob->CA_id).l3_req);
                while (Ireg_bit(0x77, iob->CA_mask) == ON)
                   wait();                                  // Wait for L3 interrupt request reset
-               data_buffer[0] = Eregs_Out[0x53] >> 8;      // Load sense data byte 0
+               sense = iob->out[0x53] >> 8;                // Load sense data byte 0
                if (debug_reg & 0x80)
-                  printf("CA%c: Sending sense Byte 0 %02X \n\r", iob->CA_id, data_buffer[0]);
+                  printf("CA%c: Sending sense Byte 0 %02X \n\r", iob->CA_id, sense);
 
-               rc = send_socket(iob->bus_socket[iob->abswitch], (void*)&data_buffer, 1);
+               rc = send_socket(iob->bus_socket[iob->abswitch], (void*)&sense, 1);
                // Wait for the ACK from the host
                recv_ack(iob->bus_socket[iob->abswitch]);
 
                // Send CA return status to host
-               carnstat = ((Eregs_Out[0x54] >> 8 ) & 0x00FF);  // Get CA return status
-               send_carnstat(iob->bus_socket[iob->abswitch], &carnstat, &ackbuf, iob->CA_id);
+               carnstat = ((iob->out[0x54] >> 8 ) & 0x00FF);  // Get CA return status
+               send_carnstat(iob, iob->bus_socket[iob->abswitch], &carnstat, &ackbuf);
                break;
 
             case 0x05:       // IPL command
             case 0x01:       // Write
             case 0x09:       // Write Break
-               Eregs_Inp[0x53] &= 0x0000;                  // Reset sense register
-               switch (ccw.code) {
+               iob->inp[0x53] &= 0x0000;                  // Reset sense register
+               switch (iob->ccw.code) {
                   case 0x01:
-                     Eregs_Inp[0x5C] |= 0x4000;            // Set CA Command Register
-                     Eregs_Inp[0x55] |= 0x0100;            // Set Channel Active
+                     iob->inp[0x5C] |= 0x4000;            // Set CA Command Register
+                     iob->inp[0x55] |= 0x0100;            // Set Channel Active
                      break;
                   case 0x05:
-                     Eregs_Inp[0x5C] |= 0x0001;            // Set CA Command Register
+                     iob->inp[0x5C] |= 0x0001;            // Set CA Command Register
                      while (Ireg_bit(0x77, iob->CA_mask) == ON)
                          wait();                           // Wait for CA1 L3 request reset
                      pthread_mutex_lock(&r77_lock);
                      Eregs_Inp[0x77] |= iob->CA_mask;      // Set CA1 L3 interrupt request
                      pthread_mutex_unlock(&r77_lock);
-                     CA1_IS_req_L3 = ON;
+                     iob->IS_req_L3 = ON;
+                     cpu_wake();
+                     STAT_INC(CA_STAT(iob->CA_id).l3_req);
                      break;
                   case 0x09:
-                     Eregs_Inp[0x55] |= 0x0100;            // Set Channel Active
-                     Eregs_Inp[0x5C] |= 0x0200;            // Set CA Command Register
-                     Eregs_Inp[0x55] |= 0x0040;            // Set Write Break Remember flag
+                     iob->inp[0x55] |= 0x0100;            // Set Channel Active
+                     iob->inp[0x5C] |= 0x0200;            // Set CA Command Register
+                     iob->inp[0x55] |= 0x0040;            // Set Write Break Remember flag
                      break;
-               }  // End of nested switch ccw.code
+               }  // End of nested switch iob->ccw.code
 
                while (Ireg_bit(0x77, iob->CA_mask) == ON)
                    wait();                                 // Wait for CA1 L3 Request reset
 
-               // Read data from host
-               rc = recv( iob->bus_socket[iob->abswitch], iob->buffer, sizeof(iob->buffer),0);
-               if (debug_reg & 0x80)
-                  printf("CA%c: received: %d bytes from host\n\r", iob->CA_id, rc);
-               // Send an ACK to the host
-               send_ack(iob->bus_socket[iob->abswitch]);
-               iob->bufferl = rc;
+               // The host sends exactly iob->ccw.count bytes, they are received
+               // as the CWs below ask for them
+               iob->bufferl = 0;
+               iob->rcvd = 0;
+               if (iob->ccw.count > iob->buffersz) {
+                  uint8_t *nbuf = realloc(iob->buffer, iob->ccw.count);
+
+                  if (nbuf == NULL) {                     // End the CCW, keep the bus in step
+                     printf("\nCA%c: No storage for %d bytes of Write data, unit check \n\r", iob->CA_id, iob->ccw.count);
+                     STAT_INC(CA_STAT(iob->CA_id).sock_err);
+                     drain_data(iob);
+                     send_ack(iob->bus_socket[iob->abswitch]);
+                     carnstat = CSW_DEND | CSW_UCHK;
+                     send_carnstat(iob, iob->bus_socket[iob->abswitch], &carnstat, &ackbuf);
+                     break;
+                  }
+                  iob->buffer = nbuf;
+                  iob->buffersz = iob->ccw.count;
+               }
                bufbase = 0;                                // Set buffer base.
                                                            // We will need this in case of chaining
 
                // ************************************************************
                // Data transfer loop starts here
                // ************************************************************
-               if (debug_reg & 0x80)
-                  print_hex(iob->buffer, iob->bufferl);
-
-               while (iob->bufferl) {
+               while (recv_data(iob, 1) > 0) {
                   do {   // While condition remains 0
                      condition = 1;
                      if (debug_reg & 0x80)
-                        printf("InpReg 55 %04X, OutReg 55 %04X\n\r", Eregs_Inp[0x55], Eregs_Out[0x55]);
-                     while (reg_bit(0x55, 0x2000) == OFF)  // Wait for INCWAR to become valid
+                        printf("InpReg 55 %04X, OutReg 55 %04X\n\r", iob->inp[0x55], iob->out[0x55]);
+                     while ((iob->out[0x55] & 0x2000) == 0)  // Wait for INCWAR to become valid
                         wait();
 
-                     incwar = Eregs_Out[0x50];
-                     cacw1 = (M[incwar] << 8) | M[incwar+1] & 0x00FF;  // Get first half of CA Control word
+                     incwar = iob->out[0x50];
+                     cacw1 = mem_rd16(incwar);                          // Get first half of CA Control word
                      if ((cacw1 & 0x1000) == 0x0000) {     // If chain bit is off ...
-                        Eregs_Inp[0x55] &= ~0x2000;        // ...reset INCWAR valid latch ...
-                        Eregs_Out[0x55] &= ~0x2000;        // ...in both IN and OUT reg
+                        iob->inp[0x55] &= ~0x2000;        // ...reset INCWAR valid latch ...
+                        iob->out[0x55] &= ~0x2000;        // ...in both IN and OUT reg
                      }
                      wdcnt = (cacw1 >> 2) & 0x03FF;        // Load Counter
-                     cacw2 = ((M[incwar+2] << 8) | M[incwar+3] & 0x00FF)
+                     cacw2 = mem_rd16(incwar+2)
                                + (cacw1 << 14);            // Get data load address
                      if (debug_reg & 0x80)
                         printf("INCWAR %04X, CW %02X%02X %02X%02X\n\r", incwar, M[incwar], M[incwar+1], M[incwar+2], M[incwar+3]);
-                     Eregs_Out[0x50] = Eregs_Out[0x50] + 4;
+                     iob->out[0x50] = iob->out[0x50] + 4;
 
-                     Eregs_Inp[0x5C] |= 0x0020;            // Set command register to IN Control Word
-                     Eregs_Inp[0x59] = cacw2;              // Load cycle steal address with data load start address
+                     iob->inp[0x5C] |= 0x0020;            // Set command register to IN Control Word
+                     iob->inp[0x59] = cacw2;              // Load cycle steal address with data load start address
                      if (debug_reg & 0x80) {
                         printf("CW %04X\n\r",cacw1);
                         printf("Load starts at %04X, count=%04X\n\r", cacw2, wdcnt);
                      }
+                     recv_data(iob, wdcnt);                // Get the data for this CW
                      wdcnttmp = wdcnt < iob->bufferl?wdcnt:iob->bufferl;
 
-                     for (i = 0; i < wdcnttmp; i++) {
-                        M[cacw2+i] = iob->buffer[bufbase+i]; // Load data directly into memory
-                        Eregs_Inp[0x59] = Eregs_Inp[0x59] + 1;  // Increment cycle steal counter
-                        wdcnt = wdcnt - 1;                 // Decrement byte counter
-                     }  // End For
+                     // Cycle steal the whole segment at once
+                     memcpy(&M[cacw2], &iob->buffer[bufbase], cs_len(iob, cacw2, wdcnttmp));
+                     cpu_jit_store(cacw2, wdcnttmp);       // Retire code predecoded from there
+                     cpu_wake();                           // An idle loop may poll this storage
+                     iob->inp[0x59] = iob->inp[0x59] + wdcnttmp;  // Cycle steal address past the data
+                     wdcnt = wdcnt - wdcnttmp;             // Remaining byte count
                      iob->bufferl = iob->bufferl - wdcnttmp;
-                     bufbase = bufbase + i;                // Buffer base points to start of remaing data
+                     bufbase = bufbase + wdcnttmp;         // Buffer base points to start of remaing data
                      if ((cacw1 & 0x8000) && wdcnt == 0) {   // If IN and count zero
                         if ((cacw1 & 0x2000) == 0x2000)  {   // Zero Override On
-                           Eregs_Inp[0x55] |= 0x4000;      // Set Zero Override in reg 55
+                           iob->inp[0x55] |= 0x4000;      // Set Zero Override in reg 55
                            condition = 0;
                            pthread_mutex_lock(&r77_lock);
                            Eregs_Inp[0x77] |= iob->CA_mask;  // Set CA1 L3 interrupt request
                            pthread_mutex_unlock(&r77_lock);
-                           CA1_IS_req_L3 = ON;             // Chan Adap L3 request flag
+                           iob->IS_req_L3 = ON;             // Chan Adap L3 request flag
+                           cpu_wake();
+                           STAT_INC(CA_STAT(iob->CA_id).l3_req);
                            while (Ireg_bit(0x77, iob->CA_mask) == ON)
                               wait();
                         } else {
-                           Eregs_Inp[0x55] &= ~0x4000;     // Reset zero ovcerride flag
+                           iob->inp[0x55] &= ~0x4000;     // Reset zero ovcerride flag
                            } // End Zero override on
                         if ((cacw1 & 0x3000) == 0x0000)    // Chaining Off, Zero Override Off
                            condition = 1;
@@ -1036,7 +1670,10 @@ void *CAx_thread(void *pthargs) {
                   } while (condition == 0);  // End of Do stmt
 
 
-               }  // End of while iob->bufferl
+               }  // End of while recv_data
+
+               // Send an ACK to the host
+               send_ack(iob->bus_socket[iob->abswitch]);
 
                if (debug_reg & 0x80)
                   printf("CA%c: Data transfer complete, loaded %04X, remainder %04X\n\r",
@@ -1045,26 +1682,28 @@ void *CAx_thread(void *pthargs) {
                // we will send a L3 interrupt to to CCU, otherwise...
                // ...we will countinue loading data. In case of chaining, we will fetch a new CW
 
-               Eregs_Inp[0x52] &= 0x0000;                  // Clear Byte Count Register
-               Eregs_Inp[0x52] = wdcnt;                    // Load Register with Byte count
+               iob->inp[0x52] &= 0x0000;                  // Clear Byte Count Register
+               iob->inp[0x52] = wdcnt;                    // Load Register with Byte count
                while (Ireg_bit(0x77, iob->CA_mask) == ON)
                   wait();                                  // Wait for L3 interrupt reset
                wdcnt = 0x0000;                             // clear count
 
-               Eregs_Inp[0x55] |= 0x0020;                  // Set channel stop
-               Eregs_Inp[0x55] &= ~0x4000;                 // Reset zero ovcerride flag
+               iob->inp[0x55] |= 0x0020;                  // Set channel stop
+               iob->inp[0x55] &= ~0x4000;                 // Reset zero ovcerride flag
                if (debug_reg & 0x80)
                   printf("CA%c: Channel Stop\n\r", iob->CA_id);
                pthread_mutex_lock(&r77_lock);
                Eregs_Inp[0x77] |= iob->CA_mask;            // Set CA1 L3 interrupt request
                pthread_mutex_unlock(&r77_lock);
-               CA1_IS_req_L3 = ON;
+               iob->IS_req_L3 = ON;
+               cpu_wake();
+               STAT_INC(CA_STAT(iob->CA_id).l3_req);
                while (Ireg_bit(0x77, iob->CA_mask) == ON)
                   wait();                                  // Wait for CA1 L3 Request reset
                if (condition != 2) {                       // If Zero overide is on
-                  carnstat = ((Eregs_Out[0x54] >> 8 ) & 0x00FF);   // Get CA return status
+                  carnstat = ((iob->out[0x54] >> 8 ) & 0x00FF);   // Get CA return status
                   // Send CA return status to host
-                  send_carnstat(iob->bus_socket[iob->abswitch], &carnstat, &ackbuf, iob->CA_id);
+                  send_carnstat(iob, iob->bus_socket[iob->abswitch], &carnstat, &ackbuf);
                }
                break;
 
@@ -1074,42 +1713,45 @@ void *CAx_thread(void *pthargs) {
             case 0x52:         // Read start 1
             case 0x93:         // Reset command
 
-               Eregs_Inp[0x55] |= 0x0100;                  // Set Channel Active
-               Eregs_Inp[0x5C] |= 0x0008;                  // Set non-standard command in CA Command Register
-               Eregs_Inp[0x53] &= 0x0000;                  // Reset sense register
+               iob->inp[0x55] |= 0x0100;                  // Set Channel Active
+               iob->inp[0x5C] |= 0x0008;                  // Set non-standard command in CA Command Register
+               iob->inp[0x53] &= 0x0000;                  // Reset sense register
 
                while (Ireg_bit(0x77, iob->CA_mask) == ON)
                   wait();                                  // Wait for CA1 L3 interrupt request reset
                pthread_mutex_lock(&r77_lock);
                Eregs_Inp[0x77] |= iob->CA_mask;            // Set CA1 L3 interrupt request
                pthread_mutex_unlock(&r77_lock);
-               CA1_IS_req_L3 = ON;                         // Chan Adap L3 interrupt request flag
+               iob->IS_req_L3 = ON;                         // Chan Adap L3 interrupt request flag
+               cpu_wake();
+               STAT_INC(CA_STAT(iob->CA_id).l3_req);
                while (Ireg_bit(0x77, iob->CA_mask) == ON)
                   wait();                                  // Wait for L3 iterrupt request reset
 
                // Send CA return status to host
-               carnstat = ((Eregs_Out[0x54] >> 8 ) & 0x00FF); // Get CA return status
-               send_carnstat(iob->bus_socket[iob->abswitch], &carnstat, &ackbuf, iob->CA_id);
+               carnstat = ((iob->out[0x54] >> 8 ) & 0x00FF); // Get CA return status
+               send_carnstat(iob, iob->bus_socket[iob->abswitch], &carnstat, &ackbuf);
                break;
                
             default:       // Send command reject sense
-               data_buffer[0] = SENSE_CR;                 // Load sense data byte 0
+               sense = SENSE_CR;                           // Load sense data byte 0
                if (debug_reg & 0x80)
-                  printf("CA%c: Sending sense Byte 0 %02X \n\r", iob->CA_id, data_buffer[0]);
+                  printf("CA%c: Sending sense Byte 0 %02X \n\r", iob->CA_id, sense);
 
-               rc = send_socket(iob->bus_socket[iob->abswitch], (void*)&data_buffer, 1);
+               rc = send_socket(iob->bus_socket[iob->abswitch], (void*)&sense, 1);
                // Wait for the ACK from the host
                recv_ack(iob->bus_socket[iob->abswitch]);
 
                // Send CA return status to host
                carnstat = CSW_CEND | CSW_DEND;  // Get CA return status
-               send_carnstat(iob->bus_socket[iob->abswitch], &carnstat, &ackbuf, iob->CA_id);
+               send_carnstat(iob, iob->bus_socket[iob->abswitch], &carnstat, &ackbuf);
                break;
 
-         }  // End of switch (ccw.code)
+         }  // End of switch (iob->ccw.code)
+         STAT_ADD(CA_STAT(iob->CA_id).ccw_ns[iob->ccw.code], stats_now_ns() - ccw_start);
 
          // Release the lock
-         rc = pthread_mutex_unlock(&lock);
+         rc = pthread_mutex_unlock(&iob->lock);
          if (debug_reg & 0x80)
                   printf("CA%c: Release main lock, rc = %d \n\r", iob->CA_id,rc);
       }  // End of if - else
@@ -1117,6 +1759,199 @@ void *CAx_thread(void *pthargs) {
 }
 
 
+// ************************************************************
+// SET CAn TRANSPORT=TCP | SHM:name
+// ************************************************************
+t_stat ca_set_transport (UNIT *uptr, int32 val, char *cptr, void *desc) {
+   int ca = (int)(uptr - ca_unit) - 1;
+
+   if (cptr == NULL || ca < 0 || ca > 1)
+      return SCPE_ARG;
+   if (ca_started) {
+      printf("CA%d: Transport can only be set before the 3705 is started\n", ca + 1);
+      return SCPE_ARG;
+   }
+   if (strcasecmp(cptr, "TCP") == 0) {
+      ca_shm_name[ca][0] = 0;
+   } else if (strncasecmp(cptr, "SHM:", 4) == 0 && cptr[4] != 0 &&
+              strlen(&cptr[4]) < sizeof(ca_shm_name[ca])) {
+      strcpy(ca_shm_name[ca], &cptr[4]);
+   } else
+      return SCPE_ARG;
+   return SCPE_OK;
+}
+
+t_stat ca_show_transport (FILE *st, UNIT *uptr, int32 val, void *desc) {
+   int ca = (int)(uptr - ca_unit) - 1;
+
+   if (ca < 0 || ca > 1)
+      return SCPE_OK;
+   if (ca_shm_name[ca][0] == 0)
+      fprintf(st, "transport=TCP");
+   else
+      fprintf(st, "transport=SHM:%s", ca_shm_name[ca]);
+   return SCPE_OK;
+}
+
+t_stat ca_set_attndelay (UNIT *uptr, int32 val, char *cptr, void *desc) {
+   int ca = (int)(uptr - ca_unit) - 1;
+   uint32_t usec;
+   t_stat r;
+
+   if (cptr == NULL || ca < 0 || ca > 1)
+      return SCPE_ARG;
+   usec = (uint32_t) get_uint (cptr, 10, 1000000, &r);
+   if (r != SCPE_OK)
+      return r;
+   ca_attn_delay[ca] = usec;
+   return SCPE_OK;
+}
+
+t_stat ca_show_attndelay (FILE *st, UNIT *uptr, int32 val, void *desc) {
+   int ca = (int)(uptr - ca_unit) - 1;
+
+   if (ca < 0 || ca > 1)
+      return SCPE_OK;
+   fprintf(st, "attndelay=%u usec", ca_attn_delay[ca]);
+   return SCPE_OK;
+}
+
+
+t_stat ca_set_failover (UNIT *uptr, int32 val, char *cptr, void *desc) {
+   int ca = (int)(uptr - ca_unit) - 1;
+   uint32_t ms;
+   t_stat r;
+
+   if (cptr == NULL || ca < 0 || ca > 1)
+      return SCPE_ARG;
+   ms = (uint32_t) get_uint (cptr, 10, 60000, &r);
+   if (r != SCPE_OK)
+      return r;
+   if (ms != 0 && ms < 10)
+      return SCPE_ARG;
+   ca_failover_ms[ca] = ms;
+   return SCPE_OK;
+}
+
+t_stat ca_show_failover (FILE *st, UNIT *uptr, int32 val, void *desc) {
+   int ca = (int)(uptr - ca_unit) - 1;
+
+   if (ca < 0 || ca > 1)
+      return SCPE_OK;
+   if (ca_failover_ms[ca] == 0)
+      fprintf(st, "failover=off");
+   else
+      fprintf(st, "failover=%u msec", ca_failover_ms[ca]);
+   return SCPE_OK;
+}
+
+
+t_stat ca_set_iotimeout (UNIT *uptr, int32 val, char *cptr, void *desc) {
+   int ca = (int)(uptr - ca_unit) - 1;
+   uint32_t sec;
+   t_stat r;
+
+   if (cptr == NULL || ca < 0 || ca > 1)
+      return SCPE_ARG;
+   sec = (uint32_t) get_uint (cptr, 10, 3600, &r);
+   if (r != SCPE_OK)
+      return r;
+   ca_io_timeout[ca] = sec;
+   return SCPE_OK;
+}
+
+t_stat ca_show_iotimeout (FILE *st, UNIT *uptr, int32 val, void *desc) {
+   int ca = (int)(uptr - ca_unit) - 1;
+
+   if (ca < 0 || ca > 1)
+      return SCPE_OK;
+   if (ca_io_timeout[ca] == 0)
+      fprintf(st, "iotimeout=off");
+   else
+      fprintf(st, "iotimeout=%u sec", ca_io_timeout[ca]);
+   return SCPE_OK;
+}
+
+
+// ************************************************************
+// SET CA NODELAY | NONODELAY | SNDBUF=n | RCVBUF=n | BUSYPOLL=n
+// ************************************************************
+t_stat ca_set_sockopt (UNIT *uptr, int32 val, char *cptr, void *desc) {
+   uint32_t n = 0;
+   t_stat r;
+
+   if (val == SOCK_SET_NODELAY || val == SOCK_SET_NONODELAY) {
+      if (cptr != NULL)
+         return SCPE_ARG;
+      sock_opt.nodelay = (val == SOCK_SET_NODELAY);
+      return SCPE_OK;
+   }
+   if (cptr == NULL)
+      return SCPE_ARG;
+   n = (uint32_t) get_uint (cptr, 10, (val == SOCK_SET_BUSYPOLL) ? 1000000 : 64 * 1024 * 1024, &r);
+   if (r != SCPE_OK)
+      return r;
+   if (val == SOCK_SET_SNDBUF)
+      sock_opt.sndbuf = n;
+   else if (val == SOCK_SET_RCVBUF)
+      sock_opt.rcvbuf = n;
+   else
+      sock_opt.busy_poll = n;
+   return SCPE_OK;
+}
+
+t_stat ca_show_sockopt (FILE *st, UNIT *uptr, int32 val, void *desc) {
+   fprintf(st, "%s", sock_opt.nodelay ? "nodelay" : "nonodelay");
+   if (sock_opt.sndbuf)
+      fprintf(st, ", sndbuf=%d", sock_opt.sndbuf);
+   if (sock_opt.rcvbuf)
+      fprintf(st, ", rcvbuf=%d", sock_opt.rcvbuf);
+   if (sock_opt.busy_poll)
+      fprintf(st, ", busypoll=%d usec", sock_opt.busy_poll);
+   fprintf(st, "\n");
+   return SCPE_OK;
+}
+
+
+// ************************************************************
+// SHOW CA STATS
+// ************************************************************
+t_stat ca_show_stats (FILE *st, UNIT *uptr, int32 val, void *desc) {
+   static const struct { uint8_t code; char *name; } ccwname[] = {
+      { 0x00, "Test I/O" },     { 0x01, "Write" },        { 0x02, "Read" },
+      { 0x03, "NO-OP" },        { 0x04, "Sense" },        { 0x05, "Write IPL" },
+      { 0x09, "Write Break" },  { 0x31, "Write Start 0" },{ 0x32, "Read Start 0" },
+      { 0x51, "Write Start 1" },{ 0x52, "Read Start 1" }, { 0x93, "Reset" } };
+   struct CA_STATS *cs;
+   double secs;
+   int    ca, j, k;
+
+   secs = (stats_now_ns() - stats_reset_ns) / 1e9;
+   for (ca = 0; ca < 2; ca++) {
+      cs = &ca_stats[ca];
+      fprintf(st, "\nCA%d statistics over %.3f sec\n", ca + 1, secs);
+      fprintf(st, "Bytes in (write): %" PRIu64 "  Bytes out (read): %" PRIu64 "\n",
+              STAT_GET(cs->bytes_in), STAT_GET(cs->bytes_out));
+      fprintf(st, "L3 interrupt requests: %" PRIu64 "  Attentions: %" PRIu64
+              " (merged %" PRIu64 ")  Socket errors: %" PRIu64 "  Failovers: %" PRIu64 "\n",
+              STAT_GET(cs->l3_req), STAT_GET(cs->attn), STAT_GET(cs->attn_merged),
+              STAT_GET(cs->sock_err), STAT_GET(cs->failover));
+      for (j = 0; j < 256; j++) {
+         if (STAT_GET(cs->ccw[j]) == 0)
+            continue;
+         for (k = 0; k < (int)(sizeof(ccwname) / sizeof(ccwname[0])); k++)
+            if (ccwname[k].code == j)
+               break;
+         fprintf(st, "  CCW %02X %-14s %12" PRIu64 "  %10.1f/s  avg %8.1f us\n", j,
+                 (k < (int)(sizeof(ccwname) / sizeof(ccwname[0]))) ? ccwname[k].name : "",
+                 STAT_GET(cs->ccw[j]), (secs > 0) ? STAT_GET(cs->ccw[j]) / secs : 0.0,
+                 STAT_GET(cs->ccw_ns[j]) / 1e3 / STAT_GET(cs->ccw[j]));
+      }
+   }
+   return SCPE_OK;
+}
+
+
 // ************************************************************
 // This subroutine test for 1 bit in a External Output reg.
 // If '0' OFF is returned, if 1 'ON' returned.
@@ -0,0 +1,111 @@
+/* i3705_chan_T2.h: IBM 3705 Channel Adaptor Type 2 state
+
+   Copyright (c) 2020, Henk Stegeman and Edwin Freekenhorst
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+   ROBERT M SUPNIK BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+   IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+   Except as contained in this notice, the name of Charles E. Owen shall not be
+   used in advertising or otherwise to promote the sale, use or other dealings
+   in this Software without prior written authorization from Charles E. Owen.
+
+   ------------------------------------------------------------------------------
+
+   Per CA state, shared by the CA threads (i3705_chan_T2.c), the CCU
+   (i3705_cpu.c) and the panel (A/B switch).
+
+   Each CA has its own X'50'-X'5F' register bank, except X'57' which
+   selects the CA the CCU talks to.  CA1 uses Eregs_Inp/Eregs_Out
+   themselves, so a single CA gen sees no difference; CA2 uses
+   CA2_Inp/CA2_Out.  The CCU reaches the bank of the selected CA
+   through CA_INP/CA_OUT, a CA thread always through its iob->inp and
+   iob->out.  Only X'77' (L3 requests) is shared and needs r77_lock.
+
+   Each CA has its own L3 request flags.  X'57' only switches banks and
+   resets the selected CA's L3 request while CA2 has a host (CA_DUAL);
+   with CA1 alone, X'57' works as before CA2 existed: CA1 bank, and an
+   L3 reset clears both CA bits of X'77'.
+*/
+
+#ifndef _I3705_CHAN_T2_H_
+#define _I3705_CHAN_T2_H_
+
+#include <pthread.h>
+#include <netinet/in.h>
+
+#define MAXPORTS 4
+
+#define CA_BANKED(r)    ((r) >= 0x50 && (r) <= 0x5F && (r) != 0x57)
+#define CA_INP          (ca_sel ? CA2_Inp : Eregs_Inp)
+#define CA_OUT          (ca_sel ? CA2_Out : Eregs_Out)
+#define CA_DUAL         (iob2->CA_active)
+#define CA_REQ_L3(iob)  ((iob)->IS_req_L3 || (iob)->DS_req_L3)
+
+struct CCW     /* Channel Command Word */
+   {
+   uint8_t  code;
+   uint8_t  dataddress[3];
+   uint8_t  flags;
+   uint8_t  chain;           // Format 0. Chain is not correct (yet), but aligned to Hercules
+   uint16_t count;
+   };
+
+struct IO3705  /* IBM 3705 I/O */
+   {
+   char CA_id;
+   int CA_active;
+   int8 IS_req_L3;           // L3 request: initial selection
+   int8 DS_req_L3;           // L3 request: data/status
+   int CA_socket[2];
+   uint16_t CA_mask;
+   int addrlen[MAXPORTS];
+   int bus_socket[2];
+   int tag_socket[2];
+   int abswitch;
+   int abswhist;
+   uint16_t devnum;
+   int32 *inp;               // CA register bank, IN side
+   int32 *out;               // CA register bank, OUT side
+   pthread_mutex_t lock;     // Held by the CA thread through a CCW
+   struct CCW ccw;           // Current channel command
+   uint8_t cmd[8];           // CCW or device number from the host
+   uint8_t *buffer;          // Write data, grown to the largest CCW count
+   uint32_t buffersz;        // Allocated size of buffer
+   uint32_t bufferl;         // Received data not yet cycle stolen
+   uint32_t rcvd;            // Write data received so far for this CCW
+   int ccw_ready;            // Reactor saw the next CCW arrive on the bus socket
+   pthread_mutex_t ccw_lock;
+   pthread_cond_t ccw_cond;
+   int attn_pend;            // ATTN_xxx requests posted by the CCU
+   int attn_out;             // Attention accepted by the host, no Read yet
+   int attn_tries;           // Refused sends of the current attention
+   int attn_backoff;         // msec of the last retry delay
+   uint64_t attn_hold;       // Attention held until, 0 = none
+   uint64_t attn_retry;      // Refused attention due again at, 0 = none
+   uint64_t hb_next;         // Next tag heartbeat due at, 0 = none yet
+   int hb_wait;              // Heartbeat sent, echo not seen yet (ATTN thread only)
+   struct sockaddr_in address[2];
+   };
+
+extern struct IO3705 *iob1, *iob2;
+extern int   ca_sel;                   // CA selected by OUT X'57': 0 = CA1, 1 = CA2
+extern int32 CA2_Inp[];
+extern int32 CA2_Out[];
+
+void ca_attn_post(int reg);
+
+#endif
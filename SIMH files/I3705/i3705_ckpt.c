@@ -0,0 +1,344 @@
+/* i3705_ckpt.c: IBM 3705 warm start snapshot
+
+   Copyright (c) 2021, Henk Stegeman & Edwin Freekenhorst
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+   ROBERT M SUPNIK BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+   IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+   Except as contained in this notice, the name of Charles E. Owen shall not be
+   used in advertising or otherwise to promote the sale, use or other dealings
+   in this Software without prior written authorization from Charles E. Owen.
+
+   ------------------------------------------------------------------------------
+
+   WARMSTART SAVE {-Z} <file>    write a snapshot of the stopped 3705
+   WARMSTART LOAD <file>         restore it, CONT resumes the NCP
+
+   The file is a header followed by named sections: "M" (storage) and one
+   per CKPT_ITEM of the modules.  Sections are raw host memory, so a
+   snapshot is only good for the same build on the same host type; the
+   header byte order, version and every section length are checked
+   before anything is overwritten.  Sections the build does not know are
+   skipped, so a table can grow without making older snapshots useless
+   as long as the existing items keep their size.
+
+   With -Z storage is written as "M.Z": one flag byte per 4K page and
+   only the pages that are not all zero.  A generated NCP leaves most of
+   a 256K 3705 empty, so this is most of the gain of a compressor
+   without linking one.
+
+   The CA and CS state is copied under the locks the threads use to
+   update it, each CA's iob->lock first, as a CA thread takes it before
+   r77_lock.  A CA thread keeps iob->lock through a whole CCW and may be
+   waiting there for the stopped CCU, so it is only waited for
+   CKPT_CA_WAIT seconds; a CA that is still busy fails the command, CONT
+   lets the CCW finish.  A CCW in progress, sockets and host connections
+   are not part of the snapshot: the host and the terminals reconnect
+   after a WARMSTART LOAD as after a restart of the emulator.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "i3705_defs.h"
+#include "i3705_stats.h"
+#include "i3705_chan_T2.h"
+#include "i3705_ckpt.h"
+#include "sim_fio.h"
+
+#define CKPT_MAGIC      "I3705CKP"
+#define CKPT_ORDER      0x01020304     // Tells a snapshot of another byte order
+#define CKPT_VERSION    1
+#define CKPT_PAGE       4096           // -Z granularity
+#define CKPT_CA_WAIT    2              // Seconds to wait for a CA's CCW to end
+
+struct CKPT_HDR {
+   char   magic[8];
+   uint32 order;
+   uint32 version;
+   uint32 memsize;
+   uint32 pad;
+};
+
+struct CKPT_SEC {
+   char   name[CKPT_NAMELEN];
+   uint32 len;                         // Data bytes that follow
+   uint32 pad;
+};
+
+extern uint8 M[];
+extern UNIT  cpu_unit;
+extern pthread_mutex_t icw_lock;
+extern pthread_mutex_t r77_lock;
+extern pthread_mutex_t r7f_lock;
+
+char *get_glyph (char *iptr, char *optr, char mchar);
+char *get_glyph_nc (char *iptr, char *optr, char mchar);
+char *get_sim_sw (char *cptr);
+
+static struct CKPT_ITEM *ckpt_tables[] = {
+   cpu_ckpt, ca_ckpt, cs_ckpt, sdlc_ckpt, pu_ckpt, NULL };
+
+/* Quiesce the CA threads and take the register locks.  Returns
+   SCPE_INCOMP when a CA stays busy with a CCW. */
+
+static t_stat ckpt_lock(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_REALTIME, &ts);
+   ts.tv_sec += CKPT_CA_WAIT;
+   if (pthread_mutex_timedlock(&iob1->lock, &ts) != 0) {
+      printf("CA1 busy with a CCW, CONT and try again\n");
+      return SCPE_INCOMP;
+   }
+   if (pthread_mutex_timedlock(&iob2->lock, &ts) != 0) {
+      pthread_mutex_unlock(&iob1->lock);
+      printf("CA2 busy with a CCW, CONT and try again\n");
+      return SCPE_INCOMP;
+   }
+   pthread_mutex_lock(&icw_lock);
+   pthread_mutex_lock(&r77_lock);
+   pthread_mutex_lock(&r7f_lock);
+   return SCPE_OK;
+}
+
+static void ckpt_unlock(void)
+{
+   pthread_mutex_unlock(&r7f_lock);
+   pthread_mutex_unlock(&r77_lock);
+   pthread_mutex_unlock(&icw_lock);
+   pthread_mutex_unlock(&iob2->lock);
+   pthread_mutex_unlock(&iob1->lock);
+}
+
+static int ckpt_put(FILE *f, const char *name, const void *data, uint32 len)
+{
+   struct CKPT_SEC sec;
+
+   memset(&sec, 0, sizeof(sec));
+   strncpy(sec.name, name, CKPT_NAMELEN - 1);
+   sec.len = len;
+   if (fwrite(&sec, sizeof(sec), 1, f) != 1)
+      return -1;
+   if (len && fwrite(data, len, 1, f) != 1)
+      return -1;
+   return 0;
+}
+
+/* Storage in 4K pages: page map, then the non zero pages */
+
+static int ckpt_put_mz(FILE *f, uint32 memsize)
+{
+   uint32 npg = memsize / CKPT_PAGE, len, p, i;
+   uint8  map[MAXMEMSIZE / CKPT_PAGE];
+   struct CKPT_SEC sec;
+
+   len = npg;
+   for (p = 0; p < npg; p++) {
+      map[p] = 0;
+      for (i = 0; i < CKPT_PAGE; i++)
+         if (M[p * CKPT_PAGE + i]) {
+            map[p] = 1;
+            len += CKPT_PAGE;
+            break;
+         }
+   }
+   memset(&sec, 0, sizeof(sec));
+   strcpy(sec.name, "M.Z");
+   sec.len = len;
+   if (fwrite(&sec, sizeof(sec), 1, f) != 1 || fwrite(map, npg, 1, f) != 1)
+      return -1;
+   for (p = 0; p < npg; p++)
+      if (map[p] && fwrite(&M[p * CKPT_PAGE], CKPT_PAGE, 1, f) != 1)
+         return -1;
+   return 0;
+}
+
+static t_stat ckpt_save(char *fname, int zero)
+{
+   struct CKPT_HDR hdr;
+   struct CKPT_ITEM *it;
+   int32  sna[PU_SNA_N];
+   int    i, err;
+   FILE  *f;
+   t_stat r;
+
+   if ((r = ckpt_lock()) != SCPE_OK)
+      return r;
+   if ((f = sim_fopen(fname, "wb")) == NULL) {
+      ckpt_unlock();
+      return SCPE_OPENERR;
+   }
+   memset(&hdr, 0, sizeof(hdr));
+   memcpy(hdr.magic, CKPT_MAGIC, sizeof(hdr.magic));
+   hdr.order = CKPT_ORDER;
+   hdr.version = CKPT_VERSION;
+   hdr.memsize = MEMSIZE;
+   err = (fwrite(&hdr, sizeof(hdr), 1, f) != 1);
+
+   if (zero)
+      err |= ckpt_put_mz(f, hdr.memsize);
+   else
+      err |= ckpt_put(f, "M", M, hdr.memsize);
+   for (i = 0; ckpt_tables[i] != NULL; i++)
+      for (it = ckpt_tables[i]; it->name != NULL; it++)
+         err |= ckpt_put(f, it->name, it->addr, it->len);
+   if (pu_ckpt_sna(sna, 1) == PU_SNA_N)
+      err |= ckpt_put(f, "PU.SNA", sna, sizeof(sna));
+   ckpt_unlock();
+
+   if (fclose(f) != 0)
+      err = 1;
+   return err ? SCPE_IOERR : SCPE_OK;
+}
+
+static struct CKPT_ITEM *ckpt_find(const char *name)
+{
+   struct CKPT_ITEM *it;
+   int i;
+
+   for (i = 0; ckpt_tables[i] != NULL; i++)
+      for (it = ckpt_tables[i]; it->name != NULL; it++)
+         if (strcmp(it->name, name) == 0)
+            return it;
+   return NULL;
+}
+
+/* Walk the sections.  With apply == 0 only check them, so a bad file
+   is refused before the running state is touched. */
+
+static t_stat ckpt_walk(uint8 *buf, size_t size, uint32 memsize, int apply)
+{
+   struct CKPT_SEC sec;
+   struct CKPT_ITEM *it;
+   size_t off = sizeof(struct CKPT_HDR);
+   uint32 npg = memsize / CKPT_PAGE, p, n;
+
+   while (off < size) {
+      if (size - off < sizeof(sec))
+         return SCPE_IOERR;
+      memcpy(&sec, buf + off, sizeof(sec));
+      off += sizeof(sec);
+      sec.name[CKPT_NAMELEN - 1] = '\0';
+      if (sec.len > size - off)
+         return SCPE_IOERR;
+
+      if (strcmp(sec.name, "M") == 0) {
+         if (sec.len != memsize)
+            return SCPE_INCOMP;
+         if (apply)
+            memcpy(M, buf + off, memsize);
+      } else if (strcmp(sec.name, "M.Z") == 0) {
+         if (sec.len < npg)
+            return SCPE_INCOMP;
+         for (p = n = 0; p < npg; p++)
+            n += (buf[off + p] != 0);
+         if (sec.len != npg + n * CKPT_PAGE)
+            return SCPE_INCOMP;
+         for (p = n = 0; apply && p < npg; p++)
+            if (buf[off + p]) {
+               memcpy(&M[p * CKPT_PAGE], buf + off + npg + n * CKPT_PAGE, CKPT_PAGE);
+               n++;
+            }
+      } else if (strcmp(sec.name, "PU.SNA") == 0) {
+         if (sec.len != PU_SNA_N * sizeof(int32))
+            return SCPE_INCOMP;
+         if (apply) {
+            int32 sna[PU_SNA_N];
+            memcpy(sna, buf + off, sizeof(sna));
+            pu_ckpt_sna(sna, 0);       // No PU up: the session is rebuilt
+         }
+      } else if ((it = ckpt_find(sec.name)) != NULL) {
+         if (sec.len != it->len)
+            return SCPE_INCOMP;
+         if (apply)
+            memcpy(it->addr, buf + off, it->len);
+      }                                // else from a newer build, skip
+      off += sec.len;
+   }
+   return SCPE_OK;
+}
+
+static t_stat ckpt_load(char *fname)
+{
+   struct CKPT_HDR hdr;
+   uint8  *buf;
+   size_t  size;
+   t_stat  r;
+   FILE   *f;
+
+   if ((f = sim_fopen(fname, "rb")) == NULL)
+      return SCPE_OPENERR;
+   size = (size_t) sim_fsize(f);
+   if (size < sizeof(hdr) || (buf = (uint8 *) malloc(size)) == NULL) {
+      fclose(f);
+      return (size < sizeof(hdr)) ? SCPE_IOERR : SCPE_MEM;
+   }
+   if (fread(buf, size, 1, f) != 1) {
+      free(buf);
+      fclose(f);
+      return SCPE_IOERR;
+   }
+   fclose(f);
+
+   memcpy(&hdr, buf, sizeof(hdr));
+   if (memcmp(hdr.magic, CKPT_MAGIC, sizeof(hdr.magic)) != 0 ||
+       hdr.order != CKPT_ORDER || hdr.version != CKPT_VERSION ||
+       hdr.memsize == 0 || hdr.memsize > MAXMEMSIZE ||
+       (hdr.memsize % CKPT_PAGE) != 0)
+      r = SCPE_INCOMP;
+   else
+      r = ckpt_walk(buf, size, hdr.memsize, 0);
+   if (r == SCPE_OK)
+      r = ckpt_lock();
+   if (r == SCPE_OK) {
+      memset(M, 0, MAXMEMSIZE);
+      MEMSIZE = hdr.memsize;
+      ckpt_walk(buf, size, hdr.memsize, 1);
+      ckpt_unlock();
+      cpu_cuc_reset();                 // Utilization counts from here
+   }
+   free(buf);
+   return r;
+}
+
+t_stat ckpt_cmd (int32 flag, char *cptr)
+{
+   char gbuf[CBUFSIZE];
+   int  save;
+
+   cptr = get_glyph(cptr, gbuf, 0);
+   if (strcmp(gbuf, "SAVE") == 0)
+      save = 1;
+   else if (strcmp(gbuf, "LOAD") == 0)
+      save = 0;
+   else
+      return SCPE_ARG;
+   if ((cptr = get_sim_sw(cptr)) == NULL)
+      return SCPE_INVSW;
+   if (*cptr == 0)
+      return SCPE_2FARG;
+   get_glyph_nc(cptr, gbuf, 0);
+   if (save)
+      return ckpt_save(gbuf, (sim_switches & SWMASK('Z')) != 0);
+   if (sim_switches & SWMASK('Z'))
+      return SCPE_INVSW;
+   return ckpt_load(gbuf);
+}
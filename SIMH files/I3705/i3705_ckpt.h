@@ -0,0 +1,65 @@
+/* i3705_ckpt.h: IBM 3705 checkpoint and warm start
+
+   Copyright (c) 2021, Henk Stegeman & Edwin Freekenhorst
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+   ROBERT M SUPNIK BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+   IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+   Except as contained in this notice, the name of Charles E. Owen shall not be
+   used in advertising or otherwise to promote the sale, use or other dealings
+   in this Software without prior written authorization from Charles E. Owen.
+
+   ------------------------------------------------------------------------------
+
+   WARMSTART SAVE writes storage and the state of every module to a
+   file, WARMSTART LOAD puts it back, so a loaded and active NCP can be
+   restarted or cloned without an IPL and channel load (i3705_ckpt.c).
+
+   Each module lists the globals that make up its state in a CKPT_ITEM
+   table, written as one named section each.  Sockets, threads and locks
+   are not state: after a WARMSTART the host channel and the terminals
+   reconnect as after a restart.
+*/
+
+#ifndef _I3705_CKPT_H_
+#define _I3705_CKPT_H_
+
+#include <stddef.h>
+
+#define CKPT_NAMELEN 24
+
+struct CKPT_ITEM {
+   const char *name;                   // Section name, < CKPT_NAMELEN chars
+   void       *addr;
+   size_t      len;
+};
+
+#define CKPT(v)      { #v, &(v), sizeof(v) }
+
+extern struct CKPT_ITEM cpu_ckpt[];    // i3705_cpu.c
+extern struct CKPT_ITEM ca_ckpt[];     // i3705_chan_T2.c
+extern struct CKPT_ITEM cs_ckpt[];     // i3705_scan_T2.c
+extern struct CKPT_ITEM sdlc_ckpt[];   // i3705_sdlc.c
+extern struct CKPT_ITEM pu_ckpt[];     // i3705_client.c
+
+/* SNA session state of the PU (COMMADPT bit fields), as int32's */
+#define PU_SNA_N     16
+int    pu_ckpt_sna(int32 *st, int save);
+
+t_stat ckpt_cmd (int32 flag, char *cptr);
+
+#endif
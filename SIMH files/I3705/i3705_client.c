@@ -53,6 +53,9 @@
 #include "htypes.h"
 #include "i3705_sdlc.h"
 #include "i3705_client.h"
+#include "i3705_stats.h"
+#include "i3705_sock.h"
+#include "i3705_ckpt.h"
 #include "codepage.c"
 #include <sys/syscall.h>
 
@@ -69,6 +72,13 @@ extern int Plen;                   // Length of PIU response
 extern int8 last_lu;                // Last addressed lu
 
 COMMADPT *ca;
+struct PU_STATS pu_stats;              // PIU and socket counters per LU
+/* Response time stamps.  Outbound: first channel WRITE not yet followed
+   by a PIU to the PU.  Inbound: start of the last complete terminal
+   record, handed to the channel side once it is sent to the NCP.      */
+static uint64_t lat_wr_ns = 0;
+static uint64_t lat_rd_start = 0, lat_rd_ready = 0, lat_rd_ns = 0;
+static uint8_t  lat_rd_lu;
 void make_seq (COMMADPT * ca, BYTE * bufptr);
 int write_socket( int fd, const void *_ptr, int nbytes );
 int send_packet (int csock, BYTE *buf, int len, char *caption);
@@ -124,7 +134,33 @@ uint8_t F2_INITSELF_Req[] = {
       0x00, 0x00, 0x00 };
 
 uint8_t RSP_buf[BUFLEN_3270];                  // Response buffer
+
+struct CKPT_ITEM pu_ckpt[] = {                 // See also pu_ckpt_sna()
+   CKPT(RSP_buf),
+   { NULL }
+};
 int double_up_iac (BYTE *buf, int len);
+t_stat pu_show_stats (FILE *st, UNIT *uptr, int32 val, void *desc);
+
+/*-------------------------------------------------------------------*/
+/* PU data structures                                                */
+/*   pu_unit      PU unit descriptor                                 */
+/*   pu_dev       PU device descriptor                               */
+/*   pu_mod       PU modifiers list                                  */
+/*-------------------------------------------------------------------*/
+UNIT pu_unit = { UDATA (NULL, 0, 0) };
+
+MTAB pu_mod[] = {
+    { MTAB_XTD|MTAB_VDV|MTAB_NMO, 0, "STATS", NULL, NULL, &pu_show_stats },
+    { 0 }
+};
+
+DEVICE pu_dev = {
+    "PU", &pu_unit, NULL, pu_mod,
+    1, 16, 16, 1, 16, 8,
+    NULL, NULL, NULL, NULL,
+    NULL, NULL
+};
 
 /*-------------------------------------------------------------------*/
 /* Print VTAM connected or disconnected message.                     */
@@ -171,6 +207,7 @@ int proc_PIU (unsigned char BLU_buf[], int Pptr, int Blen, int Fcntl) {
    BYTE  Dbuf[BUFLEN_3270];            // Data buffer
    int   RUlen = 16;                   // RU response length
    int   i;
+   uint64_t wr_ns;                     // Channel WRITE time of this PIU
    register char *s;
 
    if (debug_reg & 0x20) {             // Debug ?
@@ -225,6 +262,9 @@ int proc_PIU (unsigned char BLU_buf[], int Pptr, int Blen, int Fcntl) {
             }
 
             /* Send 3270 data response to host */
+            STAT_INC(pu_stats.piu_out[BLU_buf[Pptr + FD2_TH_oaf]]);
+            lat_rd_lu = ca->lu_addr1;
+            __atomic_store_n(&lat_rd_ns, lat_rd_ready, __ATOMIC_RELAXED);
             Rsp_buf = EMPTY;
             return(Plen);                 // Send PIU to host
          } else {
@@ -245,6 +285,7 @@ int proc_PIU (unsigned char BLU_buf[], int Pptr, int Blen, int Fcntl) {
                fprintf(trace, "%02X ", (int) *s & 0xFF);
             fprintf(trace, "\n");
          }
+         STAT_INC(pu_stats.piu_out[BLU_buf[Pptr + FD2_TH_oaf]]);
          Rsp_buf = EMPTY;
          return(Plen);                 // Send PIU to host
       }
@@ -266,6 +307,7 @@ int proc_PIU (unsigned char BLU_buf[], int Pptr, int Blen, int Fcntl) {
             fprintf(trace, "\n");
          }
 
+         STAT_INC(pu_stats.piu_out[last_lu]);
          ca->initselfflag = 1;         // Flag INITSELF send.
          return(Plen);
 
@@ -278,6 +320,8 @@ int proc_PIU (unsigned char BLU_buf[], int Pptr, int Blen, int Fcntl) {
    // Iframe received with an PIU
    //================================================================
    if ((Fcntl & 0x01) == IFRAME) {
+      STAT_INC(pu_stats.piu_in[BLU_buf[Pptr + FD2_TH_daf]]);
+      wr_ns = __atomic_exchange_n(&lat_wr_ns, 0, __ATOMIC_RELAXED);
 
       /**********************************************************/
       /*** PROCESS IFRAME as SNA cmd or as TN3270 DATA STREAM ***/
@@ -326,6 +370,8 @@ int proc_PIU (unsigned char BLU_buf[], int Pptr, int Blen, int Fcntl) {
          //************************************************************
          send_packet (ca->sfd, (BYTE *) Dbuf, RUlen, "3270 Data");
          //************************************************************
+         if (wr_ns)
+            hist_record(&pu_stats.lat_out[BLU_buf[Pptr + FD2_TH_daf]], stats_now_ns() - wr_ns);
       }
 
       if ((BLU_buf[Pptr + FD2_RH_1] & 0xF0) != 0x80)       // Disregard if not DR1 requested
@@ -420,6 +466,8 @@ int proc_PIU (unsigned char BLU_buf[], int Pptr, int Blen, int Fcntl) {
                 RSP_buf[FD2_RH_1] =  BLU_buf[Pptr + FD2_RH_1] | 0x10;  // -Rsp
                 ca->bindflag = 0;
             }
+         if (ca->bindflag)
+            STAT_INC(pu_stats.binds[BLU_buf[Pptr + FD2_TH_daf]]);
           // Copy BIND to RU.
          memcpy(&RSP_buf[FD2_RU_0], F2_BIND_Rsp, sizeof(F2_BIND_Rsp));
 
@@ -483,6 +531,8 @@ int proc_PIU (unsigned char BLU_buf[], int Pptr, int Blen, int Fcntl) {
 
       /*** UNBIND & Normal end of session ***/
       if (BLU_buf[Pptr + FD2_RU_0] == 0x32 && BLU_buf[Pptr + FD2_RU_1] != 0x02) {
+         if (ca->bindflag)
+            STAT_INC(pu_stats.unbinds[BLU_buf[Pptr + FD2_TH_daf]]);
          ca->bindflag = 0;
          /* Save oaf from UNBIND request */
          ca->tso_addr1 = BLU_buf[Pptr + FD2_TH_oaf];
@@ -516,6 +566,7 @@ int proc_PIU (unsigned char BLU_buf[], int Pptr, int Blen, int Fcntl) {
          }
 
          /* Send response to host */
+         STAT_INC(pu_stats.piu_out[BLU_buf[Pptr + FD2_TH_oaf]]);
          Rsp_buf = EMPTY;
          return (Plen);
       } else {
@@ -527,6 +578,78 @@ int proc_PIU (unsigned char BLU_buf[], int Pptr, int Blen, int Fcntl) {
 //#####################################################################
 
 
+/*-------------------------------------------------------------------*/
+/* Response time hooks, called by the channel adapter threads.       */
+/* A channel WRITE starts the outbound clock unless it is running,   */
+/* a channel READ stops the inbound clock if terminal input is on    */
+/* its way to the host.                                              */
+/*-------------------------------------------------------------------*/
+void lat_chan_write(void) {
+   uint64_t idle = 0;
+
+   __atomic_compare_exchange_n(&lat_wr_ns, &idle, stats_now_ns(), 0,
+                               __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+void lat_chan_read(void) {
+   uint64_t rd_ns;
+
+   rd_ns = __atomic_exchange_n(&lat_rd_ns, 0, __ATOMIC_RELAXED);
+   if (rd_ns)
+      hist_record(&pu_stats.lat_in[lat_rd_lu], stats_now_ns() - rd_ns);
+}
+
+
+/*-------------------------------------------------------------------*/
+/* Return 1 and the LU address if the LU has an LU-LU session bound. */
+/*-------------------------------------------------------------------*/
+int pu_session (uint8_t *lu) {
+   if (ca == NULL || !ca->bindflag)
+      return 0;
+   *lu = ca->lu_addr1;
+   return 1;
+}
+
+
+/*-------------------------------------------------------------------*/
+/* SHOW PU STATS                                                     */
+/*-------------------------------------------------------------------*/
+static void pu_show_hist (FILE *st, int lu, char *dir, struct LAT_HIST *h) {
+   uint64_t count = STAT_GET(h->count);
+
+   if (count == 0)
+      return;
+   fprintf(st, "LU %02X %-9s %10" PRIu64 " %9.3f %9.3f %9.3f %9.3f %9.3f\n", lu, dir, count,
+           STAT_GET(h->sum_ns) / 1e6 / count,
+           hist_percentile_us(h, 50.0) / 1e3, hist_percentile_us(h, 90.0) / 1e3,
+           hist_percentile_us(h, 99.0) / 1e3, STAT_GET(h->max_ns) / 1e6);
+}
+
+t_stat pu_show_stats (FILE *st, UNIT *uptr, int32 val, void *desc) {
+   double secs;
+   int    i;
+
+   secs = (stats_now_ns() - stats_reset_ns) / 1e9;
+   fprintf(st, "\nPU statistics over %.3f sec\n", secs);
+   fprintf(st, "Terminal socket errors: %" PRIu64 "\n", STAT_GET(pu_stats.sock_err));
+   fprintf(st, "LU addr      PIUs in     PIUs/s     PIUs out     PIUs/s    Binds\n");
+   for (i = 0; i < 256; i++) {
+      if (STAT_GET(pu_stats.piu_in[i]) == 0 && STAT_GET(pu_stats.piu_out[i]) == 0)
+         continue;
+      fprintf(st, "   %02X   %12" PRIu64 " %10.1f %12" PRIu64 " %10.1f %8" PRIu64 "\n", i,
+              STAT_GET(pu_stats.piu_in[i]),  (secs > 0) ? STAT_GET(pu_stats.piu_in[i]) / secs : 0.0,
+              STAT_GET(pu_stats.piu_out[i]), (secs > 0) ? STAT_GET(pu_stats.piu_out[i]) / secs : 0.0,
+              STAT_GET(pu_stats.binds[i]));
+   }
+   fprintf(st, "\nResponse time (ms)     Count       Avg       p50       p90       p99       Max\n");
+   for (i = 0; i < 256; i++) {
+      pu_show_hist(st, i, "host->LU", &pu_stats.lat_out[i]);
+      pu_show_hist(st, i, "LU->host", &pu_stats.lat_in[i]);
+   }
+   return SCPE_OK;
+}
+
+
 /*-------------------------------------------------------------------*/
 /* Subroutine to create unique PIU sequence numbers.                 */
 /*-------------------------------------------------------------------*/
@@ -628,6 +751,7 @@ int     rc;                             /* Return code               */
 
     if (rc < 0) {
         printf("\nsend to client failed");
+        STAT_INC(pu_stats.sock_err);
         return -1;
     } /* end if(rc) */
 
@@ -1085,6 +1209,8 @@ static void commadpt_read_tty(COMMADPT *ca, BYTE * bfr, int len)
                 ca->inpbufl = 0;
             }
         }
+    if (ca->rlen3270 == 0)             /* Start of a new record */
+        lat_rd_start = stats_now_ns();
 
 
     for (i1 = 0; i1 < len; i1++) {
@@ -1151,12 +1277,14 @@ static void commadpt_read_tty(COMMADPT *ca, BYTE * bfr, int len)
         {
             if (eor)
             {
+                lat_rd_ready = lat_rd_start;
                 ca->inpbufl = ca->rlen3270;
                 ca->rlen3270 = 0; /* for next msg */
             }
         }
         else
         {
+            lat_rd_ready = lat_rd_start;
             ca->inpbufl = ca->rlen3270;
             ca->rlen3270 = 0; /* for next msg */
         }
@@ -1178,6 +1306,7 @@ void *TEL_thread(void *arg)
     char *ipaddr;
     BYTE bfr[256];
     fprintf(stderr, "\nTEL: thread %d started succesfully... \n",syscall(SYS_gettid));
+    stats_thread("TEL");
 
     ca =  malloc(sizeof(COMMADPT));
 
@@ -1215,6 +1344,7 @@ void *TEL_thread(void *arg)
         printf("\nTEL: Socket bind failed\n");
         return NULL;
     }
+    sock_tune(ca->lfd);
     /* Start the listen */
     rc = listen(ca->lfd, 10);
     if (rc < 0)
@@ -1229,6 +1359,7 @@ void *TEL_thread(void *arg)
         ca->sfd=accept(ca->lfd,NULL,0);
         if (ca->sfd < 1)
             continue;
+        sock_tune(ca->sfd);
         if  (connect_client(&ca->sfd))
         {
             ca->is_3270 = 1;
@@ -1259,6 +1390,7 @@ void *TEL_thread(void *arg)
                 {
                     continue;
                 }
+                STAT_INC(pu_stats.sock_err);
                 break;
             }
             if (rc == 0)
@@ -1279,3 +1411,24 @@ void *TEL_thread(void *arg)
 }
 
 
+
+/*-------------------------------------------------------------------*/
+/* CHECKPOINT/WARMSTART of the SNA session state.  The sequence      */
+/* numbers and addresses are bit fields of COMMADPT, so they are     */
+/* copied one by one.  Returns the count, -1 when no PU is up.       */
+/*-------------------------------------------------------------------*/
+int pu_ckpt_sna(int32 *st, int save)
+{
+    int i = 0;
+
+    if (ca == NULL)
+        return -1;
+#define F(f)    if (save) st[i++] = ca->f; else ca->f = st[i++];
+    F(bindflag)     F(initselfflag)
+    F(ncpa_sscp_seqn) F(ncpb_sscp_seqn) F(lu_sscp_seqn) F(lu_lu_seqn)
+    F(sscp_addr0)   F(sscp_addr1)   F(ncp_addr0)    F(ncp_addr1)
+    F(pu_addr0)     F(pu_addr1)     F(lu_addr0)     F(lu_addr1)
+    F(tso_addr0)    F(tso_addr1)
+#undef F
+    return i;
+}
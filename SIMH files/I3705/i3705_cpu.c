@@ -158,7 +158,14 @@ Instruction formats:
 #include <sched.h>
 #include "i3705_defs.h"
 #include "i3705_Eregs.h"                                /* Exernal regs defs */
+#include "i3705_stats.h"                                /* Performance counters */
+#include "i3705_chan_T2.h"                              /* CA2: per CA register banks */
+#include "i3705_mem.h"                                  /* Halfword/fullword storage access */
+#include "i3705_ckpt.h"                                 /* CHECKPOINT/WARMSTART state */
 #include <pthread.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/eventfd.h>
 
 #define UNIT_V_MSIZE (UNIT_V_UF+3)                      /* dummy mask */
 #define UNIT_MSIZE   (1 << UNIT_V_MSIZE)
@@ -179,11 +186,37 @@ pthread_mutex_t r77_lock;                               /* CA2/CS2: Reg77 update
 pthread_mutex_t r7f_lock;                               /* CCU: Reg7F update lock */
 
 uint8 M[MAXMEMSIZE] = { 0 };                            /* Memory 3705 */
-int32 GR[8][4] = { 0x00 };                              /* General Registers Group 0-3 */
+int32 GR[4][8] = { 0x00 };                              /* General Registers [group][reg] */
+int32 *active_bank = GR[0];                             /* Registers of the active group */
+uint8 op_class[0x10000];                                /* Opcode -> OP_xxx handler */
+extern struct opdef optable[];                          /* Instruction table (i3705_sys.c) */
+extern int32 nopcode;
 int32 opcode;                                           /* Operation Code 16 bits */
 int32 opcode0, opcode1;                                 /* OpCode byte0(H) & Byte1(L) */
-int8  CL_C[4] = { OFF };                                /* Condition Latches 'C' */
-int8  CL_Z[4] = { OFF };                                /* Condition Latches 'Z' */
+int8  CL_C[4] = { OFF };                                /* Condition Latches 'C' (SCP view) */
+int8  CL_Z[4] = { OFF };                                /* Condition Latches 'Z' (SCP view) */
+
+/* Lazy condition latches: an instruction only records its result and how
+   C and Z follow from it; cc_c() and cc_z() work them out for BCL, BZL,
+   IN X'79' and the trace.  CL_C/CL_Z are loaded from and stored back to
+   this around sim_instr, so SCP examine/deposit see the real latches. */
+#define CC_LOGIC     0                                  /* C = not Z */
+#define CC_ARITH     1                                  /* C = (res & cmask) != 0 */
+#define CC_PARITY    2                                  /* C = even nr of one bits in res */
+#define CC_ALL       0xFFFFFFFF                         /* Z mask: any bit */
+#define CC_NEG       0x80000000                         /* C mask: res < 0, i.e. a borrow */
+#define CC_OVF       0xFFFF0000                         /* C mask: res > 0xFFFF */
+
+struct CC_LAZY {
+   int32  kind;                                         /* CC_xxx */
+   uint32 res;                                          /* Result as the instruction left it */
+   uint32 zmask;                                        /* Z = (res & zmask) == 0 */
+   uint32 cmask;                                        /* For CC_ARITH */
+};
+struct CC_LAZY cc_lazy[4];                              /* Per register group */
+
+#define CC_SET(k, r, zm, cm)  do { struct CC_LAZY *l_ = &cc_lazy[Grp]; \
+                                   l_->kind = (k); l_->res = (r); l_->zmask = (zm); l_->cmask = (cm); } while (0)
 int32 Eregs_Inp[128] = { 0xEFEF };                      /* External regs X'00 -> X'7F' inp */
 int32 Eregs_Out[128] = { 0x0000 };                      /* External regs X'00 -> X'7F' out */
 
@@ -198,7 +231,7 @@ int8  timer_req_L3 = OFF;                               /* Interval timer L3 req
 int8  inter_req_L3 = OFF;                               /* Panel interrupt L3 request flag */
 int8  pci_req_L4 = OFF;                                 /* PCI L4 request flag */
 int8  svc_req_L4 = OFF;                                 /* SVC L4 request flag */
-// These flags below belong in chan.c
+// These flags below belong in chan.c (Type 1 CA, Type 2 keeps them per CA)
 int8  CA1_DS_req_L3 = OFF;                              /* Chan Adap Data/Status request flag */
 int8  CA1_IS_req_L3 = OFF;                              /* Chan Adap Initial Sel request flag */
 int8  CA1_NSC_end_seq = OFF;                            /* NSC channel end xfer seq flag */
@@ -216,6 +249,11 @@ int8  pgm_stop   = OFF;                                 /* Program STOP flag */
 int8  OP_reg_chk = OFF;                                 /* Invalid instruction */
 int8  adr_ex_chk = OFF;                                 /* Address exception check */
 int8  IO_L5_chk  = OFF;                                 /* I/O instr in L5 */
+int8  prot_chk   = OFF;                                 /* Storage protection check */
+uint8 prot_key   = 0;                                   /* L5 program key, 0 = unprotected */
+uint8 stor_key[PROT_BLKS];                              /* Storage key per 2K block */
+int32 prot_adr   = 0;                                   /* Block of the last OUT X'73' */
+int32 prot_on    = OFF;                                 /* SET CPU PROTECT=ON|OFF */
 int32 lvl;                                              /* Active Program Level (1...5) */
 int32 Grp;                                              /* Active Register Group (0...3) */
 int32 PC;                                               /* Program Counter */
@@ -228,13 +266,105 @@ int   tbar;                                             /* ICW table pointer */
 int32 cc = 1;
 int32 val[4] = { 0x00, 0x00, 0x00, 0x00 };              /* Used for printing mnem */
 
+struct CPU_STATS cpu_stats;                             /* CCU performance counters */
+uint64_t stats_reset_ns;                                /* Time of last RESET STATS */
+int   stat_lvl = -1;                                    /* Level being timed, 0 = wait */
+uint64_t stat_stamp;                                    /* Start of timed interval */
+
+/* Cycle utilization counter: IN X'7A' gives the CCU busy time, outside
+   the wait state, idle sleeps and SCP stops, since the last OUT X'7A',
+   one count per CUC_NS and held at X'FFFF'.  It has its own wait time
+   so that a RESET STATS does not disturb what NCP measures. */
+#define CUC_NS       10000                              /* 10 usec per count */
+uint64_t cuc_wait_ns;                                   /* Not busy time booked so far */
+uint64_t cuc_reset_ns;                                  /* Time of the last OUT X'7A' */
+uint64_t cuc_reset_wait;                                /* cuc_wait_ns at that time */
+
+/* SET CPU JIT=ON: straight-line runs of instructions are predecoded once
+   into blocks, cached by start address, and run back to back without the
+   level scan at the top of the loop.  A store into a page holding
+   predecoded code bumps the page generation, which retires the blocks
+   built from it. */
+#define JIT_BLKMAX   32                                 /* Instructions per block */
+#define JIT_SLOTS    4096                               /* Cache slots, power of 2 */
+
+struct JIT_BLK {
+   int32  addr;                                         /* First instruction */
+   int32  n;                                            /* Instructions, 0 = free slot */
+   int32  page;                                         /* Block lies in page and page + 1 */
+   uint32 gen[2];                                       /* Their generations when built */
+   int32  pc[JIT_BLKMAX];                               /* Address of each instruction */
+   uint16 op[JIT_BLKMAX];                               /* Opcode */
+   uint8  cls[JIT_BLKMAX];                              /* op_class[] of opcode */
+   uint8  idle;                                         /* No store, I/O or EXIT: idle loop candidate */
+};
+
+int32  jit_on = OFF;                                    /* SET CPU JIT=ON|OFF */
+struct JIT_BLK jit_cache[JIT_SLOTS];                    /* Predecoded blocks */
+uint8  jit_watch[JIT_PAGES];                            /* Page holds predecoded code */
+uint32 jit_gen[JIT_PAGES];                              /* Bumped by a store into a watched page */
+
+/* SET CPU IDLE=ON: a level 5 block that branches back to its own start
+   without a store and leaves the registers and latches as it found them
+   is an idle loop, only an interrupt or a cycle steal can change its
+   outcome.  The CCU then sleeps on cpu_wake_fd, as it does in the wait
+   state, until an interrupt source calls cpu_wake or IDLE_MS passes.
+   Like sim_idle, the slept time counts as elapsed for the event queue.
+   With JIT=OFF no blocks are built: the normal fetch takes the target of
+   a backward branch at level 5 as the candidate (idle_addr) and sleeps
+   when a lap from it comes back without a store, IN, OUT or EXIT and
+   with the same registers and latches. */
+#define IDLE_MS      10                                 /* Longest sleep, msec */
+
+int32  idle_on = OFF;                                   /* SET CPU IDLE=ON|OFF */
+int    cpu_wake_fd = -1;                                /* Posted by the interrupt sources */
+int32  idle_regs[8];                                    /* Registers at the candidate's start */
+int    idle_c, idle_z;                                  /* and latches */
+int32  idle_addr = -1;                                  /* JIT=OFF candidate, -1 = none */
+int    idle_lap;                                        /* Snapshot taken, lap clean so far */
+
+/* CCU state written by CHECKPOINT, see i3705_ckpt.c.  active_bank is
+   derived from Grp at sim_instr entry, the JIT cache is rebuilt. */
+
+struct CKPT_ITEM cpu_ckpt[] = {
+   CKPT(GR), CKPT(CL_C), CKPT(CL_Z), CKPT(Eregs_Inp), CKPT(Eregs_Out),
+   CKPT(int_lvl_req), CKPT(int_lvl_ent), CKPT(int_lvl_mask),
+   CKPT(ipl_req_L1), CKPT(diag_req_L2), CKPT(svc_req_L2), CKPT(pci_req_L3),
+   CKPT(timer_req_L3), CKPT(inter_req_L3), CKPT(pci_req_L4), CKPT(svc_req_L4),
+   CKPT(CA1_DS_req_L3), CKPT(CA1_IS_req_L3),
+   CKPT(CA1_NSC_end_seq), CKPT(CA1_NSC_final_seq), CKPT(CA1_NSC_SB_clred),
+   CKPT(last_P_Ns), CKPT(last_S_Ns), CKPT(last_lu),
+   CKPT(load_state), CKPT(test_mode), CKPT(wait_state), CKPT(pgm_stop),
+   CKPT(OP_reg_chk), CKPT(adr_ex_chk), CKPT(IO_L5_chk),
+   CKPT(prot_chk), CKPT(prot_key), CKPT(stor_key), CKPT(prot_adr),
+   CKPT(lvl), CKPT(Grp), CKPT(PC), CKPT(LAR), CKPT(saved_PC), CKPT(tbar),
+   { NULL }
+};
+
 t_stat cpu_ex (t_value *vptr, t_addr addr, UNIT *uptr, int32 sw);
 t_stat cpu_dep (t_value val, t_addr addr, UNIT *uptr, int32 sw);
 t_stat cpu_reset (DEVICE *dptr);
 t_stat cpu_set_size (UNIT *uptr, int32 val, char *cptr, void *desc);
 t_stat cpu_boot (int32 unitno, DEVICE *dptr);
+t_stat cpu_show_stats (FILE *st, UNIT *uptr, int32 val, void *desc);
+t_stat cpu_set_jit (UNIT *uptr, int32 val, char *cptr, void *desc);
+t_stat cpu_show_jit (FILE *st, UNIT *uptr, int32 val, void *desc);
+t_stat cpu_set_idle (UNIT *uptr, int32 val, char *cptr, void *desc);
+t_stat cpu_show_idle (FILE *st, UNIT *uptr, int32 val, void *desc);
+t_stat cpu_set_prot (UNIT *uptr, int32 val, char *cptr, void *desc);
+t_stat cpu_show_prot (FILE *st, UNIT *uptr, int32 val, void *desc);
+t_stat timer_set (UNIT *uptr, int32 val, char *cptr, void *desc);   /* i3705_timer.c */
+t_stat timer_show (FILE *st, UNIT *uptr, int32 val, void *desc);
+void   cpu_jit_store(int32 addr, int32 len);
+void   cpu_wake(void);
+static void cpu_idle(void);
+static struct JIT_BLK *jit_block(int32 addr);
 
 int32 RegGrp(int32 level);
+int32 cc_c(int32 g);
+int32 cc_z(int32 g);
+void  cc_flags(int32 g, int32 c, int32 z);
+void  i3705_init(void);                                 /* i3705_sys.c */
 int32 GetMem(int32 addr);
 int32 PutMem(int32 addr, int32 data);
 
@@ -264,49 +394,49 @@ REG cpu_reg[] = {
 
     /* Group 0 registers */
     { HRDATA (GR0G0, GR[0][0], 18) },
-    { HRDATA (GR1G0, GR[1][0], 18) },
-    { HRDATA (GR2G0, GR[2][0], 18) },
-    { HRDATA (GR3G0, GR[3][0], 18) },
-    { HRDATA (GR4G0, GR[4][0], 18) },
-    { HRDATA (GR5G0, GR[5][0], 18) },
-    { HRDATA (GR6G0, GR[6][0], 18) },
-    { HRDATA (GR7G0, GR[7][0], 18) },
+    { HRDATA (GR1G0, GR[0][1], 18) },
+    { HRDATA (GR2G0, GR[0][2], 18) },
+    { HRDATA (GR3G0, GR[0][3], 18) },
+    { HRDATA (GR4G0, GR[0][4], 18) },
+    { HRDATA (GR5G0, GR[0][5], 18) },
+    { HRDATA (GR6G0, GR[0][6], 18) },
+    { HRDATA (GR7G0, GR[0][7], 18) },
     { FLDATA (CLCG0, CL_C[0],   8) },
     { FLDATA (CLZG0, CL_Z[0],   8) },
 
     /* Group 1 registers */
-    { HRDATA (GR0G1, GR[0][1], 18) },
+    { HRDATA (GR0G1, GR[1][0], 18) },
     { HRDATA (GR1G1, GR[1][1], 18) },
-    { HRDATA (GR2G1, GR[2][1], 18) },
-    { HRDATA (GR3G1, GR[3][1], 18) },
-    { HRDATA (GR4G1, GR[4][1], 18) },
-    { HRDATA (GR5G1, GR[5][1], 18) },
-    { HRDATA (GR6G1, GR[6][1], 18) },
-    { HRDATA (GR7G1, GR[7][1], 18) },
+    { HRDATA (GR2G1, GR[1][2], 18) },
+    { HRDATA (GR3G1, GR[1][3], 18) },
+    { HRDATA (GR4G1, GR[1][4], 18) },
+    { HRDATA (GR5G1, GR[1][5], 18) },
+    { HRDATA (GR6G1, GR[1][6], 18) },
+    { HRDATA (GR7G1, GR[1][7], 18) },
     { FLDATA (CLCG1, CL_C[1],   8) },
     { FLDATA (CLZG1, CL_Z[1],   8) },
 
     /* Group 2 registers */
-    { HRDATA (GR0G2, GR[0][2], 18) },
-    { HRDATA (GR1G2, GR[1][2], 18) },
+    { HRDATA (GR0G2, GR[2][0], 18) },
+    { HRDATA (GR1G2, GR[2][1], 18) },
     { HRDATA (GR2G2, GR[2][2], 18) },
-    { HRDATA (GR3G2, GR[3][2], 18) },
-    { HRDATA (GR4G2, GR[4][2], 18) },
-    { HRDATA (GR5G2, GR[5][2], 18) },
-    { HRDATA (GR6G2, GR[6][2], 18) },
-    { HRDATA (GR7G2, GR[7][2], 18) },
+    { HRDATA (GR3G2, GR[2][3], 18) },
+    { HRDATA (GR4G2, GR[2][4], 18) },
+    { HRDATA (GR5G2, GR[2][5], 18) },
+    { HRDATA (GR6G2, GR[2][6], 18) },
+    { HRDATA (GR7G2, GR[2][7], 18) },
     { FLDATA (CLCG2, CL_C[2],   8) },
     { FLDATA (CLZG2, CL_Z[2],   8) },
 
     /* Group 3 registers */
-    { HRDATA (GR0G3, GR[0][3], 18) },
-    { HRDATA (GR1G3, GR[1][3], 18) },
-    { HRDATA (GR2G3, GR[2][3], 18) },
+    { HRDATA (GR0G3, GR[3][0], 18) },
+    { HRDATA (GR1G3, GR[3][1], 18) },
+    { HRDATA (GR2G3, GR[3][2], 18) },
     { HRDATA (GR3G3, GR[3][3], 18) },
-    { HRDATA (GR4G3, GR[4][3], 18) },
-    { HRDATA (GR5G3, GR[5][3], 18) },
-    { HRDATA (GR6G3, GR[6][3], 18) },
-    { HRDATA (GR7G3, GR[7][3], 18) },
+    { HRDATA (GR4G3, GR[3][4], 18) },
+    { HRDATA (GR5G3, GR[3][5], 18) },
+    { HRDATA (GR6G3, GR[3][6], 18) },
+    { HRDATA (GR7G3, GR[3][7], 18) },
     { FLDATA (CLCG3, CL_C[3],   8) },
     { FLDATA (CLZG3, CL_Z[3],   8) },
 
@@ -388,6 +518,10 @@ REG cpu_reg[] = {
     { HRDATA (CU7EO, Eregs_Out[0x7E], 16) },
     { HRDATA (CU7FO, Eregs_Out[0x7F], 16) },
 
+    /* Storage protection */
+    { HRDATA (PRKEY, prot_key, 3) },
+    { BRDATA (STKEY, stor_key, 16, 3, PROT_BLKS) },
+
     /* Misc */
     { HRDATA (WRU, sim_int_char, 8) },
     { HRDATA (DEBUG, debug_reg, 16) },
@@ -401,12 +535,17 @@ MTAB cpu_mod[] = {    // <=== for future 3705 model selection
     { UNIT_MSIZE, 65536, NULL, "64K", &cpu_set_size },
     { UNIT_MSIZE, 131072, NULL, "128", &cpu_set_size },
     { UNIT_MSIZE, 262144, NULL, "256K", &cpu_set_size },
+    { MTAB_XTD|MTAB_VDV|MTAB_NMO, 0, "STATS", NULL, NULL, &cpu_show_stats },
+    { MTAB_XTD|MTAB_VDV, 0, "JIT", "JIT", &cpu_set_jit, &cpu_show_jit },
+    { MTAB_XTD|MTAB_VDV, 0, "IDLE", "IDLE", &cpu_set_idle, &cpu_show_idle },
+    { MTAB_XTD|MTAB_VDV, 0, "PROTECT", "PROTECT", &cpu_set_prot, &cpu_show_prot },
+    { MTAB_XTD|MTAB_VDV, 0, "TIMER", "TIMER", &timer_set, &timer_show },
     { 0 }
 };
 
 DEVICE cpu_dev = {
     "CPU", &cpu_unit, cpu_reg, cpu_mod,
-    1, 16, 16, 1, 16, 8,
+    1, 16, 18, 1, 16, 8,
     &cpu_ex, &cpu_dep, &cpu_reset, &cpu_boot,
     NULL, NULL
 };
@@ -437,15 +576,23 @@ t_stat sim_instr (void) {
    sched_setaffinity(0, sizeof(cpuset), &cpuset);
 
 
-int32 i, j, w_byte, addr;
+int32 i, w_byte, addr;
 int32 R1fld, R2fld, Rfld;
 int32 N1fld, N2fld, Nfld;
 int32 Afld, Bfld, Dfld, Efld, Ifld, Mfld, Tfld;
+int32 opclass;
+struct JIT_BLK *blk = NULL;                    /* Predecoded block being run */
+int32 blk_i = 0;                               /* Its current instruction */
 
 Grp = RegGrp(lvl);
+active_bank = GR[Grp];
+for (i = 0; i < 4; i++)                        /* Latches as SCP left them */
+   cc_flags(i, CL_C[i], CL_Z[i]);
+cpu_jit_store(0, MAXMEMSIZE);                  /* LOAD or DEPOSIT may have changed code */
 saved_PC = PC;
-PC = GR[0][Grp];
+PC = active_bank[0];
 reason = 0;
+stats_lvl_time((wait_state == ON) ? 0 : lvl);  /* Start timing current level */
 
 //********************************************************
 // Main instruction fetch/decode loop
@@ -537,7 +684,7 @@ while (reason == 0) {                          /* Loop until halted */
 //********************************************************
 
    /* Check for any L1 requests ? */
-   if (ipl_req_L1 || OP_reg_chk || IO_L5_chk || adr_ex_chk)
+   if (ipl_req_L1 || OP_reg_chk || IO_L5_chk || adr_ex_chk || prot_chk)
       int_lvl_req[1] = ON;                     // Set L1 interrupt request
    else int_lvl_req[1] = OFF;
 
@@ -547,7 +694,8 @@ while (reason == 0) {                          /* Loop until halted */
    else int_lvl_req[2] = OFF;
 
    /* Check for any L3 requests ? */
-   if (inter_req_L3 || timer_req_L3 || pci_req_L3 || CA1_DS_req_L3 || CA1_IS_req_L3)
+   if (inter_req_L3 || timer_req_L3 || pci_req_L3 || CA1_DS_req_L3 || CA1_IS_req_L3 ||
+       CA_REQ_L3(iob1) || CA_REQ_L3(iob2))
       int_lvl_req[3] = ON;                     // Set L3 interrupt request
    else int_lvl_req[3] = OFF;
 
@@ -576,18 +724,21 @@ while (reason == 0) {                          /* Loop until halted */
 //               printf("MASK = OFF     lvl=%d\n\r", i );
                /* Start higher prio pgm level ! */
                int_lvl_ent[i] = ON;
+               STAT_INC(cpu_stats.entries[i]);
                lvl = i;                        // Set new pgm level
                Grp = RegGrp(lvl);              // Set new reg group
+               active_bank = GR[Grp];
                if (debug_reg & 0x02) {         // Trace CCU interrupt levels
                   if (lvl == 1)
-                     fprintf(trace, "\n>>> Entering lvl=1 -- IPL=%d; OPchk=%d; IOchk=%d; AEchk=%d \n",
-                             ipl_req_L1, OP_reg_chk, IO_L5_chk, adr_ex_chk);
+                     fprintf(trace, "\n>>> Entering lvl=1 -- IPL=%d; OPchk=%d; IOchk=%d; AEchk=%d; PRchk=%d \n",
+                             ipl_req_L1, OP_reg_chk, IO_L5_chk, adr_ex_chk, prot_chk);
                   if (lvl == 2)
                      fprintf(trace, "\n>>> Entering lvl=2 -- Diag=%d; SVCL2=%d \n",
                              diag_req_L2, svc_req_L2);
                   if (lvl == 3)
-                     fprintf(trace, "\n>>> Entering lvl=3 -- Int=%d; Timer=%d; PCIL3=%d; CA1_IS=%d; CA1_D/S=%d \n",
-                             inter_req_L3, timer_req_L3, pci_req_L3, CA1_IS_req_L3, CA1_DS_req_L3);
+                     fprintf(trace, "\n>>> Entering lvl=3 -- Int=%d; Timer=%d; PCIL3=%d; CA1_IS=%d; CA1_D/S=%d; CA2=%d \n",
+                             inter_req_L3, timer_req_L3, pci_req_L3, CA1_IS_req_L3 | iob1->IS_req_L3,
+                             CA1_DS_req_L3 | iob1->DS_req_L3, CA_REQ_L3(iob2));
                   if (lvl == 4)
                      fprintf(trace, "\n>>> Entering lvl=4 -- PCIL4=%d; SVCL4=%d \n",
                              pci_req_L4, svc_req_L4);
@@ -596,14 +747,15 @@ while (reason == 0) {                          /* Loop until halted */
                }
                if (debug_reg & 0x02) {
                if (lvl == 1)                   // Display CCU interrupt levels
-                  printf(">>> Entering lvl 1 -- IPL=%d; OPchk=%d; IOchk=%d; AEchk=%d \n\r",
-                          ipl_req_L1, OP_reg_chk, IO_L5_chk, adr_ex_chk);
+                  printf(">>> Entering lvl 1 -- IPL=%d; OPchk=%d; IOchk=%d; AEchk=%d; PRchk=%d \n\r",
+                          ipl_req_L1, OP_reg_chk, IO_L5_chk, adr_ex_chk, prot_chk);
                if (lvl == 2)
                   printf(">>> Entering lvl 2 -- Diag=%d; SVCL2=%d \n\r",
                           diag_req_L2, svc_req_L2);
                if (lvl == 3)
-                  printf(">>> Entering lvl 3 -- Int=%d; Timer=%d; PCIL3=%d; CA1_IS=%d; CA1_D/S=%d \n\r",
-                          inter_req_L3, timer_req_L3, pci_req_L3, CA1_IS_req_L3, CA1_DS_req_L3);
+                  printf(">>> Entering lvl 3 -- Int=%d; Timer=%d; PCIL3=%d; CA1_IS=%d; CA1_D/S=%d; CA2=%d \n\r",
+                          inter_req_L3, timer_req_L3, pci_req_L3, CA1_IS_req_L3 | iob1->IS_req_L3,
+                          CA1_DS_req_L3 | iob1->DS_req_L3, CA_REQ_L3(iob2));
                if (lvl == 4)
                   printf(">>> Entering lvl 4 -- PCIL4=%d; SVCL4=%d \n\r",
                           pci_req_L4, svc_req_L4);
@@ -617,13 +769,13 @@ while (reason == 0) {                          /* Loop until halted */
                      GR[0][0] = 0x0010;        // Start addr level 1
                      break;
                   case 2:
-                     GR[0][Grp] = 0x0080;      // Start addr level 2
+                     active_bank[0] = 0x0080;  // Start addr level 2
                      break;
                   case 3:
-                     GR[0][Grp] = 0x0100;      // Start addr level 3
+                     active_bank[0] = 0x0100;  // Start addr level 3
                      break;
                   case 4:
-                     GR[0][Grp] = 0x0180;      // Start addr level 4
+                     active_bank[0] = 0x0180;  // Start addr level 4
                      break;
                   case 5:                      // Continue with GR0G3
                      break;
@@ -639,13 +791,14 @@ while (reason == 0) {                          /* Loop until halted */
                   /* Looks like we have nothing to do, so let's wait...  */
                   if ((debug_reg & 0x02) && (wait_state == OFF)) {
                      fprintf(trace, "\n>>> Entering wait state in lvl=5, GR0G3=%05X \n",
-                                    GR[0][RegGrp(i)]);
+                                    GR[RegGrp(i)][0]);
                      fprintf(trace, "\n>>> Waiting... \n");
                   }
                   wait_state = ON;             // Enter wait state
                }
                lvl = i;                        // Set pgm level 5
                Grp = RegGrp(lvl);              // Set reg group 3
+               active_bank = GR[Grp];
                break;                          // Out of inner 'for' loop
             }
             continue;                          // Check next lower pgm lvl
@@ -653,124 +806,166 @@ while (reason == 0) {                          /* Loop until halted */
          continue;                             // Check next lower pgm lvl
       }
 
-      lvl = i;                                 // Set current pgm level
-      Grp = RegGrp(lvl);                       // Set reg group
+      if (lvl != i) {                          // Back in a level after an EXIT
+         lvl = i;                              // Set current pgm level
+         Grp = RegGrp(lvl);                    // Set reg group
+         active_bank = GR[Grp];
+      }
       break;                                   // Continue with current pgm lvl
    }
 
+   if (((wait_state == ON) ? 0 : lvl) != stat_lvl)
+      stats_lvl_time((wait_state == ON) ? 0 : lvl);  // Level switch: book the time
+
    if (wait_state == ON) {
-      usleep(1000);                            // Get some rest...
+      if (idle_on)
+         cpu_idle();                           // Sleep until an interrupt source posts
+      else
+         usleep(1000);                         // Get some rest...
       continue;
    }
 
+   blk = NULL;                                 /* Not when tracing or with breakpoints */
+   if (jit_on && (debug_reg == 0) && (sim_brk_summ == 0)) {
+      blk = jit_block(active_bank[0]);
+      blk_i = 0;
+      if (blk != NULL) {
+         STAT_INC(cpu_stats.jit_runs);
+         if (idle_on && blk->idle && (lvl == 5)) {   /* Snapshot to spot an idle loop */
+            memcpy(idle_regs, active_bank, sizeof(idle_regs));
+            idle_c = cc_c(Grp);
+            idle_z = cc_z(Grp);
+         }
+      }
+   }
+
 //=======================================================================================
 // Read instruction and execute it starts here...
 //=======================================================================================
 
+jit_next:
    if (lvl != 1) LAR = saved_PC;               /* Update LAR if lvl 2, 3, 4 or 5 */
-   PC = GR[0][Grp];
+   PC = active_bank[0];
    saved_PC = PC;
 
-   val[0] = opcode0 = GetMem(PC);              /* Instruction byte 0(H) */
-   PC = (PC + 1) & AMASK;
-   val[1] = opcode1 = GetMem(PC);              /* Instruction byte 1(L) */
-   PC = (PC + 1) & AMASK;
-   opcode = (opcode0 << 8) | (opcode1);        /* Instr to be executed. */
-   val[2] = GetMem(PC);                        /* Needed for possible LA */
-   val[3] = GetMem(PC + 1);                    /* and BAL instructions. */
-
-   if (((opcode0 & 0x88) == 0x00) &&           /* Invalid instruction ? */
-       (test_mode == OFF) &&
-      ((opcode1 == 0x00) ||
-       (opcode1 == 0x20) ||
-       (opcode1 == 0x50) ||
-       (opcode1 == 0x60) ||
-       (opcode1 == 0x70))) {
-      OP_reg_chk = ON;
-      if (lvl == 1)
-         reason = STOP_INVOP;                  /* SIMH stop */
-      continue;
+   if (blk != NULL) {                          /* Predecoded, see jit_block */
+      opcode = blk->op[blk_i];
+      opcode0 = opcode >> 8;
+      opcode1 = opcode & 0xFF;
+      opclass = blk->cls[blk_i];
+      PC = (PC + 2) & AMASK;
+      STAT_INC(cpu_stats.instr[lvl]);
+   } else {
+      if (idle_on && !jit_on) {                /* Idle loop without blocks, see idle_addr */
+         if (lvl != 5)
+            idle_lap = 0;
+         else if (PC == idle_addr) {
+            if (idle_lap && (memcmp(idle_regs, active_bank, sizeof(idle_regs)) == 0) &&
+                (cc_c(Grp) == idle_c) && (cc_z(Grp) == idle_z)) {
+               cpu_idle();
+               idle_lap = 0;                   /* One more lap before the next sleep */
+               continue;                       /* Let the level scan see the interrupts */
+            }
+            memcpy(idle_regs, active_bank, sizeof(idle_regs));
+            idle_c = cc_c(Grp);
+            idle_z = cc_z(Grp);
+            idle_lap = 1;
+         }
+      }
+      opcode = load16(PC);                     /* Instr to be executed. */
+      opcode0 = opcode >> 8;                   /* Instruction byte 0(H) */
+      opcode1 = opcode & 0xFF;                 /* Instruction byte 1(L) */
+      PC = (PC + 2) & AMASK;
+      STAT_INC(cpu_stats.instr[lvl]);
+      if (debug_reg & 0x01) {                  /* Only the trace prints mnem */
+         val[0] = opcode0;
+         val[1] = opcode1;
+         val[2] = GetMem(PC);                  /* Needed for possible LA */
+         val[3] = GetMem(PC + 1);              /* and BAL instructions. */
+      }
+
+      opclass = op_class[opcode];              /* Handler, see cpu_build_optab */
+      if ((opclass == OP_INV) &&               /* Invalid instruction ? */
+          (test_mode == OFF)) {
+         OP_reg_chk = ON;
+         if (lvl == 1)
+            reason = STOP_INVOP;               /* SIMH stop */
+         continue;
+      }
    }
-   GR[0][Grp] = PC;                            /* Update IAR before execution */
+   active_bank[0] = PC;                        /* Update IAR before execution */
 
-   switch (opcode & 0xF800) {
-      case (0xA800):
+   switch (opclass) {
+      case OP_B:
          /* B    T              [RT]  */
          /* 01234567 89012345
             10101T<- ------>#         */
-         Grp = RegGrp(lvl);
          Tfld = opcode & 0x07FE;
 
          if (opcode & 0x0001)                  /* Check displacement sign */
-            GR[0][Grp] = GR[0][Grp] - Tfld;
+            active_bank[0] = active_bank[0] - Tfld;
          else
-            GR[0][Grp] = GR[0][Grp] + Tfld;
-         PC = GR[0][Grp];                      /* Update PC with new IAR */
+            active_bank[0] = active_bank[0] + Tfld;
+         PC = active_bank[0];                  /* Update PC with new IAR */
          break;
 
-      case (0x9800):
+      case OP_BCL:
          /* BCL  T              [RT]  */
          /* 01234567 89012345
             10011T<- ------>#         */
-         Grp = RegGrp(lvl);
          Tfld = (opcode & 0x07FE);
 
-         if (CL_C[Grp] == ON) {
+         if (cc_c(Grp)) {
             if (opcode & 0x0001)
-               GR[0][Grp] = GR[0][Grp] - Tfld;
+               active_bank[0] = active_bank[0] - Tfld;
             else
-               GR[0][Grp] = GR[0][Grp] + Tfld;
-            PC = GR[0][Grp];                   /* Update PC with new IAR */
+               active_bank[0] = active_bank[0] + Tfld;
+            PC = active_bank[0];               /* Update PC with new IAR */
          }
          break;
 
-      case (0x8800):
+      case OP_BZL:
          /* BZL  T              [RT]  */
          /* 01234567 89012345
             10001T<- ------>#         */
-         Grp = RegGrp(lvl);
          Tfld = (opcode & 0x07FE);
 
-         if (CL_Z[Grp] == ON) {
+         if (cc_z(Grp)) {
             if (opcode & 0x0001)
-               GR[0][Grp] = GR[0][Grp] - Tfld;
+               active_bank[0] = active_bank[0] - Tfld;
             else
-               GR[0][Grp] = GR[0][Grp] + Tfld;
-            PC = GR[0][Grp];                   /* Update PC with new IAR */
+               active_bank[0] = active_bank[0] + Tfld;
+            PC = active_bank[0];               /* Update PC with new IAR */
          }
          break;
 
-      case (0xB800):
+      case OP_BCT:
          /* BCT  R(N),T         [RT]  */
          /* 01234567 89012345
             10111RRN 1T<-->T#         */
          if (opcode1 & 0x80) {                 /* Must be a 1, else it is BAL or LA instr */
-            Grp = RegGrp(lvl);
             Rfld = (opcode0 & 0x06) + 1;       /* Extract odd register nr */
             Nfld = (opcode0 & 0x01);
             Tfld =  opcode1 & 0x7E;
 
             if (Nfld == 0) {                   /* Count is contained in byte 0 only */
-               w_byte = (GR[Rfld][Grp] - 0x00100) & 0x0FF00;
-               GR[Rfld][Grp] = (GR[Rfld][Grp] & 0xF00FF) | w_byte;
+               w_byte = (active_bank[Rfld] - 0x00100) & 0x0FF00;
+               active_bank[Rfld] = (active_bank[Rfld] & 0xF00FF) | w_byte;
             } else {                           /* Count is contained in byte 0 & 1 */
-               w_byte = (GR[Rfld][Grp] - 0x00001) & 0x0FFFF;
-               GR[Rfld][Grp] = (GR[Rfld][Grp] & 0xF0000) | w_byte;
+               w_byte = (active_bank[Rfld] - 0x00001) & 0x0FFFF;
+               active_bank[Rfld] = (active_bank[Rfld] & 0xF0000) | w_byte;
             }
             if ((w_byte & 0xFFFF) == 0x0000)   /* Next instr if result = 0 */
                break;
             if (opcode1 & 0x01)                /* Check displacement sign */
-               GR[0][Grp] = GR[0][Grp] - Tfld;
+               active_bank[0] = active_bank[0] - Tfld;
             else
-               GR[0][Grp] = GR[0][Grp] + Tfld;
-            PC = GR[0][Grp];                   /* Update PC with new IAR */
+               active_bank[0] = active_bank[0] + Tfld;
+            PC = active_bank[0];               /* Update PC with new IAR */
          }
          break;
 
-      case (0xC800):
-      case (0xD800):
-      case (0xE800):
-      case (0xF800):
+      case OP_BB:
          /* BB   R(N),T         [RT]  */
          /* 01234567 89012345
             11MM1RRN MT<-->T#         */
@@ -784,588 +979,403 @@ while (reason == 0) {                          /* Loop until halted */
          else
             Mfld = 0x0080 >> Mfld;             /* Create bit test mask */
 
-         if ((GR[Rfld][Grp] & Mfld) != 0x0000) {  /* Test with mask */
+         if ((active_bank[Rfld] & Mfld) != 0x0000) {  /* Test with mask */
             /* Selected bit is ON, continue at branch addr. */
             if (opcode1 & 0x01)                /* Check displacement sign */
-               GR[0][Grp] = GR[0][Grp] - Tfld;
+               active_bank[0] = active_bank[0] - Tfld;
             else
-               GR[0][Grp] = GR[0][Grp] + Tfld;
-            PC = GR[0][Grp];                   /* Update PC with new IAR */
+               active_bank[0] = active_bank[0] + Tfld;
+            PC = active_bank[0];               /* Update PC with new IAR */
          }
          break;
 
-      case (0x8000):
+      case OP_LRI:
          /* LRI  R(N),I         [RI]  */
          /* 01234567 89012345
             10000RRN I<---->I         */
-         Grp = RegGrp(lvl);
          Rfld = (opcode0 & 0x06) + 1;          /* Extract odd register nr */
          Nfld = (opcode0 & 0x01);
-         /* Reset C&Z latches */
-         CL_Z[Grp] = OFF;
-         CL_C[Grp] = OFF;
-
          if (Nfld == 0) {                      /* Byte 0(H) */
-            GR[Rfld][Grp] = (GR[Rfld][Grp] & 0x300FF) | (opcode1 << 8);
+            active_bank[Rfld] = (active_bank[Rfld] & 0x300FF) | (opcode1 << 8);
          } else {                              /* Byte 1(L) */
-            GR[Rfld][Grp] = (GR[Rfld][Grp] & 0x3FF00) | opcode1;
-         }
-         /* Test selected byte for zero */
-         if (opcode1 == 0x00) {
-            CL_Z[Grp] = ON;
-         } else {
-            CL_C[Grp] = ON;
+            active_bank[Rfld] = (active_bank[Rfld] & 0x3FF00) | opcode1;
          }
+         CC_SET(CC_LOGIC, opcode1, CC_ALL, 0);  /* Test selected byte for zero */
          break;
 
-      case (0x9000):
+      case OP_ARI:
          /* ARI  R(N),I         [RI]  */
          /* 01234567 89012345
             10010RRN I<---->I         */
-         Grp = RegGrp(lvl);
          Rfld = (opcode0 & 0x06) + 1;          /* Extract odd register nr */
          Nfld = (opcode0 & 0x01);
          Ifld =  opcode1;
-         /* Reset C&Z latches */
-         CL_Z[Grp] = OFF;
-         CL_C[Grp] = OFF;
-
          if (Nfld == 0) {                      /* Byte 0(H) */
-            w_byte = GR[Rfld][Grp] + (Ifld << 8);
-            if (((GR[Rfld][Grp] & 0xFFFF) +    /* Overflow from byte 0(H) ? */
-                 (Ifld << 8)) > 0xFFFF)
-               CL_C[Grp] = ON;
-            if ((w_byte & 0xFF00) == 0x0000)   /* Result zero ? */
-               CL_Z[Grp] = ON;
+            w_byte = active_bank[Rfld] + (Ifld << 8);
+            /* C: overflow from byte 0(H), Z: byte 0(H) zero */
+            CC_SET(CC_ARITH, (active_bank[Rfld] & 0xFFFF) + (Ifld << 8), 0xFF00, 0x10000);
             w_byte &= 0x3FFFF;                 /* Remove possible overflow bit */
             /* Store result back in register */
-            GR[Rfld][Grp] = w_byte;
+            active_bank[Rfld] = w_byte;
          } else {                              /* Byte X, 0(H) & 1(L) */
-            w_byte = GR[Rfld][Grp] + Ifld;
-            if (((GR[Rfld][Grp] & 0x0FFFF) +   /* Overflow from byte 1(L) ? */
-                 (Ifld)) > 0xFFFF)
-               CL_C[Grp] = ON;
-            if ((w_byte & 0xFFFF) == 0x0000)   /* Result zero ? (X-byte not include) */
-               CL_Z[Grp] = ON;
+            w_byte = active_bank[Rfld] + Ifld;
+            /* C: overflow from byte 1(L), Z: result zero (X-byte not included) */
+            CC_SET(CC_ARITH, (active_bank[Rfld] & 0xFFFF) + Ifld, 0xFFFF, 0x10000);
             w_byte &= 0x3FFFF;                 /* Remove possible overflow bit */
             /* Store result back in register */
-            GR[Rfld][Grp] = w_byte;
+            active_bank[Rfld] = w_byte;
          }
          break;
 
-      case (0xA000):
+      case OP_SRI:
          /* SRI  R(N),I         [RI]  */
          /* 01234567 89012345
             10100RRN I<---->I         */
-         Grp = RegGrp(lvl);
          Rfld = (opcode0 & 0x06) + 1;          /* Extract odd register nr */
          Nfld = (opcode0 & 0x01);
          Ifld =  opcode1;
-         /* Reset C&Z latches */
-         CL_Z[Grp] = OFF;
-         CL_C[Grp] = OFF;
-
          w_byte = Ifld;                        /* Get second operand */
 
          /* Perform SUB with operand 1 */
          if (Nfld == 0) {                      /* Byte 0(H) result */
-            w_byte = GR[Rfld][Grp] + (~(w_byte << 8)) + 1;
-            if (((GR[Rfld][Grp] & 0x0FF00) +   /* Overflow from byte 0(H) ? */
-                 (~(Ifld << 8) & 0x3FF00) + 0x0100) & 0x10000)
-               CL_C[Grp] = ON;
-            if ((w_byte & 0x0FF00) == 0x0000)  /* Result zero ? (X-byte not include) */
-               CL_Z[Grp] = ON;
+            w_byte = active_bank[Rfld] + (~(w_byte << 8)) + 1;
+            /* C: borrow out of byte 0(H), Z: byte 0(H) zero */
+            CC_SET(CC_ARITH, (active_bank[Rfld] & 0xFF00) - (Ifld << 8), 0xFF00, CC_NEG);
             w_byte &= 0x3FFFF;                 /* Remove possible overflow bit */
          } else {                              /* Byte 0 & 1 result */
-            w_byte = (GR[Rfld][Grp] + (~w_byte) + 1);
-            if (((GR[Rfld][Grp] & 0x0FFFF) +   /* Overflow from byte 0 & 1 ? */
-                 (~Ifld) + 1) & 0x10000)
-               CL_C[Grp] = ON;
-            if ((w_byte & 0xFFFF) == 0x0000)   /* Result zero ? (X-byte not include) */
-               CL_Z[Grp] = ON;
+            w_byte = (active_bank[Rfld] + (~w_byte) + 1);
+            /* C: borrow out of byte 0 & 1, Z: result zero (X-byte not included) */
+            CC_SET(CC_ARITH, (active_bank[Rfld] & 0xFFFF) - Ifld, 0xFFFF, CC_NEG);
             w_byte &= 0x3FFFF;                 /* Remove possible overflow bit */
          }
          /* Store result back in register */
-         GR[Rfld][Grp] = w_byte;
+         active_bank[Rfld] = w_byte;
          break;
 
-      case (0xB000):
+      case OP_CRI:
          /* CRI  R(N),I         [RI]  */
          /* 01234567 89012345
             10110RRN I<---->I         */
-         Grp  = RegGrp(lvl);
          Rfld = (opcode0 & 0x06) + 1;          /* Extract odd register nr */
          Nfld = (opcode0 & 0x01);
          Ifld = opcode1;
-         /* Reset C&Z latches */
-         CL_C[Grp] = OFF;
-         CL_Z[Grp] = OFF;
-
          if (Nfld == 0)                        /* Byte 0(H) */
-            w_byte = (GR[Rfld][Grp] >> 8) & 0xFF;
+            w_byte = (active_bank[Rfld] >> 8) & 0xFF;
          else                                  /* Byte 1(L) */
-            w_byte = GR[Rfld][Grp] & 0x000FF;
-         /* Update C&Z latches */
-         if (w_byte < Ifld)                    /* R < Ifld ? */
-            CL_C[Grp] = ON;
-         if (w_byte == Ifld)                   /* Equal ? */
-            CL_Z[Grp] = ON;
+            w_byte = active_bank[Rfld] & 0x000FF;
+         CC_SET(CC_ARITH, w_byte - Ifld, CC_ALL, CC_NEG);  /* C: R < Ifld, Z: equal */
          break;
 
-      case (0xC000):
+      case OP_XRI:
          /* XRI  R(N),I         [RI]  */
          /* 01234567 89012345
             11000RRN I<---->I         */
-         Grp  = RegGrp(lvl);
          Rfld = (opcode0 & 0x06) + 1;          /* Extract odd register nr */
          Nfld = (opcode0 & 0x01);
          Ifld =  opcode1;
-         /* Reset C&Z latches */
-         CL_C[Grp] = OFF;
-         CL_Z[Grp] = OFF;
-
          if (Nfld == 0) {                      /* Byte 0(H) */
-            GR[Rfld][Grp] = GR[Rfld][Grp] ^ (Ifld << 8);  /* XR */
-            /* Update C&Z latches */
-            if ((GR[Rfld][Grp] & 0x0FF00) == 0x00000)
-               CL_Z[Grp] = ON;
-            else
-               CL_C[Grp] = ON;
+            active_bank[Rfld] = active_bank[Rfld] ^ (Ifld << 8);  /* XR */
+            CC_SET(CC_LOGIC, active_bank[Rfld], 0xFF00, 0);
          } else {                              /* Byte 1(L) */
-            GR[Rfld][Grp] = GR[Rfld][Grp] ^ (Ifld);   /* XR */
-            /* Update C&Z latches */
-            if ((GR[Rfld][Grp] & 0x000FF) == 0x00000)
-               CL_Z[Grp] = ON;
-            else
-               CL_C[Grp] = ON;
+            active_bank[Rfld] = active_bank[Rfld] ^ (Ifld);   /* XR */
+            CC_SET(CC_LOGIC, active_bank[Rfld], 0x00FF, 0);
          }
          break;
 
-      case (0xD000):
+      case OP_ORI:
          /* ORI  R(N),I         [RI]  */
          /* 01234567 89012345
             11010RRN I<---->I         */
-         Grp = RegGrp(lvl);
          Rfld = (opcode0 & 0x06) + 1;          /* Extract odd register nr */
          Nfld = (opcode0 & 0x01);
          Ifld =  opcode1;
-         /* Reset C&Z latches */
-         CL_C[Grp] = OFF;
-         CL_Z[Grp] = OFF;
-
          if (Nfld == 0) {                      /* Byte 0(H) */
-            GR[Rfld][Grp] = GR[Rfld][Grp] | (Ifld << 8);  /* OR */
-            /* Update C&Z latches */
-            if ((GR[Rfld][Grp] & 0x0FF00) == 0x00000)
-               CL_Z[Grp] = ON;
-            else
-               CL_C[Grp] = ON;
+            active_bank[Rfld] = active_bank[Rfld] | (Ifld << 8);  /* OR */
+            CC_SET(CC_LOGIC, active_bank[Rfld], 0xFF00, 0);
          } else {                              /* Byte 1(L) */
-            GR[Rfld][Grp] = GR[Rfld][Grp] | (Ifld);   /* OR */
-            /* Update C&Z latches */
-            if ((GR[Rfld][Grp] & 0x000FF) == 0x00000)
-               CL_Z[Grp] = ON;
-            else
-               CL_C[Grp] = ON;
+            active_bank[Rfld] = active_bank[Rfld] | (Ifld);   /* OR */
+            CC_SET(CC_LOGIC, active_bank[Rfld], 0x00FF, 0);
          }
          break;
 
-      case (0xE000):
+      case OP_NRI:
          /* NRI  R(N),I         [RI]  */
          /* 01234567 89012345
             11100RRN I<---->I         */
-         Grp = RegGrp(lvl);
          Rfld = (opcode0 & 0x06) + 1;          /* Extract odd register nr */
          Nfld = (opcode0 & 0x01);
          Ifld =  opcode1;
-         /* Reset C&Z latches */
-         CL_C[Grp] = OFF;
-         CL_Z[Grp] = OFF;
-
          if (Nfld == 0) {                      /* Byte 0(H) */
             Ifld = (Ifld << 8) | 0xF00FF;
-            GR[Rfld][Grp] = GR[Rfld][Grp] & Ifld;     /* AND */
-            /* Update C&Z latches */
-            if ((GR[Rfld][Grp] & 0x0FF00) == 0x00000)
-               CL_Z[Grp] = ON;
-            else
-               CL_C[Grp] = ON;
+            active_bank[Rfld] = active_bank[Rfld] & Ifld;     /* AND */
+            CC_SET(CC_LOGIC, active_bank[Rfld], 0xFF00, 0);
          } else {                              /* Byte 1(L) */
             Ifld = Ifld | 0x3FF00;
-            GR[Rfld][Grp] = GR[Rfld][Grp] & Ifld;    /* AND */
-            /* Update C&Z latches */
-            if ((GR[Rfld][Grp] & 0x000FF) == 0x00000)
-               CL_Z[Grp] = ON;
-            else
-               CL_C[Grp] = ON;
+            active_bank[Rfld] = active_bank[Rfld] & Ifld;    /* AND */
+            CC_SET(CC_LOGIC, active_bank[Rfld], 0x00FF, 0);
          }
          break;
 
-      case (0xF000):
+      case OP_TRM:
          /* TRM  R(N),I         [RI]  */
          /* 01234567 89012345
             11110RRN I<---->I         */
-         Grp = RegGrp(lvl);
          Rfld = (opcode0 & 0x06) + 1;          /* Extract odd register nr */
          Nfld = (opcode0 & 0x01);
          Ifld =  opcode1;
-         /* Reset C&Z latches */
-         CL_C[Grp] = OFF;
-         CL_Z[Grp] = OFF;
-
          if (Nfld == 0)                        /* Byte 0(H) */
-            w_byte = GR[Rfld][Grp] >> 8;
+            w_byte = active_bank[Rfld] >> 8;
          else                                  /* Byte 1(L) */
-            w_byte = GR[Rfld][Grp] & 0x00FF;
-         /* Update C&Z latches */
-         if ((w_byte & Ifld) == 0x00)
-            CL_Z[Grp] = ON;
-         else
-            CL_C[Grp] = ON;
+            w_byte = active_bank[Rfld] & 0x00FF;
+         CC_SET(CC_LOGIC, w_byte & Ifld, CC_ALL, 0);
          break;
-   }
 
-   switch (opcode & 0x88FF) {
-      case (0x0008):
+      case OP_LCR:
          /* LCR  R1(N1),R2(N2)  [RR]  */
          /* 01234567 89012345
             0R2N0R1N 00001000         */
-         Grp = RegGrp(lvl);
          R1fld = ( opcode0 & 0x06) + 1;        /* Extract reg 1 nr */
          N1fld = ( opcode0 & 0x01);
          R2fld = ((opcode0 & 0x60) >> 4) + 1;  /* Extract reg 2 nr */
          N2fld = ((opcode0 & 0x10) >> 4);
-         /* Reset Z&C latches */
-         CL_C[Grp] = OFF;
-         CL_Z[Grp] = OFF;
-
          /* Fetch the selected byte from R2 */
          if (N2fld == 0)                       /* Byte 0(H) */
-            w_byte = (GR[R2fld][Grp] >> 8) & 0x000FF;
+            w_byte = (active_bank[R2fld] >> 8) & 0x000FF;
          else
-            w_byte = GR[R2fld][Grp] & 0x000FF; /* Byte 1(L) */
+            w_byte = active_bank[R2fld] & 0x000FF; /* Byte 1(L) */
 
          /* Store it the selected byte of R1 */
          if (N1fld == 0)                       /* Byte 0(H) */
-            GR[R1fld][Grp] = (GR[R1fld][Grp] & 0x000FF) | (w_byte << 8);
+            active_bank[R1fld] = (active_bank[R1fld] & 0x000FF) | (w_byte << 8);
          else                                  /* Byte 1(L) */
-            GR[R1fld][Grp] = (GR[R1fld][Grp] & 0x0FF00) | w_byte;
-         /* Set Z Latch if selected byte == 0x00 */
-         if (w_byte == 0x00)
-            CL_Z[Grp] = ON;
-         /* Determine if nr of bits is odd or even and set C latch accordingly */
-         j = 0;
-         for (i = 8; i != 0; i--) {
-            j += w_byte & 0x01;                /* Count the one bits */
-            w_byte >>= 1;
-         }
-         if (j == 0 | j == 2 | j == 4 | j == 6 | j == 8)
-            CL_C[Grp] = ON;                    /* Update C latch */
-         else
-            CL_C[Grp] = OFF;
+            active_bank[R1fld] = (active_bank[R1fld] & 0x0FF00) | w_byte;
+         /* Z: selected byte == 0x00, C: even nr of one bits */
+         CC_SET(CC_PARITY, w_byte, 0x00FF, 0);
          break;
 
-      case (0x0018):
+      case OP_ACR:
          /* ACR  R1(N1),R2(N2)  [RR]  */
          /* 01234567 89012345
             0R2N0R1N 00011000         */
-         Grp = RegGrp(lvl);
          R1fld = ( opcode0 & 0x06) + 1;        /* Extract reg 1 nr */
          R2fld = ((opcode0 & 0x60) >> 4) + 1;  /* Extract reg 2 nr */
          N1fld = ( opcode0 & 0x01);
          N2fld = ((opcode0 & 0x10) >> 4);
-         /* Reset Z&C latches */
-         CL_Z[Grp] = OFF;
-         CL_C[Grp] = OFF;
-
          /* Fetch the selected byte from R2 */
          if (N2fld == 0)                       /* Byte 0(H) */
-            w_byte = (GR[R2fld][Grp] >> 8) & 0x000FF;
+            w_byte = (active_bank[R2fld] >> 8) & 0x000FF;
          else
-            w_byte = GR[R2fld][Grp] & 0x000FF; /* Byte 1(L) */
+            w_byte = active_bank[R2fld] & 0x000FF; /* Byte 1(L) */
 
          /* Perform ADD with the selected byte from R1 */
          if (N1fld == 0) {                     /* Byte 0(H) result */
-            w_byte = GR[R1fld][Grp] + (w_byte << 8);
-            if ((w_byte & 0x0FF00) == 0x00)    /* Zero ? */
-               CL_Z[Grp] = ON;
+            w_byte = active_bank[R1fld] + (w_byte << 8);
+            CC_SET(CC_ARITH, w_byte, 0xFF00, CC_OVF);  /* Overflow ? Zero ? */
          } else {                              /* Byte 0 & 1 result */
-            w_byte = GR[R1fld][Grp] + w_byte;
-            if ((w_byte & 0x0FFFF) == 0x00000) /* Zero ? */
-               CL_Z[Grp] = ON;
+            w_byte = active_bank[R1fld] + w_byte;
+            CC_SET(CC_ARITH, w_byte, 0xFFFF, CC_OVF);  /* Overflow ? Zero ? */
          }
-         if (w_byte > 0xFFFF)                  /* Overflow ? */
-            CL_C[Grp] = ON;
          /* Remove possible overflow bit and save the result */
-         GR[R1fld][Grp] = w_byte & 0x3FFFF;
+         active_bank[R1fld] = w_byte & 0x3FFFF;
          break;
 
-      case (0x0028):
+      case OP_SCR:
          /* SCR  R1(N1),R2(N2)  [RR]  */
          /* 01234567 89012345
             0R2N0R1N 00101000         */
-         Grp = RegGrp(lvl);
          R1fld = ( opcode0 & 0x06) + 1;        /* Extract reg 1 nr */
          N1fld = ( opcode0 & 0x01);
          R2fld = ((opcode0 & 0x60) >> 4)  + 1; /* Extract reg 2 nr */
          N2fld = ((opcode0 & 0x10) >> 4);
-         /* Reset Z&C latches */
-         CL_Z[Grp] = OFF;
-         CL_C[Grp] = OFF;
-
          int32 R2H, R2L;
 
          if (N1fld == 0) {                     /* R1 = Byte 0(H) only */
             if (N2fld == 0) {                  /* R2 = Byte 0(H)  */
                                      /* SCR: R1(H.) = R1(H.) - R2(H.) */
-               w_byte = (GR[R2fld][Grp]) & 0x0FF00;
+               w_byte = (active_bank[R2fld]) & 0x0FF00;
             } else {                           /* R2 = Byte 1(L) */
                                      /* SCR: R1(H.) = R1(H.) - R2(.L) */
-               w_byte = (GR[R2fld][Grp] << 8) & 0x0FF00;
+               w_byte = (active_bank[R2fld] << 8) & 0x0FF00;
             }
-            if (w_byte > (GR[R1fld][Grp] & 0x0FF00))  /* Result < 0 ? */
-               CL_C[Grp] = ON;
+            /* C: result < 0, Z: result zero */
+            CC_SET(CC_ARITH, (active_bank[R1fld] & 0xFF00) - w_byte, 0xFF00, CC_NEG);
             R2H = ~(w_byte);
             R2H = (R2H + 0x00100) & 0x3FF00;   /* 2-complement */
-            GR[R1fld][Grp] = (GR[R1fld][Grp] + R2H) & 0x3FFFF;
-            if ((GR[R1fld][Grp] & 0x0FF00) == 0x00)   /* Result zero ?*/
-               CL_Z[Grp] = ON;
-
+            active_bank[R1fld] = (active_bank[R1fld] + R2H) & 0x3FFFF;
          } else {     /* N1fld == 1 */         /* R1 = Byte H & L */
 
             if (N2fld == 0) {                  /* R2 = Byte 0(H)  */
                                      /* SCR: R1(HL) = R1(HL) - R2(H.) */
-               w_byte = (GR[R2fld][Grp] >> 8) & 0x000FF;
+               w_byte = (active_bank[R2fld] >> 8) & 0x000FF;
             } else {                           /* R2 = Byte 1(L)  */
                                      /* SCR: R1(HL) = R1(HL) - R2(.L) */
-               w_byte = (GR[R2fld][Grp]) & 0x000FF;
+               w_byte = (active_bank[R2fld]) & 0x000FF;
             }
-            if (w_byte > (GR[R1fld][Grp] & 0x0FFFF))  /* Result < 0 ? */
-               CL_C[Grp] = ON;
+            /* C: result < 0, Z: result zero */
+            CC_SET(CC_ARITH, (active_bank[R1fld] & 0xFFFF) - w_byte, 0xFFFF, CC_NEG);
             R2L = ~(w_byte);
             R2L = (R2L + 1) & 0x3FFFF;         /* 2-complement */
-            GR[R1fld][Grp] = (GR[R1fld][Grp] + R2L) & 0x3FFFF;
-            if ((GR[R1fld][Grp] & 0x0FFFF) == 0x0000) /* Result zero ?*/
-               CL_Z[Grp] = ON;
+            active_bank[R1fld] = (active_bank[R1fld] + R2L) & 0x3FFFF;
          }
          break;
 
-      case (0x0038):
+      case OP_CCR:
          /* CCR  R1(N1),R2(N2)  [RR]  */
          /* 01234567 89012345
             0R2N0R1N 00111000         */
-         Grp = RegGrp(lvl);
          R1fld = ( opcode0 & 0x06) + 1;        /* Extract reg 1 nr */
          R2fld = ((opcode0 & 0x60) >> 4) + 1;  /* Extract reg 2 nr */
          N1fld = ( opcode0 & 0x01);
          N2fld = ((opcode0 & 0x10) >> 4);
-         /* Reset Z&C latches */
-         CL_Z[Grp] = OFF;
-         CL_C[Grp] = OFF;
-
          /* Fetch the required byte from R2 */
          if (N2fld == 0)
-            w_byte = GR[R2fld][Grp] >> 8;      /* Byte 0(H) */
+            w_byte = active_bank[R2fld] >> 8;  /* Byte 0(H) */
          else
-            w_byte = GR[R2fld][Grp] & 0x000FF; /* Byte 1(L) */
+            w_byte = active_bank[R2fld] & 0x000FF; /* Byte 1(L) */
 
          /* Perform a compare between the selected regs */
-         if (N1fld == 0) {                     /* Byte 0(H) */
-            if (( GR[R1fld][Grp] >> 8) < w_byte)
-               CL_C[Grp] = ON;
-            if (( GR[R1fld][Grp] >> 8) == w_byte)
-               CL_Z[Grp] = ON;
-         } else {                              /* Byte 1(L) */
-            if (( GR[R1fld][Grp] & 0x00FF) < w_byte)
-               CL_C[Grp] = ON;
-            if (( GR[R1fld][Grp] & 0x00FF) == w_byte)
-               CL_Z[Grp] = ON;
-         }
+         if (N1fld == 0)                       /* Byte 0(H) */
+            CC_SET(CC_ARITH, (active_bank[R1fld] >> 8) - w_byte, CC_ALL, CC_NEG);
+         else                                  /* Byte 1(L) */
+            CC_SET(CC_ARITH, (active_bank[R1fld] & 0x00FF) - w_byte, CC_ALL, CC_NEG);
          break;
 
-      case (0x0048):
+      case OP_XCR:
          /* XCR  R1(N1),R2(N2)  [RR]  */
          /* 01234567 89012345
             0R2N0R1N 01001000         */
-         Grp = RegGrp(lvl);
          R1fld = ( opcode0 & 0x06) + 1;        /* Extract odd reg 1 nr */
          R2fld = ((opcode0 & 0x60) >> 4) + 1;  /* Extract odd reg 2 nr */
          N1fld = ( opcode0 & 0x01);
          N2fld = ((opcode0 & 0x10) >> 4);
-         /* Reset Z&C latches */
-         CL_Z[Grp] = OFF;
-         CL_C[Grp] = OFF;
-
          /* Fetch the selected byte from R2 */
          if (N2fld == 0)                       /* Byte 0(H) */
-            w_byte = (GR[R2fld][Grp] >> 8) & 0x000FF;
+            w_byte = (active_bank[R2fld] >> 8) & 0x000FF;
          else
-            w_byte = GR[R2fld][Grp] & 0x000FF; /* Byte 1(L) */
+            w_byte = active_bank[R2fld] & 0x000FF; /* Byte 1(L) */
 
          /* Perform XOR with the selected byte from R1 */
          if (N1fld == 0) {                     /* Byte 0(H) */
-            GR[R1fld][Grp] ^= (w_byte << 8);
-            if ((GR[R1fld][Grp] & 0xFF00) == 0x00)
-               CL_Z[Grp] = ON;
-            else
-               CL_C[Grp] = ON;
+            active_bank[R1fld] ^= (w_byte << 8);
+            CC_SET(CC_LOGIC, active_bank[R1fld], 0xFF00, 0);
          } else {                              /* Byte 1(L) */
-            GR[R1fld][Grp] ^= w_byte;
-            if ((GR[R1fld][Grp] & 0x00FF) == 0x00)
-               CL_Z[Grp] = ON;
-            else
-               CL_C[Grp] = ON;
+            active_bank[R1fld] ^= w_byte;
+            CC_SET(CC_LOGIC, active_bank[R1fld], 0x00FF, 0);
          }
          break;
 
-      case (0x0058):
+      case OP_OCR:
          /* OCR  R1(N1),R2(N2)  [RR]  */
          /* 01234567 89012345
             0R2N0R1N 01011000         */
-         Grp = RegGrp(lvl);
          R1fld = ( opcode0 & 0x06) + 1;        /* Extract odd reg 1 nr */
          N1fld = ( opcode0 & 0x01);
          R2fld = ((opcode0 & 0x60) >> 4) + 1;  /* Extract odd reg 2 nr */
          N2fld = ((opcode0 & 0x10) >> 4);
-         /* Reset Z&C latches */
-         CL_Z[Grp] = OFF;
-         CL_C[Grp] = OFF;
-
          /* Fetch the selected byte from R2 */
          if (N2fld == 0)                       /* Byte 0(H) */
-            w_byte = (GR[R2fld][Grp] >> 8) & 0x000FF;
+            w_byte = (active_bank[R2fld] >> 8) & 0x000FF;
          else
-            w_byte = GR[R2fld][Grp] & 0x000FF; /* Byte 1(L) */
+            w_byte = active_bank[R2fld] & 0x000FF; /* Byte 1(L) */
 
          /* Perform OR with the selected byte from R1 */
          if (N1fld == 0) {                     /* Byte 0(H) */
-            GR[R1fld][Grp] |= (w_byte << 8);
-            if ((GR[R1fld][Grp] & 0x0FF00) == 0x00)
-               CL_Z[Grp] = ON;
-            else
-               CL_C[Grp] = ON;
+            active_bank[R1fld] |= (w_byte << 8);
+            CC_SET(CC_LOGIC, active_bank[R1fld], 0xFF00, 0);
          } else {                              /* Byte 1(L) */
-            GR[R1fld][Grp] |= w_byte;
-            if ((GR[R1fld][Grp] & 0x000FF) == 0x00)
-               CL_Z[Grp] = ON;
-            else
-               CL_C[Grp] = ON;
+            active_bank[R1fld] |= w_byte;
+            CC_SET(CC_LOGIC, active_bank[R1fld], 0x00FF, 0);
          }
          break;
 
-      case (0x0068):
+      case OP_NCR:
          /* NCR  R1(N1),R2(N2)  [RR]  */
          /* 01234567 89012345
             0R2N0R1N 01101000         */
-         Grp = RegGrp(lvl);
          R1fld = ( opcode0 & 0x06) + 1;        /* Extract odd reg 1 nr */
          R2fld = ((opcode0 & 0x60) >> 4) + 1;  /* Extract odd reg 2 nr */
          N1fld = ( opcode0 & 0x01);
          N2fld = ((opcode0 & 0x10) >> 4);
-         /* Reset Z&C latches */
-         CL_Z[Grp] = OFF;
-         CL_C[Grp] = OFF;
-
          /* Fetch the selected byte from R2 */
          if (N2fld == 0)                       /* Byte 0(H) */
-            w_byte = (GR[R2fld][Grp] >> 8) & 0x000FF;
+            w_byte = (active_bank[R2fld] >> 8) & 0x000FF;
          else
-            w_byte = GR[R2fld][Grp] & 0x000FF; /* Byte 1(L) */
+            w_byte = active_bank[R2fld] & 0x000FF; /* Byte 1(L) */
 
          /* Perform AND with the selected byte from R1 */
          if (N1fld == 0) {
-            GR[R1fld][Grp] &= ((w_byte << 8) | 0xF00FF);
-            if ((GR[R1fld][Grp] & 0x0FF00) == 0x00)
-               CL_Z[Grp] = ON;
-            else
-               CL_C[Grp] = ON;
+            active_bank[R1fld] &= ((w_byte << 8) | 0xF00FF);
+            CC_SET(CC_LOGIC, active_bank[R1fld], 0xFF00, 0);
          } else {
-            GR[R1fld][Grp] &= (w_byte | 0x3FF00);
-            if ((GR[R1fld][Grp] & 0x000FF) == 0x00)
-               CL_Z[Grp] = ON;
-            else
-               CL_C[Grp] = ON;
+            active_bank[R1fld] &= (w_byte | 0x3FF00);
+            CC_SET(CC_LOGIC, active_bank[R1fld], 0x00FF, 0);
          }
          break;
 
-      case (0x0078):
+      case OP_LCOR:
          /* LCOR R1(N1),R2(N2)  [RR]  */
          /* 01234567 89012345
             0R2N0R1N 01111000         */
-         Grp = RegGrp(lvl);
          R1fld = ( opcode0 & 0x06) + 1;        /* Extract odd reg 1 nr */
          R2fld = ((opcode0 & 0x60) >> 4) + 1;  /* Extract odd reg 2 nr */
          N1fld = ( opcode0 & 0x01);
          N2fld = ((opcode0 & 0x10) >> 4);
-         /* Reset Z&C latches */
-         CL_Z[Grp] = OFF;
-         CL_C[Grp] = OFF;
-
          /* Fetch the selected byte from R2 */
          if (N2fld == 0)                       /* Byte 0(H) */
-            w_byte = (GR[R2fld][Grp] >> 8) & 0x000FF;
+            w_byte = (active_bank[R2fld] >> 8) & 0x000FF;
          else
-            w_byte = GR[R2fld][Grp] & 0x000FF; /* Byte 1(L) */
+            w_byte = active_bank[R2fld] & 0x000FF; /* Byte 1(L) */
 
-         /* Determine C latch and Shift one byte to the right */
-         if ((w_byte & 0x00001) == 0x0001)     /* Will we loose a one bit? */
-            CL_C[Grp] = ON;
+         /* C: a one bit shifted out, Z: shifted byte zero */
+         CC_SET(CC_ARITH, w_byte, 0x00FE, 0x0001);
          w_byte = w_byte >> 1;                 /* Shift 1 bit right */
 
          /* Store it the selected byte of R1 */
          if (N1fld == 0)                       /* Byte 0(H) */
-            GR[R1fld][Grp] = (GR[R1fld][Grp] & 0x000FF) | (w_byte << 8);
+            active_bank[R1fld] = (active_bank[R1fld] & 0x000FF) | (w_byte << 8);
          else                                  /* Byte 1(L) */
-            GR[R1fld][Grp] = (GR[R1fld][Grp] & 0x0FF00) | w_byte;
-         /* Set Z Latch */
-         if (w_byte == 0x00)
-            CL_Z[Grp] = ON;
+            active_bank[R1fld] = (active_bank[R1fld] & 0x0FF00) | w_byte;
          break;
 
-      case (0x0010):
+      case OP_ICT:
          /* ICT  R(N),B         [RSA] */
          /* 01234567 89012345
             0BBB0RRN 00010000         */
-         Grp = RegGrp(lvl);
          Bfld = (opcode0 >> 4) & 0x007;
          Rfld = (opcode0 & 0x06) + 1;          /* Extract odd register nr */
          Nfld = (opcode0 & 0x01);
 
-         addr = GR[Bfld][Grp];                 /* See PoO 4-9 */
+         addr = active_bank[Bfld];             /* See PoO 4-9 */
          w_byte = GetMem(addr);
-         GR[Bfld][Grp] = GR[Bfld][Grp] + 1;
+         active_bank[Bfld] = active_bank[Bfld] + 1;
          if (Nfld == 0) {                      /* Byte 0(H) */
-            GR[Rfld][Grp] = (GR[Rfld][Grp] & 0xF00FF) | (w_byte << 8);
+            active_bank[Rfld] = (active_bank[Rfld] & 0xF00FF) | (w_byte << 8);
          } else {                              /* Byte 1(L) */
-            GR[Rfld][Grp] = (GR[Rfld][Grp] & 0x3FF00) | w_byte;
+            active_bank[Rfld] = (active_bank[Rfld] & 0x3FF00) | w_byte;
          }
          break;
 
-      case (0x0030):
+      case OP_STCT:
          /* STCT R(N),B         [RSA] */
          /* 01234567 89012345
             0BBB0RRN 00110000         */
-         Grp = RegGrp(lvl);
          Bfld = (opcode0 >> 4) & 0x007;
          Rfld = (opcode0 & 0x06) + 1;          /* Extract odd register nr */
          Nfld = (opcode0 & 0x01);
 
-         addr = GR[Bfld][Grp];                 /* See PoO 4-13 */
-         GR[Bfld][Grp] = GR[Bfld][Grp] + 1;
+         addr = active_bank[Bfld];             /* See PoO 4-13 */
+         active_bank[Bfld] = active_bank[Bfld] + 1;
          if (Nfld == 0)                        /* Byte 0(H) */
-            w_byte = (GR[Rfld][Grp] >> 8) & 0x000FF;
+            w_byte = (active_bank[Rfld] >> 8) & 0x000FF;
          else
-            w_byte = GR[Rfld][Grp] & 0x000FF;  /* Byte 1(L) */
+            w_byte = active_bank[Rfld] & 0x000FF;  /* Byte 1(L) */
          PutMem(addr, w_byte);
          break;
-   }
 
-   switch (opcode & 0x8880) {
-      case (0x0800):
+      case OP_IC:
          /* IC   R(N),D(B)      [RS]  */
          /* 01234567 89012345
             0BBB1RRN 0D<--->D         */
-         Grp = RegGrp(lvl);
          Bfld = (opcode0 >> 4) & 0x007;
          Rfld = (opcode0 & 0x06) + 1;          /* Extract odd register nr */
          Nfld = (opcode0 & 0x01);
@@ -1374,36 +1384,22 @@ while (reason == 0) {                          /* Loop until halted */
          if (Bfld == 0)
             addr = 0x00680 + Dfld;             /* See PoO 4-9 */
          else
-            addr = GR[Bfld][Grp] + Dfld;
+            addr = active_bank[Bfld] + Dfld;
          w_byte = GetMem(addr);
 
          if (Nfld == 0)                        /* Byte 0(H) */
-            GR[Rfld][Grp] = (GR[Rfld][Grp] & 0xF00FF) | (w_byte << 8);
+            active_bank[Rfld] = (active_bank[Rfld] & 0xF00FF) | (w_byte << 8);
          else                                  /* Byte 1(L) */
-            GR[Rfld][Grp] = (GR[Rfld][Grp] & 0x3FF00) | w_byte;
+            active_bank[Rfld] = (active_bank[Rfld] & 0x3FF00) | w_byte;
 
-         /* Test the selected byte (w_byte) */
-         if (w_byte == 0x00)
-            CL_Z[Grp] = ON;
-         else
-            CL_Z[Grp] = OFF;
-         /* Determine if nr of bits is odd or even and set C latch accordingly */
-         j = 0;
-         for (i = 8; i != 0; i--) {
-            j += w_byte & 0x01;                /* Count the one bits */
-            w_byte >>= 1;
-         }
-         if (j == 0 | j == 2 | j == 4 | j == 6 | j == 8)
-            CL_C[Grp] = ON;
-         else
-            CL_C[Grp] = OFF;
+         /* Z: selected byte zero, C: even nr of one bits */
+         CC_SET(CC_PARITY, w_byte, 0x00FF, 0);
          break;
 
-      case (0x0880):
+      case OP_STC:
          /* STC  R(N),D(B)      [RS]  */
          /* 01234567 89012345
             0BBB1RRN 1D<--->D         */
-         Grp = RegGrp(lvl);
          Bfld = (opcode0 >> 4) & 0x07;
          Dfld = (opcode1) & 0x7F;
          Rfld = (opcode0 & 0x06) + 1;          /* Extract odd register nr */
@@ -1412,22 +1408,19 @@ while (reason == 0) {                          /* Loop until halted */
          if (Bfld == 0)
             addr = 0x00680 + Dfld;             /* See PoO 4-13 */
          else
-            addr = GR[Bfld][Grp] + Dfld;
+            addr = active_bank[Bfld] + Dfld;
 
          if (Nfld == 0)
-            w_byte = (GR[Rfld][Grp] >> 8) & 0x000FF;
+            w_byte = (active_bank[Rfld] >> 8) & 0x000FF;
          else
-            w_byte = (GR[Rfld][Grp] & 0x000FF);
+            w_byte = (active_bank[Rfld] & 0x000FF);
          PutMem(addr, w_byte);
          break;
-   }
 
-   switch (opcode & 0x8881) {
-      case (0x0001):
+      case OP_LH:
          /* LH   R,D(B)         [RS]  */
          /* 01234567 89012345
             0BBB0RRR 0D<-->D1         */
-         Grp = RegGrp(lvl);
          Bfld = (opcode0 >> 4) & 0x007;
          Dfld = (opcode1) & 0x7E;
          Rfld = (opcode0) & 0x007;             /* Extract register nr */
@@ -1435,30 +1428,20 @@ while (reason == 0) {                          /* Loop until halted */
          if (Bfld == 0)
             addr = 0x00700 + Dfld;             /* See PoO 4-10 */
          else
-            addr = (GR[Bfld][Grp] + Dfld);
+            addr = (active_bank[Bfld] + Dfld);
          addr &= 0x3FFFE;                      /* Force HW boundary */
 
-         w_byte = GetMem(addr) << 8;
-         addr++;
-         w_byte = w_byte | GetMem(addr);
-         GR[Rfld][Grp] = w_byte;               /* X-byte = 0 */
+         w_byte = load16(addr);
+         active_bank[Rfld] = w_byte;           /* X-byte = 0 */
          if (Rfld == 0) break;                 /* New IAR ! */
 
-         /* Update C&Z latches */
-         if (w_byte == 0x0000) {
-            CL_Z[Grp] = ON;
-            CL_C[Grp] = OFF;
-         } else {
-            CL_Z[Grp] = OFF;
-            CL_C[Grp] = ON;
-         }
+         CC_SET(CC_LOGIC, w_byte, CC_ALL, 0);  /* Update C&Z latches */
          break;
 
-      case (0x0081):
+      case OP_STH:
          /* STH  R,D(B)         [RS]  */
          /* 01234567 89012345
             0BBB0RRR 1D<-->D1         */
-         Grp = RegGrp(lvl);
          Bfld = (opcode0 >> 4) & 0x007;
          Rfld = (opcode0) & 0x007;             /* Extract register nr */
          Dfld = (opcode1) & 0x7E;
@@ -1466,26 +1449,16 @@ while (reason == 0) {                          /* Loop until halted */
          if (Bfld == 0)
             addr = 0x00700 + Dfld;             /* See PoO 4-4 */
          else
-            addr = (GR[Bfld][Grp] + Dfld);
+            addr = (active_bank[Bfld] + Dfld);
          addr &= 0x3FFFE;                      /* Force HW boundary */
 
-         if (Rfld > 0) {
-            PutMem(addr, (GR[Rfld][Grp] >> 8) & 0x000FF);
-            addr++;
-            PutMem(addr, GR[Rfld][Grp] & 0x000FF);
-         } else {
-            PutMem(addr,   0x00);
-            PutMem(addr+1, 0x00);
-         }
+         store16(addr, (Rfld > 0) ? active_bank[Rfld] & 0x0FFFF : 0x00);
          break;
-   }
 
-   switch (opcode & 0x8883) {
-      case (0x0002):
+      case OP_L:
          /* L    R,D(B)         [RS]  */
          /* 01234567 89012345
             0BBB0RRR 0D<->D10         */
-         Grp = RegGrp(lvl);
          Bfld = (opcode0 >> 4) & 0x007;
          Dfld = (opcode1) & 0x7C;              /* Dfld at fullword boundary */
          Rfld = (opcode0) & 0x007;             /* Extract register nr */
@@ -1493,30 +1466,20 @@ while (reason == 0) {                          /* Loop until halted */
          if (Bfld == 0)
             addr = 0x00780 + Dfld;             /* See PoO 4-10 */
          else
-            addr = (GR[Bfld][Grp] + Dfld);
+            addr = (active_bank[Bfld] + Dfld);
          addr &= 0x3FFFE;                      /* Force HW boundary */
 
-         w_byte = (GetMem(addr+1) & 0x03) << 16; /* Load X-byte */
-         w_byte |= GetMem(addr+2) << 8;        /* Byte 0(H) */
-         w_byte |= GetMem(addr+3);             /* Byte 1(L) */
-         GR[Rfld][Grp] = w_byte;
+         w_byte = load32(addr) & 0x3FFFF;      /* X-byte bits + byte 0(H) 1(L) */
+         active_bank[Rfld] = w_byte;
          if (Rfld == 0) break;                 /* New IAR ! */
 
-         /* Update C&Z latches */
-         if (w_byte == 0x00000) {              /* Test includes X-byte */
-            CL_Z[Grp] = ON;
-            CL_C[Grp] = OFF;
-         } else {
-            CL_Z[Grp] = OFF;
-            CL_C[Grp] = ON;
-         }
+         CC_SET(CC_LOGIC, w_byte, CC_ALL, 0);  /* Test includes X-byte */
          break;
 
-      case (0x0082):
+      case OP_ST:
          /* ST   R,D(B)         [RS]  */
          /* 01234567 89012345
             0BBB0RRR 1D<->D10         */
-         Grp = RegGrp(lvl);
          Bfld = (opcode0 >> 4) & 0x007;
          Dfld = (opcode1) & 0x7C;              /* Dfld at fullword boundary */
          Rfld = (opcode0) & 0x07;              /* Extract register nr */
@@ -1524,408 +1487,261 @@ while (reason == 0) {                          /* Loop until halted */
          if (Bfld == 0)
             addr = 0x00780 + Dfld;             /* See PoO 4-12 */
          else
-            addr = (GR[Bfld][Grp] + Dfld);
+            addr = (active_bank[Bfld] + Dfld);
          addr &= 0x3FFFE;                      /* Force HW boundary */
 
-         if (Rfld > 0) {
-            PutMem(addr+3,  GR[Rfld][Grp] & 0xFF);
-            PutMem(addr+2, (GR[Rfld][Grp] >> 8) & 0xFF);
-            w_byte = GetMem(addr+1) & 0xFC;    /* Keep the high 6 bits */
-            PutMem(addr+1, w_byte | ((GR[Rfld][Grp] >> 16) & 0x03));
-         } else {
-            PutMem(addr+3, 0x00);              /* Clear mem locations */
-            PutMem(addr+2, 0x00);
-            w_byte = GetMem(addr+1) & 0xFC;    /* Keep the high 6 bits */
-            PutMem(addr+1, w_byte);            /* Clear X-byte bits */
-         }
+         w_byte = load32(addr) & 0xFFFC0000;   /* Keep byte 0 + high 6 X-bits */
+         if (Rfld > 0)                         /* R0 stores zeroes */
+            w_byte |= active_bank[Rfld] & 0x3FFFF;
+         store32(addr, w_byte);
          // NOTE: special condition ST inst at loc 0x0010 to be implemented !!
          break;
-   }
 
-   switch (opcode & 0x88FF) {
-      case (0x0080):
+      case OP_LHR:
          /* LHR  R1,R2          [RR]  */
          /* 01234567 89012345
             0R2R0R1R 10000000         */
-         Grp = RegGrp(lvl);
          R2fld = ((opcode0 & 0x70) >> 4);      /* Extract register 2 */
          R1fld = ( opcode0 & 0x07);            /* Extract register 1 */
 
-         w_byte = GR[R2fld][Grp] & 0x0FFFF;    /* Load R1 with contents of R2 */
-         GR[R1fld][Grp] = w_byte;
+         w_byte = active_bank[R2fld] & 0x0FFFF;    /* Load R1 with contents of R2 */
+         active_bank[R1fld] = w_byte;
          /* If R1 = Register 0, a branch to newly formed address occurs */
          if (R1fld == 0) break;
 
-         /* Update C&Z latches */
-         if (GR[R1fld][Grp] == 0x0000) {
-            CL_Z[Grp] = ON;
-            CL_C[Grp] = OFF;
-         } else {
-            CL_Z[Grp] = OFF;
-            CL_C[Grp] = ON;
-         }
+         CC_SET(CC_LOGIC, w_byte, CC_ALL, 0);  /* Update C&Z latches */
          break;
 
-      case (0x0090):
+      case OP_AHR:
          /* AHR  R1,R2          [RR]  */
          /* 01234567 89012345
             0R2R0R1R 10001000         */
-         Grp = RegGrp(lvl);
          R2fld = ((opcode0 & 0x70) >> 4);      /* Extract register 2 */
          R1fld = ( opcode0 & 0x007);           /* Extract register 1 */
 
-         w_byte = (GR[R1fld][Grp] & 0xFFFF) + (GR[R2fld][Grp] & 0xFFFF);
-         GR[R1fld][Grp] = (GR[R1fld][Grp] & 0xF0000) | (w_byte & 0xFFFF);
+         w_byte = (active_bank[R1fld] & 0xFFFF) + (active_bank[R2fld] & 0xFFFF);
+         active_bank[R1fld] = (active_bank[R1fld] & 0xF0000) | (w_byte & 0xFFFF);
          /* If R1 = Register 0, a branch to newly formed address occurs */
          if (R1fld == 0) break;
 
-         /* Reset C&Z latches */
-         CL_C[Grp] = OFF;
-         CL_Z[Grp] = OFF;
-         /* Update C&Z latches */
-         if (w_byte & 0x10000)                 /* Overflow ? */
-            CL_C[Grp] = ON;
-         if ((w_byte & 0xFFFF) == 0x0000)      /* Result 0 ? */
-            CL_Z[Grp] = ON;
+         CC_SET(CC_ARITH, w_byte, 0xFFFF, 0x10000);  /* Overflow ? Result 0 ? */
          break;
 
-      case (0x00A0):
+      case OP_SHR:
          /* SHR  R1,R2          [RR]  */
          /* 01234567 89012345
             0R2R0R1R 10011000         */
-         Grp = RegGrp(lvl);
          R2fld = ((opcode0 & 0x70) >> 4);      /* Extract register 2 */
          R1fld = ( opcode0 & 0x007);           /* Extract register 1 */
 
-         w_byte = GR[R1fld][Grp] + ~(GR[R2fld][Grp]) + 1;
-         GR[R1fld][Grp] = w_byte & 0xFFFF;     /* Remove possible overflow bit */
+         w_byte = active_bank[R1fld] + ~(active_bank[R2fld]) + 1;
+         active_bank[R1fld] = w_byte & 0xFFFF; /* Remove possible overflow bit */
          /* If R1 = Register 0, a branch to newly formed address occurs */
          if (R1fld == 0) break;
 
-         /* Reset C&Z latches */
-         CL_C[Grp] = OFF;
-         CL_Z[Grp] = OFF;
-         /* Update C&Z latches */
-         if (w_byte & 0x10000)                 /* Result < 0 ? */
-            CL_C[Grp] = ON;
-         if (GR[R1fld][Grp] == 0x0000)         /* Result == 0 ? */
-            CL_Z[Grp] = ON;
+         CC_SET(CC_ARITH, w_byte, 0xFFFF, 0x10000);  /* Result < 0 ? Result == 0 ? */
          break;
 
-      case (0x00B0):
+      case OP_CHR:
          /* CHR  R1,R2          [RR]  */
          /* 01234567 89012345
             0R2R0R1R 10110000         */
-         Grp = RegGrp(lvl);
          R2fld = ((opcode0 & 0x70) >> 4);      /* Extract register 2 */
          R1fld = ( opcode0 & 0x007);           /* Extract register 1 */
-         /* Reset C&Z latches */
-         CL_C[Grp] = OFF;
-         CL_Z[Grp] = OFF;
-
-         /* Test if R1 is < R2 */
-         if ((GR[R1fld][Grp] & 0xFFFF) ==      /* Compare for equal */
-             (GR[R2fld][Grp] & 0xFFFF))
-            CL_Z[Grp] = ON;
-         if ((GR[R1fld][Grp] & 0xFFFF) <       /* Compare for less */
-             (GR[R2fld][Grp] & 0xFFFF))
-            CL_C[Grp] = ON;
+         /* Compare for less (C) and for equal (Z) */
+         CC_SET(CC_ARITH, (active_bank[R1fld] & 0xFFFF) - (active_bank[R2fld] & 0xFFFF),
+                CC_ALL, CC_NEG);
          break;
 
-      case (0x00C0):
+      case OP_XHR:
          /* XHR  R1,R2          [RR]  */
          /* 01234567 89012345
             0R2R0R1R 11000000         */
-         Grp = RegGrp(lvl);
          R2fld = ((opcode0 & 0x70) >> 4);      /* Extract register 2 */
          R1fld = ( opcode0 & 0x007);           /* Extract register 1 */
 
-         w_byte = (GR[R1fld][Grp] & 0x0FFFF) ^ (GR[R2fld][Grp] & 0x0FFFF);
-         GR[R1fld][Grp] = (GR[R1fld][Grp] & 0xF0000) | w_byte;  /* XHR */
+         w_byte = (active_bank[R1fld] & 0x0FFFF) ^ (active_bank[R2fld] & 0x0FFFF);
+         active_bank[R1fld] = (active_bank[R1fld] & 0xF0000) | w_byte;  /* XHR */
          /* If R1 = Register 0, a branch to newly formed address occurs */
          if (R1fld == 0) break;
 
-         /* Update C&Z latches */
-         if (w_byte == 0x0000) {
-            CL_Z[Grp] = ON;
-            CL_C[Grp] = OFF;
-         } else {
-            CL_Z[Grp] = OFF;
-            CL_C[Grp] = ON;
-         }
+         CC_SET(CC_LOGIC, w_byte, CC_ALL, 0);  /* Update C&Z latches */
          break;
 
-      case (0x00D0):
+      case OP_OHR:
          /* OHR  R1,R2          [RR]  */
          /* 01234567 89012345
             0R2R0R1R 11010000         */
-         Grp = RegGrp(lvl);
          R2fld = ((opcode0 & 0x70) >> 4);      /* Extract register 2 */
          R1fld = ( opcode0 & 0x007);           /* Extract register 1 */
 
-         w_byte = (GR[R1fld][Grp] & 0x0FFFF) | (GR[R2fld][Grp] & 0x0FFFF);
-         GR[R1fld][Grp] = (GR[R1fld][Grp] & 0xF0000) | w_byte;  /* OHR */
+         w_byte = (active_bank[R1fld] & 0x0FFFF) | (active_bank[R2fld] & 0x0FFFF);
+         active_bank[R1fld] = (active_bank[R1fld] & 0xF0000) | w_byte;  /* OHR */
          /* If R1 = Register 0, a branch to newly formed address occurs */
          if (R1fld == 0) break;
 
-         /* Update C&Z latches */
-         if ((GR[R1fld][Grp] & 0xFFFF) == 0x0000) {
-            CL_Z[Grp] = ON;
-            CL_C[Grp] = OFF;
-         } else {
-            CL_Z[Grp] = OFF;
-            CL_C[Grp] = ON;
-         }
+         CC_SET(CC_LOGIC, active_bank[R1fld], 0xFFFF, 0);  /* Update C&Z latches */
          break;
 
-      case (0x00E0):
+      case OP_NHR:
          /* NHR  R1,R2          [RR]  */
          /* 01234567 89012345
             0R2R0R1R 11100000         */
-         Grp = RegGrp(lvl);
          R2fld = ((opcode0 & 0x70) >> 4);      /* Extract register 2 */
          R1fld = ( opcode0 & 0x007);           /* Extract register 1 */
 
-         w_byte = (GR[R1fld][Grp] & 0x0FFFF) & (GR[R2fld][Grp] & 0x0FFFF);
-         GR[R1fld][Grp] = (GR[R1fld][Grp] & 0xF0000) | w_byte;  /* OHR */
+         w_byte = (active_bank[R1fld] & 0x0FFFF) & (active_bank[R2fld] & 0x0FFFF);
+         active_bank[R1fld] = (active_bank[R1fld] & 0xF0000) | w_byte;  /* OHR */
          /* If R1 = Register 0, a branch to newly formed address occurs */
          if (R1fld == 0) break;
 
-         /* Update C&Z latches */
-         if (w_byte == 0x0000) {
-            CL_Z[Grp] = ON;
-            CL_C[Grp] = OFF;
-         } else {
-            CL_Z[Grp] = OFF;
-            CL_C[Grp] = ON;
-         }
+         CC_SET(CC_LOGIC, w_byte, CC_ALL, 0);  /* Update C&Z latches */
          break;
 
-      case (0x00F0):
+      case OP_LHOR:
          /* LHOR R1,R2          [RR]  */
          /* 01234567 89012345
             0R2R0R1R 11110000         */
-         Grp = RegGrp(lvl);
          R2fld = ((opcode0 & 0x70) >> 4);      /* Extract register 2 */
          R1fld = ( opcode0 & 0x007);           /* Extract register 1 */
 
-         w_byte = GR[R2fld][Grp];
-         GR[R1fld][Grp] = (GR[R2fld][Grp] & 0x0FFFF) >> 1; /* Shift 1 bit to the right */
+         w_byte = active_bank[R2fld];
+         active_bank[R1fld] = (active_bank[R2fld] & 0x0FFFF) >> 1; /* Shift 1 bit to the right */
          if (Rfld == 0) break;                 /* New IAR ! */
 
-         /* Reset C&Z latches */
-         CL_C[Grp] = OFF;
-         CL_Z[Grp] = OFF;
-         /* Update C&Z latches */
-         /* If a 1 bit will be shifted out, set C latch */
-         if (w_byte & 0x00001)
-            CL_C[Grp] = ON;
-         if (GR[R1fld][Grp] == 0x00000)
-            CL_Z[Grp] = ON;
+         /* C: a 1 bit shifted out, Z: result zero */
+         CC_SET(CC_ARITH, w_byte, 0xFFFE, 0x0001);
          break;
 
-      case (0x0088):
+      case OP_LR:
          /* LR   R1,R2          [RR]  */
          /* 01234567 89012345
             0R2R0R1R 10001000         */
-         Grp = RegGrp(lvl);
          R2fld = ((opcode0 & 0x70) >> 4);      /* Extract register 2 */
          R1fld = ( opcode0 & 0x007);           /* Extract register 1 */
 
-         GR[R1fld][Grp] = GR[R2fld][Grp];      /* Load R1 with contents of R2 */
+         active_bank[R1fld] = active_bank[R2fld];      /* Load R1 with contents of R2 */
          /* If R1 = Register 0, a branch to newly formed address occurs */
          if (R1fld == 0) break;
 
-         /* Update C&Z latches */
-         if (GR[R1fld][Grp] == 0x00000) {
-            CL_Z[Grp] = ON;
-            CL_C[Grp] = OFF;
-         } else {
-            CL_Z[Grp] = OFF;
-            CL_C[Grp] = ON;
-         }
+         CC_SET(CC_LOGIC, active_bank[R1fld], CC_ALL, 0);  /* Update C&Z latches */
          break;
 
-      case (0x0098):
+      case OP_AR:
          /* AR   R1,R2          [RR]  */
          /* 01234567 89012345
             0R2R0R1R 10011000         */
-         Grp = RegGrp(lvl);
          R2fld = ((opcode0 & 0x70) >> 4);      /* Extract register 2 */
          R1fld = ( opcode0 & 0x007);           /* Extract register 1 */
 
-         w_byte = GR[R1fld][Grp] + GR[R2fld][Grp];
-         GR[R1fld][Grp] = w_byte & 0x3FFFF;    /* Remove possible overflow bit */
+         w_byte = active_bank[R1fld] + active_bank[R2fld];
+         active_bank[R1fld] = w_byte & 0x3FFFF;    /* Remove possible overflow bit */
          /* If R1 = Register 0, a branch to newly formed address occurs */
          if (R1fld == 0) break;
 
-         /* Reset C&Z latches */
-         CL_C[Grp] = OFF;
-         CL_Z[Grp] = OFF;
-         /* Update C&Z latches */
-         if (w_byte & 0x40000)                /* Bit 21 overflow ? */
-            CL_C[Grp] = ON;
-         if (GR[R1fld][Grp] == 0x00000)
-            CL_Z[Grp] = ON;
+         CC_SET(CC_ARITH, w_byte, 0x3FFFF, 0x40000);  /* Bit 21 overflow ? Zero ? */
          break;
 
-      case (0x00A8):
+      case OP_SR:
          /* SR   R1,R2          [RR]  */
          /* 01234567 89012345
             0R2R0R1R 10101000         */
-         Grp = RegGrp(lvl);
          R2fld = ((opcode0 & 0x70) >> 4);      /* Extract register 2 */
          R1fld = ( opcode0 & 0x007);           /* Extract register 1 */
 
-         w_byte = GR[R1fld][Grp] + ~(GR[R2fld][Grp]) + 1;   /* SR */
-         GR[R1fld][Grp] = w_byte & 0x3FFFF;    /* Remove possible overflow bit */
+         w_byte = active_bank[R1fld] + ~(active_bank[R2fld]) + 1;   /* SR */
+         active_bank[R1fld] = w_byte & 0x3FFFF;    /* Remove possible overflow bit */
          /* If R1 = Register 0, a branch to newly formed address occurs */
          if (R1fld == 0) break;
 
-         /* Reset C&Z latches */
-         CL_C[Grp] = OFF;
-         CL_Z[Grp] = OFF;
-         /* Update C&Z latches */
-         if (w_byte & 0x40000)                /* X-byte included */
-            CL_C[Grp] = ON;
-         if (GR[R1fld][Grp] == 0x00000)
-            CL_Z[Grp] = ON;
+         CC_SET(CC_ARITH, w_byte, 0x3FFFF, 0x40000);  /* X-byte included */
          break;
 
-      case (0x00B8):
+      case OP_CR:
          /* CR   R1,R2          [RR]  */
          /* 01234567 89012345
             0R2R0R1R 10110000         */
-         Grp = RegGrp(lvl);
          R2fld = ((opcode0 & 0x70) >> 4);      /* Extract register 2 */
          R1fld = ( opcode0 & 0x007);           /* Extract register 1 */
-         /* Reset C&Z latches */
-         CL_C[Grp] = OFF;
-         CL_Z[Grp] = OFF;
-
-         /* Test if R1 is < R2 */                           /* CR */
-         if (GR[R1fld][Grp] == GR[R2fld][Grp]) /* Compare for equal */
-            CL_Z[Grp] = ON;
-         if (GR[R1fld][Grp] < GR[R2fld][Grp])  /* Compare for less */
-            CL_C[Grp] = ON;
+         /* Compare for less (C) and for equal (Z) */  /* CR */
+         CC_SET(CC_ARITH, active_bank[R1fld] - active_bank[R2fld], CC_ALL, CC_NEG);
          break;
-
-         if (GR[R1fld][Grp] < GR[R2fld][Grp])  /* Compare for less */
-            CL_C[Grp] = ON;
-         break;
-
-      case (0x00C8):
+      case OP_XR:
          /* XR   R1,R2          [RR]  */
          /* 01234567 89012345
             0R2R0R1R 11001000         */
-         Grp = RegGrp(lvl);
          R2fld = ((opcode0 & 0x70) >> 4);      /* Extract register 2 */
          R1fld = ( opcode0 & 0x007);           /* Extract register 1 */
 
-         GR[R1fld][Grp] = GR[R1fld][Grp] ^ GR[R2fld][Grp];  /* XR */
+         active_bank[R1fld] = active_bank[R1fld] ^ active_bank[R2fld];  /* XR */
          /* If R1 = Register 0, a branch to newly formed address occurs */
          if (R1fld == 0) break;
 
-         /* Update C&Z latches */
-         if (GR[R1fld][Grp] == 0x00000) {      /* Result zero ? */
-            CL_Z[Grp] = ON;
-            CL_C[Grp] = OFF;
-         } else {
-            CL_Z[Grp] = OFF;
-            CL_C[Grp] = ON;
-         }
+         CC_SET(CC_LOGIC, active_bank[R1fld], CC_ALL, 0);  /* Result zero ? */
          break;
 
-      case (0x00D8):
+      case OP_OR:
          /* OR   R1,R2          [RR]  */
          /* 01234567 89012345
             0R2R0R1R 11011000         */
-         Grp = RegGrp(lvl);
          R2fld = ((opcode0 & 0x70) >> 4);      /* Extract register 2 */
          R1fld = ( opcode0 & 0x007);           /* Extract register 1 */
 
-         GR[R1fld][Grp] = GR[R1fld][Grp] | GR[R2fld][Grp];  /* OR */
+         active_bank[R1fld] = active_bank[R1fld] | active_bank[R2fld];  /* OR */
          /* If R1 = Register 0, a branch to newly formed address occurs */
          if (R1fld == 0) break;
 
-         /* Update C&Z latches */
-         if (GR[R1fld][Grp] == 0x00000) {      /* Result zero ? */
-            CL_Z[Grp] = ON;
-            CL_C[Grp] = OFF;
-         } else {
-            CL_Z[Grp] = OFF;
-            CL_C[Grp] = ON;
-         }
+         CC_SET(CC_LOGIC, active_bank[R1fld], CC_ALL, 0);  /* Result zero ? */
          break;
 
-      case (0x00E8):
+      case OP_NR:
          /* NR   R1,R2          [RR]  */
          /* 01234567 89012345
             0R2R0R1R 11101000         */
-         Grp = RegGrp(lvl);
          R2fld = ((opcode0 & 0x70) >> 4);      /* Extract register 2 */
          R1fld = ( opcode0 & 0x007);           /* Extract register 1 */
 
-         GR[R1fld][Grp] = GR[R1fld][Grp] & GR[R2fld][Grp];  /* NR */
+         active_bank[R1fld] = active_bank[R1fld] & active_bank[R2fld];  /* NR */
          /* If R1 = Register 0, a branch to newly formed address occurs */
          if (R1fld == 0) break;
 
-         /* Update C&Z latches */
-         if (GR[R1fld][Grp] == 0x00000) {      /* Result zero ? */
-            CL_Z[Grp] = ON;
-            CL_C[Grp] = OFF;
-         } else {
-            CL_Z[Grp] = OFF;
-            CL_C[Grp] = ON;
-         }
+         CC_SET(CC_LOGIC, active_bank[R1fld], CC_ALL, 0);  /* Result zero ? */
          break;
 
-      case (0x00F8):
+      case OP_LOR:
          /* LOR  R1,R2          [RR]  */
          /* 01234567 89012345
             0R2R0R1R 11111000         */
-         Grp = RegGrp(lvl);
          R2fld = ((opcode0 & 0x70) >> 4);      /* Extract register 2 */
          R1fld = ( opcode0 & 0x007);           /* Extract register 1 */
 
-         w_byte = GR[R2fld][Grp];
-         GR[R1fld][Grp] = GR[R2fld][Grp] >> 1; /* Shift 1 bit to the right */
-         GR[R1fld][Grp] &= 0x007FFFF;          /* Make sure a 0 is inserted */
+         w_byte = active_bank[R2fld];
+         active_bank[R1fld] = active_bank[R2fld] >> 1; /* Shift 1 bit to the right */
+         active_bank[R1fld] &= 0x007FFFF;      /* Make sure a 0 is inserted */
          if (Rfld == 0) break;                 /* New IAR ! */
 
-         /* Reset C&Z latches */
-         CL_C[Grp] = OFF;
-         CL_Z[Grp] = OFF;
-         /* Update C&Z latches */
-         /* If a 1 bit will be shifted out, set C latch */
-         if (w_byte & 0x00001)
-            CL_C[Grp] = ON;
-         if (GR[R1fld][Grp] == 0x00000)        /* Result zero ? */
-            CL_Z[Grp] = ON;
+         /* C: a 1 bit shifted out, Z: result zero */
+         CC_SET(CC_ARITH, w_byte, 0xFFFFE, 0x0001);
          break;
 
-      case (0x0040):
+      case OP_BALR:
          /* BALR R1,R2          [RR]  */
          /* 01234567 89012345
             0R2R0R1R 01000000         */
-         Grp = RegGrp(lvl);
          R2fld = ((opcode0 & 0x70) >> 4);      /* Extract register 2 */
          R1fld = ( opcode0 & 0x007);           /* Extract register 1 */
 
-         w_byte = GR[R2fld][Grp];              /* See PoO 4-7 */
+         w_byte = active_bank[R2fld];          /* See PoO 4-7 */
          if (R1fld > 0)
-            GR[R1fld][Grp] = GR[0][Grp];       /* Save addr next seq instr. */
+            active_bank[R1fld] = active_bank[0];       /* Save addr next seq instr. */
          if (R2fld > 0)
-            GR[0][Grp] = w_byte;               /* New IAR */
+            active_bank[0] = w_byte;           /* New IAR */
          break;
-   }
 
-   switch (opcode & 0x880F) {
-      case (0x000C):
+      case OP_IN:
          /* IN   R,E            [RE]  */
          /* 01234567 89012345
             0EEE0RRR EEEE1100         */
-         Grp = RegGrp(lvl);
          Efld = (opcode0  & 0x70) | (opcode1 >> 4);
          Rfld = (opcode0) & 0x007;             /* Extract register nr */
 
@@ -1934,7 +1750,7 @@ while (reason == 0) {                          /* Loop until halted */
             break;
          }
          if (Efld < 0x20) {                    /* Input from GR's ? */
-            GR[Rfld][Grp] = GR[Efld & 0x007][Efld >> 3];
+            active_bank[Rfld] = GR[Efld >> 3][Efld & 0x007];
          } else {
             // An Input x'40' will reset L2 req
             if ((Efld == 0x40) && (lvl == 2)) {
@@ -1952,10 +1768,10 @@ while (reason == 0) {                          /* Loop until halted */
                   icw_pdf_reg = EMPTY;
             }
             if (Efld == 0x50) {                     // Get INCWAR ?
-               Eregs_Inp[0x50] = Eregs_Out[0x50];   // Load INCWAR as used by CA
+               CA_INP[0x50] = CA_OUT[0x50];         // Load INCWAR as used by CA
             }
             if (Efld == 0x51) {                     // Get OUTCWAR ?
-               Eregs_Inp[0x51] = Eregs_Out[0x51];   // Load OUTCWAR as used by CA
+               CA_INP[0x51] = CA_OUT[0x51];         // Load OUTCWAR as used by CA
             }
 
 // ***      Eregs_Inp[0x70]  = 0x4000;         // 64kbyte storage size (3704)
@@ -1965,6 +1781,9 @@ while (reason == 0) {                          /* Loop until halted */
 // ***      Eregs_Inp[0x71] is updated by panel.c
 // ***      Eregs_Inp[0x72] is updated by panel.c
 
+            // Insert storage key: L5 program key + key of the X'73' block
+            Eregs_Inp[0x73]  = (prot_key << 4) | stor_key[prot_adr];
+
             Eregs_Inp[0x74]  = LAR;      // Update LAR
 
 // ***      Eregs_Inp[0x77] is updated by chan.T1.c
@@ -1973,13 +1792,18 @@ while (reason == 0) {                          /* Loop until halted */
             Eregs_Inp[0x79] |= 0x0008;   // Fet storage installed
 // ***      Eregs_Inp[0x79] |= 0x0004;   // 0 = 3705, 1 = 3704
             Eregs_Inp[0x79] |= 0x0001;   // CE IPL escape jumper NOT installed
-            if (CL_C[3] == ON) Eregs_Inp[0x79] |= 0x0200;  // L5 C & Z flags
-            if (CL_Z[3] == ON) Eregs_Inp[0x79] |= 0x0100;
+            if (cc_c(3)) Eregs_Inp[0x79] |= 0x0200;  // L5 C & Z flags
+            if (cc_z(3)) Eregs_Inp[0x79] |= 0x0100;
+
+            if (Efld == 0x7A)            // Cycle utilization counter
+               Eregs_Inp[0x7A] = (cpu_cuc_busy_ns() >= (uint64_t) 0xFFFF * CUC_NS) ?
+                                 0xFFFF : (int32) (cpu_cuc_busy_ns() / CUC_NS);
 
             Eregs_Inp[0x7B] = 0x0000;    // Good BSC CRC.
             Eregs_Inp[0x7C] = 0xF0B8;    // Good SDLC CRC.
 
             Eregs_Inp[0x7E] = 0x0000;    // Reset all bits in reg 0x7E
+            if (prot_chk)    Eregs_Inp[0x7E]  |= 0x0080;   // Storage protection check
             if (adr_ex_chk)  Eregs_Inp[0x7E]  |= 0x0040;   // Address exception check
             if (IO_L5_chk)   Eregs_Inp[0x7E]  |= 0x0020;   // I/O instr in L5
             if (OP_reg_chk)  Eregs_Inp[0x7E]  |= 0x0008;   // OPC check
@@ -1993,15 +1817,15 @@ while (reason == 0) {                          /* Loop until halted */
             if (pci_req_L3) Eregs_Inp[0x7F]   |= 0x0002;   // PCI L3 request
             if (svc_req_L4) Eregs_Inp[0x7F]   |= 0x0001;   // SVC L4 request
 
-            GR[Rfld][Grp] = Eregs_Inp[Efld];      // <<==== !!!!
+            // X'50'-X'5F' come from the bank of the CA selected by X'57'
+            active_bank[Rfld] = (CA_BANKED(Efld) ? CA_INP : Eregs_Inp)[Efld];
          }
          break;
 
-      case (0x0004):
+      case OP_OUT:
          /* OUT  R,E            [RE]  */
          /* 01234567 89012345
             0EEE0RRR EEEE0100         */
-         Grp = RegGrp(lvl);
          Efld = (opcode0  & 0x70) | (opcode1 >> 4);
          Rfld = (opcode0) & 0x007;             /* Extract register nr */
 
@@ -2011,16 +1835,17 @@ while (reason == 0) {                          /* Loop until halted */
          }
          if (Efld < 0x20) {            // Output to GR's ?
             if (Rfld == 0) break;      // Only regen of regs parity
-            GR[Efld & 0x007][Efld >> 3] = GR[Rfld][Grp];
+            GR[Efld >> 3][Efld & 0x007] = active_bank[Rfld];
          } else {
-            Eregs_Out[Efld] = GR[Rfld][Grp];   // <<==== !!! Finally update I/O reg.
+            // X'50'-X'5F' go to the bank of the CA selected by X'57'
+            (CA_BANKED(Efld) ? CA_OUT : Eregs_Out)[Efld] = active_bank[Rfld];
 
 #if 0  // <=== !!!
 
             if ((Efld >= 0x40) && (Efld <= 0x47)) {
                // Eregs_Out 44, 45, 46, 47 ===> ICW Local Store
                Get_ICW(0x20);          // abar must be temp 0x20
-               Eregs_Out[Efld] = GR[Rfld][Grp];  // Update any ICW byte
+               Eregs_Out[Efld] = active_bank[Rfld];  // Update any ICW byte
                Put_ICW(0x20);          // abar must be temp 0x20
             }
 #endif
@@ -2060,44 +1885,56 @@ while (reason == 0) {                          /* Loop until halted */
             //          Channel Adaptor Type 2 updates
             //********************************************************
             if (Efld == 0x53) {                // Channel Adapter Sense
-               if (Eregs_Out[0x53] & 0xFFFF)   // If any bit set...
-                  Eregs_Out[0x54] |= 0x0500;   // ...set Unit Check and Device End
+               if (CA_OUT[0x53] & 0xFFFF)      // If any bit set...
+                  CA_OUT[0x54] |= 0x0500;      // ...set Unit Check and Device End
             }
             if (Efld == 0x56) {                // Channel Adapter Mode
-               if (Eregs_Out[0x56] & 0x2000) {
-                  Eregs_Inp[0x55] &= ~0x2000;  // Reset INCWAR valid
-                  Eregs_Out[0x55] &= ~0x2000;  // Reset INCWAR valid
+               if (CA_OUT[0x56] & 0x2000) {
+                  CA_INP[0x55] &= ~0x2000;     // Reset INCWAR valid
+                  CA_OUT[0x55] &= ~0x2000;     // Reset INCWAR valid
                   }
-               if (Eregs_Out[0x56] & 0x1000) {
-                  Eregs_Inp[0x55] &= ~0x1000;  // Reset OUTCWAR valid
-                  Eregs_Out[0x55] &= ~0x1000;  // Reset OUTCWAR valid
+               if (CA_OUT[0x56] & 0x1000) {
+                  CA_INP[0x55] &= ~0x1000;     // Reset OUTCWAR valid
+                  CA_OUT[0x55] &= ~0x1000;     // Reset OUTCWAR valid
                   }
                }
 
+            if (Efld == 0x55 && (CA_OUT[0x55] & 0x0200))
+               ca_attn_post(0x55);             // Program requested attention
             if (Efld == 0x57) {                // Channel Adapter Mode
+               // Select CA1 or CA2 register bank, CA1 only while CA2 has no host
+               ca_sel = ((Eregs_Out[0x57] & 0x0008) || !CA_DUAL) ? 0 : 1;
                if (Eregs_Out[0x57] & 0x0010) { // Reset CA L3 interrupt
                   pthread_mutex_lock(&r77_lock);
-                  Eregs_Inp[0x77] &= ~0x0028;  // Reset CA L3  interrupt
+                  if (CA_DUAL) {
+                     Eregs_Inp[0x77] &= ~(ca_sel ? 0x0020 : 0x0008);  // Reset selected CA L3 interrupt
+                     (ca_sel ? iob2 : iob1)->IS_req_L3 = OFF;
+                     (ca_sel ? iob2 : iob1)->DS_req_L3 = OFF;
+                  } else {
+                     Eregs_Inp[0x77] &= ~0x0028;  // Reset CA L3  interrupt
+                     iob1->IS_req_L3 = iob2->IS_req_L3 = OFF;
+                     iob1->DS_req_L3 = iob2->DS_req_L3 = OFF;
+                  }
                   pthread_mutex_unlock(&r77_lock);
-                  CA1_IS_req_L3 = OFF;
-                  CA1_DS_req_L3 = OFF;
                }
                if (Eregs_Out[0x57] & 0x0008) { // Test for CA select
-                  Eregs_Inp[0x55] |= 0x0001;   // Select CA1
-                  Eregs_Inp[0x55] &= ~0x0002;  // deselect CA2
+                  CA_INP[0x55] |= 0x0001;      // Select CA1
+                  CA_INP[0x55] &= ~0x0002;     // deselect CA2
                }  else {
-                  Eregs_Inp[0x55] |= 0x0002;   // Select CA2
-                  Eregs_Inp[0x55] &= ~0x0001;  // deselect CA1
+                  CA_INP[0x55] |= 0x0002;      // Select CA2
+                  CA_INP[0x55] &= ~0x0001;     // deselect CA1
                }
                if (Eregs_Out[0x57] & 0x0100) { // Test for IPL required
-                  Eregs_Out[0x53] |= 0x0200;   // Set not initialized sense
+                  CA_OUT[0x53] |= 0x0200;      // Set not initialized sense
                }
                if (Eregs_Out[0x57] & 0x0004) {
-                  Eregs_Inp[0x55] &= ~0x0010;  // Reset reset flag
+                  CA_INP[0x55] &= ~0x0010;     // Reset reset flag
                }
                if (Eregs_Out[0x57] & 0x0002) {
-                  Eregs_Inp[0x55] &= ~0x0020;  // Reset channel stop
+                  CA_INP[0x55] &= ~0x0020;     // Reset channel stop
                }
+               if (Eregs_Out[0x57] & 0x0080)   // Program requested L3 interrupt
+                  ca_attn_post(0x57);
             }
 
             //********************************************************
@@ -2143,12 +1980,14 @@ while (reason == 0) {                          /* Loop until halted */
             if (Efld == 0x77) {                // Miscellaneous Control
                w_byte = Eregs_Out[Efld];
                if (w_byte & 0x8000)  {         // Reset IPL L1 ?
-                  Eregs_Inp[0x53] &= ~0x0200;  // Reset not-initialized flag
-                  Eregs_Out[0x53] &= ~0x0200;  // Reset not-initialized flag
+                  Eregs_Inp[0x53] &= ~0x0200;  // Reset not-initialized flag, both CAs
+                  Eregs_Out[0x53] &= ~0x0200;
+                  CA2_Inp[0x53]   &= ~0x0200;
+                  CA2_Out[0x53]   &= ~0x0200;
                   ipl_req_L1 = OFF;
                }
                if (w_byte & 0x0004)      // Reset all L1 prgm checks
-                  IO_L5_chk = OP_reg_chk = adr_ex_chk = OFF;
+                  IO_L5_chk = OP_reg_chk = adr_ex_chk = prot_chk = OFF;
                if (w_byte & 0x2000)  {    // Reset Panel Interrupt L3 ?
                      pthread_mutex_lock(&r7f_lock);
                      Eregs_Inp[0x7F] &= ~0x0200;  // Reset L3 Panel Interrupt
@@ -2175,17 +2014,19 @@ while (reason == 0) {                          /* Loop until halted */
                if (w_byte & 0x0001)      // Reset SVC L4 ?
                   svc_req_L4 = OFF;
             }
-            if (Efld == 0x79) {          // Utility Control
-               if (!(Eregs_Out[Efld] & 0x0400)) { // Inhibit bit PL5 C&Z flag off ?
-                  if (Eregs_Out[Efld] & 0x0200)   // Prog L5 C flag
-                     CL_C[3] = ON;
-                  else
-                     CL_C[3] = OFF;
-                  if (Eregs_Out[Efld] & 0x0100)   // Prog L5 Z flag
-                     CL_Z[3] = ON;
-                  else
-                     CL_Z[3] = OFF;
+            if (Efld == 0x73) {          // Set protection / storage key
+               w_byte = Eregs_Out[Efld];
+               if (w_byte & 0x0400)            // L5 program key ?
+                  prot_key = w_byte & 0x0007;
+               else {                          // Key of the 2K block addressed
+                  prot_adr = (w_byte & AMASK) >> PROT_BLK;
+                  stor_key[prot_adr] = w_byte & 0x0007;
                }
+            }
+            if (Efld == 0x79) {          // Utility Control
+               if (!(Eregs_Out[Efld] & 0x0400))   // Inhibit bit PL5 C&Z flag off ?
+                  cc_flags(3, Eregs_Out[Efld] & 0x0200,   // Prog L5 C flag
+                              Eregs_Out[Efld] & 0x0100);  // Prog L5 Z flag
                if (Eregs_Out[Efld] & 0x0040)   // Reset load state
                   load_state = OFF;
                if (Eregs_Out[Efld] & 0x0020)   // Set test mode
@@ -2195,6 +2036,8 @@ while (reason == 0) {                          /* Loop until halted */
                if (Eregs_Out[Efld] & 0x0010)   // Reset test mode
                   test_mode = OFF;
             }
+            if (Efld == 0x7A)                  // Cycle utilization counter reset
+               cpu_cuc_reset();
             if (Efld == 0x7C) {                // Program Call Interrupt L3
                pci_req_L3     = ON;
             }
@@ -2225,55 +2068,74 @@ while (reason == 0) {                          /* Loop until halted */
             }
          }
          break;
-   }
 
-   switch (opcode & 0xF8F0) {
-      case (0xB800):
+      case OP_BAL:
          /* BAL  R,A            [RA]  */
          /* 01234567 89012345 ... 901
             10111RRR 0000A<-- // -->A */
-         Grp = RegGrp(lvl);
          Rfld = (opcode0) & 0x07;              /* Extract register nr */
                                                /* Get branch addr from memory */
          Afld = (opcode1 & 0x03) << 16;        /* Xbyte EA18 */
-         Afld = Afld | (GetMem(PC) << 8);      /* Read 3rd & 4th byte */
-         PC = (PC + 1) & AMASK;
-         Afld = Afld |  GetMem(PC);
-         PC = (PC + 1) & AMASK;
+         Afld = Afld | load16(PC);             /* Read 3rd & 4th byte */
+         PC = (PC + 2) & AMASK;
 
          if (Rfld > 0)                         /* No link addr if R=0 */
-            GR[Rfld][Grp] = PC;                /* Store link address */
-         GR[0][Grp] = Afld;                    /* Unconditional branch */
+            active_bank[Rfld] = PC;            /* Store link address */
+         active_bank[0] = Afld;                /* Unconditional branch */
          break;
 
-      case (0xB820):
+      case OP_LA:
          /* LA   R,A            [RA]  */
          /* 01234567 89012345 ... 901
             10111RRR 0010A<-- // -->A */
-         Grp = RegGrp(lvl);
          Rfld = (opcode0) & 0x007;             /* Extract register nr */
                                                /* Get load address from memory */
          Afld = (opcode1 & 0x03) << 16;        /* Xbyte EA18 */
-         Afld = Afld | (GetMem(PC) << 8);      /* Read 3rd & 4th byte */
-         PC = (PC + 1) & AMASK;
-         Afld = Afld |  GetMem(PC);
-         PC = (PC + 1) & AMASK;
-         GR[0][Grp] = PC;                      /* Update IAR */
-         GR[Rfld][Grp] = Afld;                 /* Load R with 16 bit address */
+         Afld = Afld | load16(PC);             /* Read 3rd & 4th byte */
+         PC = (PC + 2) & AMASK;
+         active_bank[0] = PC;                  /* Update IAR */
+         active_bank[Rfld] = Afld;             /* Load R with 16 bit address */
          break;
-   }
 
-   if (opcode == 0xB840) {
-      /* EXIT                EXIT  */
-      /* 01234567 89012345
-         10111000 01000000         */
+      case OP_EXIT:
+         /* EXIT                EXIT  */
+         /* 01234567 89012345
+            10111000 01000000         */
 
-      int_lvl_ent[lvl] = OFF;                  /* Reset current active PGM level */
-      if (lvl == 5) {                          /* An EXIT while in L5 triggers SVC L4 */
-         svc_req_L4 = ON;
+         int_lvl_ent[lvl] = OFF;               /* Reset current active PGM level */
+         if (lvl == 5) {                       /* An EXIT while in L5 triggers SVC L4 */
+            svc_req_L4 = ON;
+         }
+         if (debug_reg & 0x02)
+            fprintf(trace, "\n>>> Leaving lvl=%d \n", lvl);
+         break;
+   }
+
+   /* Next instruction of the block, unless this one left the straight line */
+   if ((blk != NULL) && (++blk_i < blk->n) && (reason == 0) && !(adr_ex_chk | prot_chk) &&
+       (active_bank[0] == blk->pc[blk_i]) && (sim_interval > 0) &&
+       (blk->gen[0] == jit_gen[blk->page]) && (blk->gen[1] == jit_gen[blk->page + 1])) {
+      sim_interval = sim_interval - 1;         /* Tick the clock */
+      goto jit_next;
+   }
+   /* Back at its start with nothing changed: an idle loop */
+   if ((blk != NULL) && idle_on && blk->idle && (lvl == 5) && (blk_i >= blk->n) &&
+       (active_bank[0] == blk->addr) && (reason == 0) &&
+       (memcmp(idle_regs, active_bank, sizeof(idle_regs)) == 0) &&
+       (cc_c(Grp) == idle_c) && (cc_z(Grp) == idle_z))
+      cpu_idle();
+   /* JIT=OFF: a store, IN, OUT or EXIT spoils the lap, a backward branch
+      elsewhere makes a new candidate */
+   if ((blk == NULL) && idle_on && !jit_on && (lvl == 5)) {
+      if ((opclass == OP_ST)  || (opclass == OP_STH) || (opclass == OP_STC) || (opclass == OP_STCT) ||
+          (opclass == OP_IN)  || (opclass == OP_OUT) || (opclass == OP_EXIT))
+         idle_lap = 0;
+      else if (((opclass == OP_B) || (opclass == OP_BCL) || (opclass == OP_BZL) ||
+                (opclass == OP_BCT) || (opclass == OP_BB)) &&
+               (active_bank[0] <= saved_PC) && (active_bank[0] != idle_addr)) {
+         idle_addr = active_bank[0];
+         idle_lap = 0;
       }
-      if (debug_reg & 0x02)
-         fprintf(trace, "\n>>> Leaving lvl=%d \n", lvl);
    }
    //if (debug_reg == 0x80) {                    /* Extra delay ? */
      // usleep(250);
@@ -2283,6 +2145,11 @@ while (reason == 0) {                          /* Loop until halted */
 //###################### END OF SIMULATOR WHILE LOOP ######################
 
 PC = saved_PC;
+for (i = 0; i < 4; i++) {                      /* Work out the latches for SCP */
+   CL_C[i] = cc_c(i);
+   CL_Z[i] = cc_z(i);
+}
+stats_lvl_time(-1);                            /* Book time up to the halt */
 /* Simulation halted */
 return (reason);
 }
@@ -2291,6 +2158,64 @@ return (reason);
 // Sub-routines used by the simulator
 //********************************************************
 
+/*** Monotonic time in nsec for the performance counters ***/
+
+uint64_t stats_now_ns(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+/*** Book the time since the last level switch and start timing 'level' ***/
+/*** (0 = wait state, -1 = stop timing). Only called from the CCU thread. ***/
+
+void stats_lvl_time(int level)
+{
+   uint64_t now = stats_now_ns();
+
+   if (stat_lvl >= 0)
+      STAT_ADD(cpu_stats.time_ns[stat_lvl], now - stat_stamp);
+   if ((stat_lvl == 0) || ((stat_lvl < 0) && (stat_stamp != 0)))
+      STAT_ADD(cuc_wait_ns, now - stat_stamp);   /* Waiting or stopped */
+   stat_lvl = level;
+   __atomic_store_n(&stat_stamp, now, __ATOMIC_RELAXED);
+}
+
+/*** Not busy time up to now, including a wait or stop still going on.
+     Also read by the metrics thread. ***/
+
+static uint64_t cuc_wait_now(uint64_t now)
+{
+   uint64_t stamp = STAT_GET(stat_stamp);
+
+   if ((__atomic_load_n(&stat_lvl, __ATOMIC_RELAXED) <= 0) && (stamp != 0))
+      return STAT_GET(cuc_wait_ns) + (now - stamp);
+   return STAT_GET(cuc_wait_ns);
+}
+
+/*** CCU busy time since the last OUT X'7A' ***/
+
+uint64_t cpu_cuc_busy_ns(void)
+{
+   uint64_t now = stats_now_ns();
+   uint64_t wait = cuc_wait_now(now) - STAT_GET(cuc_reset_wait);
+   uint64_t span = now - STAT_GET(cuc_reset_ns);
+
+   return (span > wait) ? span - wait : 0;
+}
+
+/*** OUT X'7A' and CPU reset: restart the utilization counter ***/
+
+void cpu_cuc_reset(void)
+{
+   uint64_t now = stats_now_ns();
+
+   __atomic_store_n(&cuc_reset_wait, cuc_wait_now(now), __ATOMIC_RELAXED);
+   __atomic_store_n(&cuc_reset_ns, now, __ATOMIC_RELAXED);
+}
+
 /*** Select register group ***/
 
 int32 RegGrp(int32 level)
@@ -2301,31 +2226,125 @@ int32 RegGrp(int32 level)
       return(level - 2);     // Lvl 5 => Reg Grp 3
 }
 
+/*** Condition latches of register group g, see CC_LAZY ***/
+
+int32 cc_z(int32 g)
+{
+   return (cc_lazy[g].res & cc_lazy[g].zmask) == 0;
+}
+
+int32 cc_c(int32 g)
+{
+   switch (cc_lazy[g].kind) {
+      case CC_LOGIC:
+         return (cc_lazy[g].res & cc_lazy[g].zmask) != 0;
+      case CC_PARITY:
+         return !__builtin_parity(cc_lazy[g].res & 0xFF);
+      default:
+         return (cc_lazy[g].res & cc_lazy[g].cmask) != 0;
+   }
+}
+
+/* Set both latches of group g explicitly */
+void cc_flags(int32 g, int32 c, int32 z)
+{
+   cc_lazy[g].kind  = CC_ARITH;
+   cc_lazy[g].res   = (c ? 2 : 0) | (z ? 0 : 1);
+   cc_lazy[g].zmask = 1;
+   cc_lazy[g].cmask = 2;
+}
+
 /*** Fetch a byte from memory ***/
 
 int32 GetMem(int32 addr)
 {
-   if (addr > MEMSIZE) {
-       adr_ex_chk = ON;       // Addressing Exception ?
-        printf("Addr %d  MEMSIZE %d ... \n\r",addr, MEMSIZE);
-    }
-   else
-      return(M[addr] & 0xFF);
+   if (addr >= MEMSIZE) {
+      adr_ex_chk = ON;       // Addressing Exception ?
+      printf("Addr %d  MEMSIZE %d ... \n\r",addr, MEMSIZE);
+      return 0;
+   }
+   return(M[addr] & 0xFF);
 }
 
 /*** Place a byte in memory ***/
 
 int32 PutMem(int32 addr, int32 data)
 {
-   if (addr > MEMSIZE) {
+   if (addr >= MEMSIZE) {
       adr_ex_chk = ON;       // Addressing Exception ?
-         printf("Addr %d  MEMSIZE %d ... \n\r",addr, MEMSIZE);
-      }
-   else
+      printf("Addr %d  MEMSIZE %d ... \n\r",addr, MEMSIZE);
+   } else if (mem_prot(addr, 1)) {
       M[addr] = data & 0xFF;
+      if (jit_watch[addr >> JIT_PAGE])         /* Store into predecoded code ? */
+         cpu_jit_store(addr, 1);
+   }
    return 0;
 }
 
+/*** Store-watch: retire the blocks predecoded from addr...addr+len-1.
+     Also called by the CA after a cycle steal into storage. ***/
+
+void cpu_jit_store(int32 addr, int32 len) {
+   int32 p;
+
+   if (len <= 0)
+      return;
+   for (p = addr >> JIT_PAGE; (p <= ((addr + len - 1) >> JIT_PAGE)) && (p < JIT_PAGES); p++) {
+      if (jit_watch[p]) {
+         jit_watch[p] = 0;
+         jit_gen[p]++;
+         STAT_INC(cpu_stats.jit_inval);
+      }
+   }
+}
+
+/*** Find or predecode the block starting at addr.  A block ends after a
+     branch, IN, OUT or EXIT, i.e. anything that can change the level or
+     leave the straight line; sim_instr also leaves it when the IAR does
+     not point at the next one.  Returns NULL if addr holds no valid
+     instruction, which the normal fetch then reports. ***/
+
+static struct JIT_BLK *jit_block(int32 addr) {
+   struct JIT_BLK *b = &jit_cache[(addr >> 1) & (JIT_SLOTS - 1)];
+   int32 a, op, cls;
+
+   if ((b->n != 0) && (b->addr == addr) &&
+       (b->gen[0] == jit_gen[b->page]) && (b->gen[1] == jit_gen[b->page + 1]))
+      return b;
+
+   b->n = 0;
+   b->idle = 1;
+   b->addr = addr;
+   b->page = addr >> JIT_PAGE;                 /* At most 128 bytes: two pages */
+   if (b->page + 1 >= JIT_PAGES)
+      return NULL;
+   jit_watch[b->page] = jit_watch[b->page + 1] = 1;   /* Watch before reading the code */
+   b->gen[0] = jit_gen[b->page];
+   b->gen[1] = jit_gen[b->page + 1];
+   for (a = addr; (b->n < JIT_BLKMAX) && (a + 4 <= MEMSIZE); ) {
+      op = (M[a] << 8) | M[a + 1];
+      cls = op_class[op];
+      if (cls == OP_INV)                       /* Left to the normal fetch */
+         break;
+      b->pc[b->n] = a;
+      b->op[b->n] = op;
+      b->cls[b->n] = cls;
+      b->n++;
+      if ((cls == OP_ST)  || (cls == OP_STH) || (cls == OP_STC) || (cls == OP_STCT) ||
+          (cls == OP_IN)  || (cls == OP_OUT) || (cls == OP_EXIT))
+         b->idle = 0;
+      a += ((cls == OP_BAL) || (cls == OP_LA)) ? 4 : 2;
+      if ((cls == OP_B)   || (cls == OP_BCL) || (cls == OP_BZL)  || (cls == OP_BCT) ||
+          (cls == OP_BB)  || (cls == OP_BAL) || (cls == OP_BALR) || (cls == OP_IN)  ||
+          (cls == OP_OUT) || (cls == OP_EXIT))
+         break;
+   }
+   if (b->n == 0)
+      return NULL;
+   STAT_INC(cpu_stats.jit_built);
+   return b;
+}
+
 /*** Memory examine ***/
 
 t_stat cpu_ex (t_value *vptr, t_addr addr, UNIT *uptr, int32 sw) {
@@ -2356,6 +2375,141 @@ t_stat cpu_set_size (UNIT *uptr, int32 val, char *cptr, void *desc) {
    return SCPE_OK;
 }
 
+/*** SHOW CPU STATS ***/
+
+t_stat cpu_show_stats (FILE *st, UNIT *uptr, int32 val, void *desc) {
+   uint64_t instr = 0, busy = 0;
+   double   secs, busy_s;
+   int      i;
+
+   secs = (stats_now_ns() - stats_reset_ns) / 1e9;
+   for (i = 1; i < 6; i++)
+      instr += STAT_GET(cpu_stats.instr[i]);
+   for (i = 0; i < 6; i++)
+      busy += STAT_GET(cpu_stats.time_ns[i]);
+   if (busy == 0)
+      busy = 1;
+
+   fprintf(st, "\nCCU statistics over %.3f sec\n", secs);
+   fprintf(st, "Instructions executed: %" PRIu64 " (%.3f MIPS)\n",
+           instr, (secs > 0) ? (instr / secs) / 1e6 : 0.0);
+   fprintf(st, "Level  Instructions       Entries   Entries/s      Time(s)  Time%%\n");
+   for (i = 1; i < 6; i++)
+      fprintf(st, "  %d  %14" PRIu64 " %13" PRIu64 " %11.1f %12.3f %6.2f\n", i,
+              STAT_GET(cpu_stats.instr[i]), STAT_GET(cpu_stats.entries[i]),
+              (secs > 0) ? STAT_GET(cpu_stats.entries[i]) / secs : 0.0,
+              STAT_GET(cpu_stats.time_ns[i]) / 1e9,
+              (100.0 * STAT_GET(cpu_stats.time_ns[i])) / busy);
+   fprintf(st, " Wait %53.3f %6.2f\n",
+           STAT_GET(cpu_stats.time_ns[0]) / 1e9,
+           (100.0 * STAT_GET(cpu_stats.time_ns[0])) / busy);
+   fprintf(st, "JIT %s: blocks run %" PRIu64 ", built %" PRIu64 ", retired by stores %" PRIu64 "\n",
+           jit_on ? "on" : "off", STAT_GET(cpu_stats.jit_runs),
+           STAT_GET(cpu_stats.jit_built), STAT_GET(cpu_stats.jit_inval));
+   fprintf(st, "Interval timer: ticks %" PRIu64 ", missed %" PRIu64 "\n",
+           STAT_GET(cpu_stats.timer_ticks), STAT_GET(cpu_stats.timer_missed));
+   fprintf(st, "IDLE %s: sleeps %" PRIu64 ", from idle loops %" PRIu64 "\n",
+           idle_on ? "on" : "off", STAT_GET(cpu_stats.idle_sleeps),
+           STAT_GET(cpu_stats.idle_loops));
+   secs = (stats_now_ns() - STAT_GET(cuc_reset_ns)) / 1e9;
+   busy_s = cpu_cuc_busy_ns() / 1e9;
+   fprintf(st, "Cycle utilization X'7A': %.3f sec busy of %.3f sec since reset (%.2f%%)\n",
+           busy_s, secs, (secs > 0) ? (100.0 * busy_s) / secs : 0.0);
+   return SCPE_OK;
+}
+
+/*** SET CPU JIT=ON|OFF, SHOW CPU JIT ***/
+
+t_stat cpu_set_jit (UNIT *uptr, int32 val, char *cptr, void *desc) {
+   if (cptr == NULL)
+      return SCPE_ARG;
+   if (strcmp(cptr, "ON") == 0)
+      jit_on = ON;
+   else if (strcmp(cptr, "OFF") == 0)
+      jit_on = OFF;
+   else
+      return SCPE_ARG;
+   cpu_jit_store(0, MAXMEMSIZE);               /* Start from an empty cache */
+   return SCPE_OK;
+}
+
+t_stat cpu_show_jit (FILE *st, UNIT *uptr, int32 val, void *desc) {
+   fprintf(st, "JIT=%s", jit_on ? "ON" : "OFF");
+   return SCPE_OK;
+}
+
+/*** SET CPU IDLE=ON|OFF, SHOW CPU IDLE ***/
+
+t_stat cpu_set_idle (UNIT *uptr, int32 val, char *cptr, void *desc) {
+   if (cptr == NULL)
+      return SCPE_ARG;
+   if (strcmp(cptr, "ON") == 0) {
+      if ((cpu_wake_fd < 0) && ((cpu_wake_fd = eventfd(0, EFD_NONBLOCK)) < 0))
+         return SCPE_IOERR;
+      idle_on = ON;
+   } else if (strcmp(cptr, "OFF") == 0)
+      idle_on = OFF;
+   else
+      return SCPE_ARG;
+   return SCPE_OK;
+}
+
+t_stat cpu_show_idle (FILE *st, UNIT *uptr, int32 val, void *desc) {
+   fprintf(st, "IDLE=%s", idle_on ? "ON" : "OFF");
+   return SCPE_OK;
+}
+
+/*** SET CPU PROTECT=ON|OFF, SHOW CPU PROTECT: enforce the storage keys,
+     see i3705_mem.h ***/
+
+t_stat cpu_set_prot (UNIT *uptr, int32 val, char *cptr, void *desc) {
+   if (cptr == NULL)
+      return SCPE_ARG;
+   if (strcmp(cptr, "ON") == 0)
+      prot_on = ON;
+   else if (strcmp(cptr, "OFF") == 0)
+      prot_on = OFF;
+   else
+      return SCPE_ARG;
+   return SCPE_OK;
+}
+
+t_stat cpu_show_prot (FILE *st, UNIT *uptr, int32 val, void *desc) {
+   fprintf(st, "PROTECT=%s", prot_on ? "ON" : "OFF");
+   return SCPE_OK;
+}
+
+/*** Interrupt source posted a request: wake an idle CCU ***/
+
+void cpu_wake(void) {
+   uint64_t one = 1;
+
+   if (cpu_wake_fd >= 0)
+      if (write(cpu_wake_fd, &one, sizeof(one)) < 0) { }  // Counter full: already posted
+}
+
+/*** Idle: sleep until posted.  A post since the last level scan is
+     still pending on the eventfd, so no request can be missed; a stale
+     one only makes this sleep short. ***/
+
+static void cpu_idle(void) {
+   struct pollfd pfd;
+   uint64_t posts;
+
+   pfd.fd = cpu_wake_fd;
+   pfd.events = POLLIN;
+   STAT_INC(cpu_stats.idle_sleeps);
+   if (wait_state == OFF) {
+      STAT_INC(cpu_stats.idle_loops);
+      stats_lvl_time(0);                       /* An idle loop sleep is wait time */
+   }
+   if (poll(&pfd, 1, IDLE_MS) > 0)
+      if (read(cpu_wake_fd, &posts, sizeof(posts)) < 0) { }
+   if (wait_state == OFF)
+      stats_lvl_time(lvl);
+   sim_interval = 0;                           /* Time passed: run due events, see ^E */
+}
+
 /*** BOOT/LOAD procedure ***/
 
 t_stat cpu_boot (int32 unitno, DEVICE *dptr) {    /* LOAD pressed */
@@ -2467,6 +2621,32 @@ t_stat cpu_boot (int32 unitno, DEVICE *dptr) {    /* LOAD pressed */
    return SCPE_OK;
 }
 
+/*** Build op_class[]: one entry per opcode, so sim_instr decodes with a single
+     switch instead of testing every opcode mask in turn.  The masks are the
+     ones of optable (i3705_sys.c), first match wins as in the disassembler. ***/
+
+void cpu_build_optab (void) {
+   int32 op, i, op0, op1;
+
+   for (op = 0; op < 0x10000; op++) {
+      op0 = op >> 8;
+      op1 = op & 0xFF;
+      op_class[op] = OP_NONE;
+      if (((op0 & 0x88) == 0x00) &&
+         ((op1 == 0x00) || (op1 == 0x20) || (op1 == 0x50) ||
+          (op1 == 0x60) || (op1 == 0x70))) {
+         op_class[op] = OP_INV;                /* Program check unless in test mode */
+         continue;
+      }
+      for (i = 0; i < nopcode; i++) {
+         if ((op & optable[i].opmask) == optable[i].opcode) {
+            op_class[op] = optable[i].op;
+            break;
+         }
+      }
+   }
+}
+
 /*** RESET pressed procedure ***/
 
 t_stat cpu_reset (DEVICE *dptr) {              /* RESET pressed */
@@ -2477,8 +2657,8 @@ t_stat cpu_reset (DEVICE *dptr) {              /* RESET pressed */
    sim_brk_types = sim_brk_dflt = SWMASK ('E');  /* Clear all BP's */
 
    /* Clear all level GP registers */
-   GR[0][0] = 0x00000;  GR[1][0] = 0x00000;  GR[2][0] = 0x00000;  GR[3][0] = 0x00000;
-   GR[4][0] = 0x00000;  GR[5][0] = 0x00000;  GR[6][0] = 0x00000;  GR[7][0] = 0x00000;
+   GR[0][0] = 0x00000;  GR[0][1] = 0x00000;  GR[0][2] = 0x00000;  GR[0][3] = 0x00000;
+   GR[0][4] = 0x00000;  GR[0][5] = 0x00000;  GR[0][6] = 0x00000;  GR[0][7] = 0x00000;
 
    /* Set/reset HARD STOP, PGM STOP, IPL LATCHES 1 & 2, TEST MODE */
    test_mode = ON;                             /* See PoO 5-11 */
@@ -2487,6 +2667,11 @@ t_stat cpu_reset (DEVICE *dptr) {              /* RESET pressed */
    wait_state = OFF;
    OP_reg_chk = OFF;
    IO_L5_chk = OFF;
+   cpu_cuc_reset();                            /* Restart the utilization counter */
+   prot_chk = OFF;                             /* All storage to key 0 */
+   prot_key = 0;
+   prot_adr = 0;
+   memset(stor_key, 0, sizeof(stor_key));
 
    /* Reset all interrupt level flags */
    for (i = 0; i < 6; i++) {
@@ -2496,6 +2681,11 @@ t_stat cpu_reset (DEVICE *dptr) {              /* RESET pressed */
    }
    lvl = 5;
 
+   if (op_class[0] != OP_INV) {                /* First reset: build the decode table */
+      cpu_build_optab();
+      i3705_init();                            /* and hook up the VM commands */
+   }
+
    printf("CPU: Reset... \n\r");
    printf("CPU: MEMORYSIZE %d bytes... \n\r", MEMSIZE);
 
@@ -94,4 +94,20 @@ struct opdef {
                                                            9 - EXIT */
     int32   group;                                      /* Group Code:
                                                            0 - spare */
+    int32   op;                                         /* CCU handler, OP_xxx */
+};
+
+/* CCU instruction handlers, the case labels of sim_instr */
+
+enum {
+    OP_NONE = 0,                                        /* No operation */
+    OP_INV,                                             /* Invalid, program check */
+    OP_B,    OP_BCL,  OP_BZL,  OP_BCT,  OP_BB,
+    OP_LRI,  OP_ARI,  OP_SRI,  OP_CRI,  OP_XRI,  OP_ORI,  OP_NRI,  OP_TRM,
+    OP_LCR,  OP_ACR,  OP_SCR,  OP_CCR,  OP_XCR,  OP_OCR,  OP_NCR,  OP_LCOR,
+    OP_ICT,  OP_STCT, OP_IC,   OP_STC,
+    OP_LH,   OP_STH,  OP_L,    OP_ST,
+    OP_LHR,  OP_AHR,  OP_SHR,  OP_CHR,  OP_XHR,  OP_OHR,  OP_NHR,  OP_LHOR,
+    OP_LR,   OP_AR,   OP_SR,   OP_CR,   OP_XR,   OP_OR,   OP_NR,   OP_LOR,
+    OP_BALR, OP_IN,   OP_OUT,  OP_BAL,  OP_LA,   OP_EXIT
 };
@@ -0,0 +1,546 @@
+/* i3705_ldgen.c   (c) Copyright  Edwin Freekenhost & Henk Stegeman      */
+
+/***********************************************************************/
+/*                                                                     */
+/* i3705_ldgen.c - (C) Copyright 2021 by HJS & EF                      */
+/*                                                                     */
+/* Synthetic tn3270 load generator for the terminal side of the 3705   */
+/* emulator.                                                           */
+/*                                                                     */
+/* Opens N tn3270 sessions against the 3274 ports of the emulator      */
+/* (PU2_thread, 32741 for the first 3274, 32742 for the 2nd, etc.) or  */
+/* against the TEL_thread port (32001).  Each session performs the     */
+/* client side of the telnet negotiation done by negotiate(), then     */
+/* replays recorded 3270 inbound records with a think-time between     */
+/* them.  The response time is measured from the moment the inbound    */
+/* record (Enter) is sent until the first outbound byte is received.   */
+/*                                                                     */
+/* With -L the program runs as a loopback stand-in for the host: it    */
+/* listens on the given port, performs the server side of the telnet   */
+/* negotiation and writes every inbound record straight back as an     */
+/* outbound record, after an optional host delay.  This gives a base   */
+/* line for the generator itself, to be compared with the response     */
+/* times measured through proc_PIU and the SDLC polling of the NCP.    */
+/*                                                                     */
+/* Record file format (one inbound record per line):                   */
+/*    <think time in ms> <hex bytes of the 3270 inbound data stream>   */
+/* e.g.  500 7D 40 C5 11 40 C5 E3 E2 D6                                 */
+/* Lines starting with '#' are comments.                               */
+/*                                                                     */
+/***********************************************************************/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "htypes.h"
+#include "i3705_client.h"
+
+#define MAXREC   256                   // Max # of records in a script
+#define MAXSMP   (1024 * 1024)         // Max # of response time samples
+#define RECLEN   4096                  // Max length of a 3270 record
+
+struct LDREC {
+   int  think;                         // Think time in msec
+   int  len;                           // Length of inbound record
+   BYTE data[RECLEN];                  // 3270 inbound data stream
+};
+
+struct LDSES {
+   pthread_t tid;
+   int  num;                           // Session number
+   int  port;                          // Port this session connects to
+   int  sfd;                           // Session socket
+   int  sent;                          // # of records sent
+   int  rcvd;                          // # of responses received
+   int  tmo;                           // # of responses timed out
+};
+
+char    *hostname = "127.0.0.1";       // Emulator address
+int      baseport = 32001;             // First port to connect to
+int      nports = 1;                   // # of consecutive ports (3274's)
+int      nsess = 1;                    // # of sessions
+int      iters = 10;                   // # of script passes per session
+int      rsptmo = 10;                  // Response time-out in seconds
+int      hostdly = 0;                  // Loopback host delay in msec
+int      loopback = 0;                 // 1 = run as loopback host
+int      verbose = 0;
+char    *termtype = "IBM-3278-2";      // Terminal type to negotiate
+
+struct LDREC rec[MAXREC];              // Replay script
+int      nrec = 0;
+
+double  *smp;                          // Response time samples in usec
+long     nsmp = 0;
+pthread_mutex_t smp_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static BYTE do_term[]   = { IAC, DO, TERMINAL_TYPE };
+static BYTE will_term[] = { IAC, WILL, TERMINAL_TYPE };
+static BYTE req_type[]  = { IAC, SB, TERMINAL_TYPE, SEND, IAC, SE };
+static BYTE type_is[]   = { IAC, SB, TERMINAL_TYPE, IS };
+static BYTE do_eor[]    = { IAC, DO, EOR, IAC, WILL, EOR };
+static BYTE will_eor[]  = { IAC, WILL, EOR, IAC, DO, EOR };
+static BYTE do_bin[]    = { IAC, DO, BINARY, IAC, WILL, BINARY };
+static BYTE will_bin[]  = { IAC, WILL, BINARY, IAC, DO, BINARY };
+
+
+/*-------------------------------------------------------------------*/
+/* Current time in microseconds.                                     */
+/*-------------------------------------------------------------------*/
+static double now_usec(void) {
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (ts.tv_sec * 1000000.0) + (ts.tv_nsec / 1000.0);
+}
+
+/*-------------------------------------------------------------------*/
+/* Send a complete buffer.                                           */
+/*-------------------------------------------------------------------*/
+static int send_all(int sfd, BYTE *buf, int len) {
+   int rc, sent = 0;
+
+   while (sent < len) {
+      rc = send(sfd, buf + sent, len - sent, MSG_NOSIGNAL);
+      if (rc <= 0) {
+         if (rc < 0 && errno == EINTR)
+            continue;
+         return -1;
+      }
+      sent += rc;
+   }
+   return sent;
+}
+
+/*-------------------------------------------------------------------*/
+/* Receive exactly len bytes, with a time-out in msec.               */
+/*-------------------------------------------------------------------*/
+static int recv_all(int sfd, BYTE *buf, int len, int tmo) {
+   struct pollfd pfd;
+   int rc, rcvd = 0;
+
+   pfd.fd = sfd;
+   pfd.events = POLLIN;
+   while (rcvd < len) {
+      rc = poll(&pfd, 1, tmo);
+      if (rc <= 0)
+         return -1;
+      rc = recv(sfd, buf + rcvd, len - rcvd, 0);
+      if (rc <= 0)
+         return -1;
+      rcvd += rc;
+   }
+   return rcvd;
+}
+
+/*-------------------------------------------------------------------*/
+/* Read one outbound 3270 record (up to IAC EOR).                    */
+/* Returns the record length, or -1 on time-out or error.            */
+/* *first is set to the time the first byte arrived.                 */
+/*-------------------------------------------------------------------*/
+static int recv_record(int sfd, BYTE *buf, int maxlen, int tmo, double *first) {
+   BYTE c;
+   int  len = 0, iac = 0;
+
+   if (first != NULL)
+      *first = 0;
+   for (;;) {
+      if (recv_all(sfd, &c, 1, tmo) < 0)
+         return -1;
+      if (first != NULL && *first == 0)
+         *first = now_usec();
+      if (iac) {
+         iac = 0;
+         if (c == EOR_MARK)
+            return len;
+         if (c != IAC)                 // Telnet cmd inside data: skip
+            continue;
+      } else if (c == IAC) {
+         iac = 1;
+         continue;
+      }
+      if (len < maxlen)
+         buf[len++] = c;
+   }
+}
+
+/*-------------------------------------------------------------------*/
+/* Send one 3270 record: double up IAC's and append IAC EOR.         */
+/*-------------------------------------------------------------------*/
+static int send_record(int sfd, BYTE *data, int len) {
+   BYTE buf[(RECLEN * 2) + 2];
+   int  i, j = 0;
+
+   for (i = 0; i < len; i++) {
+      buf[j++] = data[i];
+      if (data[i] == IAC)
+         buf[j++] = IAC;
+   }
+   buf[j++] = IAC;
+   buf[j++] = EOR_MARK;
+   return send_all(sfd, buf, j);
+}
+
+/*-------------------------------------------------------------------*/
+/* Client side of the telnet negotiation.                            */
+/* Answers every DO with a WILL and every WILL with a DO, and the    */
+/* terminal type request with the configured terminal type, until    */
+/* the binary option has been agreed on (see negotiate()).           */
+/*-------------------------------------------------------------------*/
+static int client_negotiate(int sfd) {
+   BYTE buf[512];
+   BYTE cmd[3];
+   int  bin_do = 0, bin_will = 0;
+   int  len;
+
+   while (!(bin_do && bin_will)) {
+      if (recv_all(sfd, buf, 1, rsptmo * 1000) < 0 || buf[0] != IAC)
+         return -1;
+      if (recv_all(sfd, buf + 1, 2, rsptmo * 1000) < 0)
+         return -1;
+      switch (buf[1]) {
+         case DO:
+         case WILL:
+            cmd[0] = IAC;
+            cmd[1] = (buf[1] == DO) ? WILL : DO;
+            cmd[2] = buf[2];
+            if (send_all(sfd, cmd, 3) < 0)
+               return -1;
+            if (buf[2] == BINARY) {
+               if (buf[1] == DO) bin_do = 1;
+               else bin_will = 1;
+            }
+            break;
+         case SB:                      // IAC SB TERMINAL_TYPE SEND IAC SE
+            if (recv_all(sfd, buf + 3, 3, rsptmo * 1000) < 0)
+               return -1;
+            if (buf[2] != TERMINAL_TYPE || buf[3] != SEND)
+               return -1;
+            memcpy(buf, type_is, sizeof(type_is));
+            len = sizeof(type_is);
+            memcpy(buf + len, termtype, strlen(termtype));
+            len += strlen(termtype);
+            buf[len++] = IAC;
+            buf[len++] = SE;
+            if (send_all(sfd, buf, len) < 0)
+               return -1;
+            break;
+         default:
+            return -1;
+      }
+   }
+   return 0;
+}
+
+/*-------------------------------------------------------------------*/
+/* Server side of the telnet negotiation (loopback host).            */
+/*-------------------------------------------------------------------*/
+static int server_negotiate(int sfd) {
+   BYTE buf[512];
+   int  i;
+
+   if (send_all(sfd, do_term, sizeof(do_term)) < 0 ||
+       recv_all(sfd, buf, sizeof(will_term), rsptmo * 1000) < 0 ||
+       memcmp(buf, will_term, sizeof(will_term)))
+      return -1;
+   if (send_all(sfd, req_type, sizeof(req_type)) < 0)
+      return -1;
+   for (i = 0; i < (int)sizeof(buf); i++) {
+      if (recv_all(sfd, &buf[i], 1, rsptmo * 1000) < 0)
+         return -1;
+      if (i > 0 && buf[i-1] == IAC && buf[i] == SE)
+         break;
+   }
+   if (memcmp(buf, type_is, sizeof(type_is)))
+      return -1;
+   if (send_all(sfd, do_eor, sizeof(do_eor)) < 0 ||
+       recv_all(sfd, buf, sizeof(will_eor), rsptmo * 1000) < 0 ||
+       memcmp(buf, will_eor, sizeof(will_eor)))
+      return -1;
+   if (send_all(sfd, do_bin, sizeof(do_bin)) < 0 ||
+       recv_all(sfd, buf, sizeof(will_bin), rsptmo * 1000) < 0 ||
+       memcmp(buf, will_bin, sizeof(will_bin)))
+      return -1;
+   return 0;
+}
+
+/*-------------------------------------------------------------------*/
+/* Drain any unsolicited outbound data (e.g. the connection screen). */
+/*-------------------------------------------------------------------*/
+static void drain(int sfd) {
+   BYTE buf[RECLEN];
+
+   while (recv_record(sfd, buf, sizeof(buf), 0, NULL) >= 0)
+      ;
+}
+
+/*-------------------------------------------------------------------*/
+/* Session thread: connect, negotiate and replay the script.         */
+/*-------------------------------------------------------------------*/
+static void *session_thread(void *arg) {
+   struct LDSES *ses = (struct LDSES *) arg;
+   struct addrinfo hints, *res;
+   char   portstr[8];
+   BYTE   buf[RECLEN];
+   double t_send, t_first;
+   int    sockopt = 1;
+   int    i, j;
+
+   memset(&hints, 0, sizeof(hints));
+   hints.ai_family = AF_INET;
+   hints.ai_socktype = SOCK_STREAM;
+   sprintf(portstr, "%d", ses->port);
+   if (getaddrinfo(hostname, portstr, &hints, &res) != 0) {
+      printf("\nLDG: session %d: unknown host %s\n\r", ses->num, hostname);
+      return NULL;
+   }
+   ses->sfd = socket(AF_INET, SOCK_STREAM, 0);
+   if (connect(ses->sfd, res->ai_addr, res->ai_addrlen) < 0) {
+      printf("\nLDG: session %d: connect to %s:%d failed %s\n\r",
+             ses->num, hostname, ses->port, strerror(errno));
+      freeaddrinfo(res);
+      close(ses->sfd);
+      return NULL;
+   }
+   freeaddrinfo(res);
+   setsockopt(ses->sfd, IPPROTO_TCP, TCP_NODELAY, (void*)&sockopt, sizeof(sockopt));
+
+   if (client_negotiate(ses->sfd) < 0) {
+      printf("\nLDG: session %d: telnet negotiation failed\n\r", ses->num);
+      close(ses->sfd);
+      return NULL;
+   }
+   if (verbose)
+      printf("\nLDG: session %d connected to port %d\n\r", ses->num, ses->port);
+   recv_record(ses->sfd, buf, sizeof(buf), 1000, NULL);   // Connection screen
+
+   for (i = 0; i < iters; i++) {
+      for (j = 0; j < nrec; j++) {
+         usleep(rec[j].think * 1000);
+         drain(ses->sfd);
+         t_send = now_usec();
+         if (send_record(ses->sfd, rec[j].data, rec[j].len) < 0) {
+            printf("\nLDG: session %d: connection lost\n\r", ses->num);
+            close(ses->sfd);
+            return NULL;
+         }
+         ses->sent++;
+         if (recv_record(ses->sfd, buf, sizeof(buf), rsptmo * 1000, &t_first) < 0 &&
+             t_first == 0) {
+            ses->tmo++;
+            continue;
+         }
+         ses->rcvd++;
+         pthread_mutex_lock(&smp_lock);
+         if (nsmp < MAXSMP)
+            smp[nsmp++] = t_first - t_send;
+         pthread_mutex_unlock(&smp_lock);
+      }
+   }
+   close(ses->sfd);
+   return NULL;
+}
+
+/*-------------------------------------------------------------------*/
+/* Loopback host: echo each inbound record as an outbound record.    */
+/*-------------------------------------------------------------------*/
+static void *loopback_thread(void *arg) {
+   int  sfd = (int)(intptr_t) arg;
+   BYTE buf[RECLEN];
+   int  len;
+
+   if (server_negotiate(sfd) < 0) {
+      printf("\nLDG: loopback negotiation failed\n\r");
+      close(sfd);
+      return NULL;
+   }
+   for (;;) {
+      len = recv_record(sfd, buf, sizeof(buf), -1, NULL);
+      if (len < 0)
+         break;
+      if (hostdly)
+         usleep(hostdly * 1000);
+      buf[0] = 0xF1;                   // Write, the WCC follows
+      if (len < 2)
+         len = 2;
+      buf[1] = 0xC2;                   // WCC: keyboard restore
+      if (send_record(sfd, buf, len) < 0)
+         break;
+   }
+   close(sfd);
+   return NULL;
+}
+
+static int run_loopback(void) {
+   struct sockaddr_in sin;
+   pthread_t tid;
+   int  lfd, sfd;
+   int  sockopt = 1;
+
+   lfd = socket(AF_INET, SOCK_STREAM, 0);
+   setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, (void*)&sockopt, sizeof(sockopt));
+   memset(&sin, 0, sizeof(sin));
+   sin.sin_family = AF_INET;
+   sin.sin_addr.s_addr = INADDR_ANY;
+   sin.sin_port = htons(baseport);
+   if (bind(lfd, (struct sockaddr *)&sin, sizeof(sin)) < 0 || listen(lfd, 128) < 0) {
+      printf("\nLDG: loopback listen on port %d failed %s\n\r", baseport, strerror(errno));
+      return EXIT_FAILURE;
+   }
+   printf("\nLDG: loopback host listening on port %d, host delay %d ms\n\r", baseport, hostdly);
+   for (;;) {
+      sfd = accept(lfd, NULL, 0);
+      if (sfd < 0)
+         continue;
+      setsockopt(sfd, IPPROTO_TCP, TCP_NODELAY, (void*)&sockopt, sizeof(sockopt));
+      if (pthread_create(&tid, NULL, loopback_thread, (void *)(intptr_t) sfd) != 0)
+         close(sfd);
+      else
+         pthread_detach(tid);
+   }
+   return EXIT_SUCCESS;
+}
+
+/*-------------------------------------------------------------------*/
+/* Load the replay script.                                           */
+/*-------------------------------------------------------------------*/
+static int load_script(char *fname) {
+   FILE *fp;
+   char  line[RECLEN * 3 + 32];
+   char *p, *end;
+   long  v;
+
+   if ((fp = fopen(fname, "r")) == NULL) {
+      printf("\nLDG: cannot open %s %s\n\r", fname, strerror(errno));
+      return -1;
+   }
+   while (fgets(line, sizeof(line), fp) != NULL && nrec < MAXREC) {
+      for (p = line; isspace((unsigned char) *p); p++)
+         ;
+      if (*p == '#' || *p == 0)
+         continue;
+      rec[nrec].think = strtol(p, &end, 10);
+      rec[nrec].len = 0;
+      for (p = end; rec[nrec].len < RECLEN; p = end) {
+         v = strtol(p, &end, 16);
+         if (end == p)
+            break;
+         rec[nrec].data[rec[nrec].len++] = (BYTE) v;
+      }
+      if (rec[nrec].len > 0)
+         nrec++;
+   }
+   fclose(fp);
+   return nrec;
+}
+
+static int cmp_smp(const void *a, const void *b) {
+   double x = *(const double *) a, y = *(const double *) b;
+   return (x > y) - (x < y);
+}
+
+static void usage(char *pgm) {
+   printf("Usage: %s [options]\n"
+          "  -h host     emulator address (default 127.0.0.1)\n"
+          "  -p port     first port; 32001 = TEL_thread, 32741+ = PU2_thread (default 32001)\n"
+          "  -u n        spread sessions over n consecutive ports (3274's) (default 1)\n"
+          "  -n n        number of sessions (default 1)\n"
+          "  -c n        script passes per session (default 10)\n"
+          "  -r file     replay script; default is a single Enter with 1000 ms think time\n"
+          "  -T type     terminal type (default IBM-3278-2)\n"
+          "  -t sec      response time-out (default 10)\n"
+          "  -L          run as loopback host on port -p\n"
+          "  -d msec     loopback host delay (default 0)\n"
+          "  -v          verbose\n", pgm);
+}
+
+int main(int argc, char *argv[]) {
+   struct LDSES *ses;
+   double t_start, t_elapsed, sum = 0;
+   long   sent = 0, rcvd = 0, tmo = 0;
+   int    opt, i;
+
+   while ((opt = getopt(argc, argv, "h:p:u:n:c:r:T:t:Ld:v")) != -1) {
+      switch (opt) {
+         case 'h': hostname = optarg; break;
+         case 'p': baseport = atoi(optarg); break;
+         case 'u': nports = atoi(optarg); break;
+         case 'n': nsess = atoi(optarg); break;
+         case 'c': iters = atoi(optarg); break;
+         case 'r': if (load_script(optarg) <= 0) return EXIT_FAILURE; break;
+         case 'T': termtype = optarg; break;
+         case 't': rsptmo = atoi(optarg); break;
+         case 'L': loopback = 1; break;
+         case 'd': hostdly = atoi(optarg); break;
+         case 'v': verbose = 1; break;
+         default:  usage(argv[0]); return EXIT_FAILURE;
+      }
+   }
+   if (loopback)
+      return run_loopback();
+
+   if (nrec == 0) {                    // Default: Enter, cursor at 0
+      rec[0].think = 1000;
+      rec[0].data[0] = 0x7D;
+      rec[0].data[1] = 0x40;
+      rec[0].data[2] = 0x40;
+      rec[0].len = 3;
+      nrec = 1;
+   }
+   if (nports < 1)
+      nports = 1;
+
+   smp = malloc(MAXSMP * sizeof(double));
+   ses = calloc(nsess, sizeof(struct LDSES));
+   if (smp == NULL || ses == NULL) {
+      printf("\nLDG: out of memory\n\r");
+      return EXIT_FAILURE;
+   }
+
+   printf("\nLDG: %d sessions on %s port %d-%d, %d records x %d passes\n\r",
+          nsess, hostname, baseport, baseport + nports - 1, nrec, iters);
+   t_start = now_usec();
+   for (i = 0; i < nsess; i++) {
+      ses[i].num = i;
+      ses[i].port = baseport + (i % nports);
+      if (pthread_create(&ses[i].tid, NULL, session_thread, &ses[i]) != 0) {
+         printf("\nLDG: cannot create session %d %s\n\r", i, strerror(errno));
+         nsess = i;
+         break;
+      }
+   }
+   for (i = 0; i < nsess; i++) {
+      pthread_join(ses[i].tid, NULL);
+      sent += ses[i].sent;
+      rcvd += ses[i].rcvd;
+      tmo  += ses[i].tmo;
+   }
+   t_elapsed = (now_usec() - t_start) / 1000000.0;
+
+   printf("\nLDG: elapsed %.1f s, sent %ld, responses %ld, time-outs %ld, %.1f tx/s\n\r",
+          t_elapsed, sent, rcvd, tmo, rcvd / t_elapsed);
+   if (nsmp > 0) {
+      qsort(smp, nsmp, sizeof(double), cmp_smp);
+      for (i = 0; i < nsmp; i++)
+         sum += smp[i];
+      printf("LDG: response time (ms) min %.3f avg %.3f p50 %.3f p90 %.3f p99 %.3f max %.3f\n\r",
+             smp[0] / 1000.0, (sum / nsmp) / 1000.0,
+             smp[nsmp / 2] / 1000.0, smp[(nsmp * 90) / 100] / 1000.0,
+             smp[(nsmp * 99) / 100] / 1000.0, smp[nsmp - 1] / 1000.0);
+   }
+   free(ses);
+   free(smp);
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+/* i3705_mem.h: IBM 3705 storage access
+
+   Copyright (c) 2021, Henk Stegeman & Edwin Freekenhorst
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+   ROBERT M SUPNIK BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+   IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+   Except as contained in this notice, the name of Charles E. Owen shall not be
+   used in advertising or otherwise to promote the sale, use or other dealings
+   in this Software without prior written authorization from Charles E. Owen.
+
+   ------------------------------------------------------------------------------
+
+   Big-endian halfword and fullword access to 3705 storage M[], one host
+   load or store plus a byte swap instead of a GetMem/PutMem per byte.
+
+   mem_rd16/mem_rd32/mem_wr16 are the raw accesses, for callers that
+   already keep the address inside storage (CA control words, panel).
+   load16/load32/store16/store32 are the CCU's: one bounds check per
+   access, setting the addressing exception and loading 0 or storing
+   nothing when it fails, and the JIT store-watch (SET CPU JIT) on stores.
+
+   Storage protection: every 2K block has a key in stor_key[], set by
+   OUT X'73'.  A level 5 store into a block whose key differs from the
+   program key raises the protection check and is suppressed, before the
+   store-watch sees it.  Program key 0 stores anywhere.  This is only
+   enforced with SET CPU PROTECT=ON, the default OFF never checks, the
+   keys are still set and read back by OUT/IN X'73'.
+*/
+
+#ifndef _I3705_MEM_H_
+#define _I3705_MEM_H_
+
+#include <string.h>
+
+#define JIT_PAGE     8                  // log2 of the JIT store-watch page size
+#define JIT_PAGES    ((MAXMEMSIZE >> JIT_PAGE) + 1)
+#define PROT_BLK     11                 // log2 of the storage key block size
+#define PROT_BLKS    (MAXMEMSIZE >> PROT_BLK)
+
+extern uint8 M[];
+extern UNIT  cpu_unit;
+extern int8  adr_ex_chk;
+extern uint8 jit_watch[];
+extern uint8 stor_key[];
+extern uint8 prot_key;
+extern int8  prot_chk;
+extern int32 prot_on;
+extern int32 lvl;
+void  cpu_jit_store(int32 addr, int32 len);
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define MEM_BE16(v)  __builtin_bswap16(v)
+#define MEM_BE32(v)  __builtin_bswap32(v)
+#else
+#define MEM_BE16(v)  (v)
+#define MEM_BE32(v)  (v)
+#endif
+
+static inline int32 mem_rd16(int32 addr) {
+   uint16 v;
+
+   memcpy(&v, &M[addr], 2);
+   return MEM_BE16(v);
+}
+
+static inline int32 mem_rd32(int32 addr) {
+   uint32 v;
+
+   memcpy(&v, &M[addr], 4);
+   return (int32) MEM_BE32(v);
+}
+
+static inline void mem_wr16(int32 addr, int32 data) {
+   uint16 v = MEM_BE16((uint16) data);
+
+   memcpy(&M[addr], &v, 2);
+}
+
+static inline void mem_wr32(int32 addr, int32 data) {
+   uint32 v = MEM_BE32((uint32) data);
+
+   memcpy(&M[addr], &v, 4);
+}
+
+/* Inside storage ?  Else an addressing exception */
+static inline int mem_chk(int32 addr, int32 len) {
+   if ((uint32) addr + len <= (uint32) MEMSIZE)
+      return 1;
+   adr_ex_chk = ON;
+   return 0;
+}
+
+/* Level 5 store allowed by the storage keys ?  Else a protection check */
+static inline int mem_prot(int32 addr, int32 len) {
+   if (!prot_on || (lvl != 5) || (prot_key == 0) ||
+       ((stor_key[addr >> PROT_BLK] == prot_key) &&
+        (stor_key[(addr + len - 1) >> PROT_BLK] == prot_key)))
+      return 1;
+   prot_chk = ON;
+   return 0;
+}
+
+static inline int32 load16(int32 addr) {
+   return mem_chk(addr, 2) ? mem_rd16(addr) : 0;
+}
+
+static inline int32 load32(int32 addr) {
+   return mem_chk(addr, 4) ? mem_rd32(addr) : 0;
+}
+
+static inline void store16(int32 addr, int32 data) {
+   if (!mem_chk(addr, 2) || !mem_prot(addr, 2))
+      return;
+   mem_wr16(addr, data);
+   if (jit_watch[addr >> JIT_PAGE] | jit_watch[(addr + 1) >> JIT_PAGE])
+      cpu_jit_store(addr, 2);
+}
+
+static inline void store32(int32 addr, int32 data) {
+   if (!mem_chk(addr, 4) || !mem_prot(addr, 4))
+      return;
+   mem_wr32(addr, data);
+   if (jit_watch[addr >> JIT_PAGE] | jit_watch[(addr + 3) >> JIT_PAGE])
+      cpu_jit_store(addr, 4);
+}
+
+#endif
@@ -0,0 +1,473 @@
+/* i3705_metrics.c: IBM 3705 Prometheus metrics listener
+
+   Copyright (c) 2021, Henk Stegeman & Edwin Freekenhorst
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+   ROBERT M SUPNIK BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+   IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+   Except as contained in this notice, the name of Charles E. Owen shall not be
+   used in advertising or otherwise to promote the sale, use or other dealings
+   in this Software without prior written authorization from Charles E. Owen.
+
+   ------------------------------------------------------------------------------
+
+   SET METRICS PORT=n starts a small HTTP listener on its own thread that
+   answers every GET with the performance counters of i3705_stats.h in
+   Prometheus text format.  SET METRICS PORT=0 stops it; it is off by
+   default.
+
+   The listener only reads the counters with relaxed atomic loads and keeps
+   its own previous snapshot to derive the MIPS and level residency gauges
+   over the last scrape interval, so a scrape never takes a lock that the
+   CCU, CA, CS or PU threads use.
+
+   Each emulator thread registers itself with stats_thread() so its CPU time
+   can be read through its thread CPU clock.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "i3705_defs.h"
+#include "i3705_stats.h"
+#include "i3705_sock.h"
+
+#define MAX_THREADS     16
+#define METRICS_BUFLEN  65536
+
+extern int stat_lvl;                   // Level being timed, 0 = wait, -1 = stopped
+
+t_value get_uint (char *cptr, uint32 radix, t_value max, t_stat *status);
+
+struct THREAD_CLK {
+   const char *name;
+   clockid_t   cid;
+};
+
+static struct THREAD_CLK thread_clk[MAX_THREADS];
+static int  thread_cnt = 0;
+static pthread_mutex_t thread_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int32 metrics_port = 0;         // 0 = listener off
+static int   metrics_run  = 0;         // Listener thread must keep running
+static int   metrics_fd   = -1;        // Listen socket
+static pthread_t metrics_tid;
+
+void *METRICS_thread(void *arg);
+t_stat metrics_set_port (UNIT *uptr, int32 val, char *cptr, void *desc);
+t_stat metrics_show_port (FILE *st, UNIT *uptr, int32 val, void *desc);
+
+/* METRICS data structures
+
+   metrics_unit    METRICS unit descriptor
+   metrics_mod     METRICS modifiers list
+   metrics_dev     METRICS device descriptor
+*/
+
+UNIT metrics_unit = { UDATA (NULL, 0, 0) };
+
+MTAB metrics_mod[] = {
+    { MTAB_XTD|MTAB_VDV, 0, "PORT", "PORT", &metrics_set_port, &metrics_show_port },
+    { 0 }
+};
+
+DEVICE metrics_dev = {
+    "METRICS", &metrics_unit, NULL, metrics_mod,
+    1, 16, 16, 1, 16, 8,
+    NULL, NULL, NULL, NULL,
+    NULL, NULL
+};
+
+
+/*-------------------------------------------------------------------*/
+/* Register the calling thread for the thread CPU time metric.       */
+/* A thread that is restarted (CA1/CA2 on reconnect) replaces its    */
+/* previous entry.                                                   */
+/*-------------------------------------------------------------------*/
+void stats_thread(const char *name) {
+   clockid_t cid;
+   int i;
+
+   if (pthread_getcpuclockid(pthread_self(), &cid) != 0)
+      return;
+   pthread_mutex_lock(&thread_lock);
+   for (i = 0; i < thread_cnt; i++)
+      if (strcmp(thread_clk[i].name, name) == 0)
+         break;
+   if (i < MAX_THREADS) {
+      thread_clk[i].name = name;
+      thread_clk[i].cid  = cid;
+      if (i == thread_cnt)
+         thread_cnt++;
+   }
+   pthread_mutex_unlock(&thread_lock);
+}
+
+
+/*-------------------------------------------------------------------*/
+/* Latency histograms                                                */
+/*-------------------------------------------------------------------*/
+static int hist_index(uint64_t us) {
+   int msb, b;
+
+   if (us < HIST_SUB)
+      return (int) us;
+   msb = 63 - __builtin_clzll(us);
+   b = (msb - 1) * HIST_SUB + (int) ((us >> (msb - 2)) & (HIST_SUB - 1));
+   return (b < HIST_BUCKETS) ? b : HIST_BUCKETS - 1;
+}
+
+/* Upper bound (exclusive) of bucket b in microseconds */
+uint64_t hist_bucket_us(int b) {
+   if (b < HIST_SUB)
+      return b + 1;
+   return (uint64_t) (HIST_SUB + b % HIST_SUB + 1) << (b / HIST_SUB - 1);
+}
+
+void hist_record(struct LAT_HIST *h, uint64_t ns) {
+   uint64_t max;
+
+   STAT_INC(h->bucket[hist_index(ns / 1000)]);
+   STAT_INC(h->count);
+   STAT_ADD(h->sum_ns, ns);
+   max = STAT_GET(h->max_ns);
+   while (ns > max &&
+          !__atomic_compare_exchange_n(&h->max_ns, &max, ns, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      ;
+}
+
+/* Upper bound of the bucket holding the pct percentile */
+uint64_t hist_percentile_us(struct LAT_HIST *h, double pct) {
+   uint64_t count, want, seen = 0;
+   int b;
+
+   count = STAT_GET(h->count);
+   if (count == 0)
+      return 0;
+   want = (uint64_t) (count * pct / 100.0 + 0.5);
+   if (want < 1)
+      want = 1;
+   for (b = 0; b < HIST_BUCKETS; b++) {
+      seen += STAT_GET(h->bucket[b]);
+      if (seen >= want)
+         return hist_bucket_us(b);
+   }
+   return hist_bucket_us(HIST_BUCKETS - 1);
+}
+
+
+/*-------------------------------------------------------------------*/
+/* SET METRICS PORT=n                                                */
+/*-------------------------------------------------------------------*/
+t_stat metrics_set_port (UNIT *uptr, int32 val, char *cptr, void *desc) {
+   struct sockaddr_in addr;
+   t_stat r;
+   int32  port;
+   int    on = 1;
+
+   if (cptr == NULL)
+      return SCPE_ARG;
+   port = (int32) get_uint (cptr, 10, 65535, &r);
+   if (r != SCPE_OK)
+      return r;
+
+   if (metrics_run) {                  // Stop the running listener first
+      metrics_run = 0;
+      pthread_join(metrics_tid, NULL);
+      close(metrics_fd);
+      metrics_fd = -1;
+   }
+   metrics_port = 0;
+   if (port == 0)
+      return SCPE_OK;
+
+   metrics_fd = socket(AF_INET, SOCK_STREAM, 0);
+   if (metrics_fd < 0)
+      return SCPE_OPENERR;
+   setsockopt(metrics_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family      = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_ANY);
+   addr.sin_port        = htons(port);
+   sock_tune(metrics_fd);
+   if (bind(metrics_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+       listen(metrics_fd, 4) < 0) {
+      printf("METRICS: Cannot listen on port %d: %s\n", port, strerror(errno));
+      close(metrics_fd);
+      metrics_fd = -1;
+      return SCPE_OPENERR;
+   }
+
+   metrics_port = port;
+   metrics_run  = 1;
+   if (pthread_create(&metrics_tid, NULL, METRICS_thread, NULL) != 0) {
+      metrics_run  = 0;
+      metrics_port = 0;
+      close(metrics_fd);
+      metrics_fd = -1;
+      return SCPE_OPENERR;
+   }
+   return SCPE_OK;
+}
+
+t_stat metrics_show_port (FILE *st, UNIT *uptr, int32 val, void *desc) {
+   if (metrics_port == 0)
+      fprintf(st, "port=off");
+   else
+      fprintf(st, "port=%d", metrics_port);
+   return SCPE_OK;
+}
+
+
+/*-------------------------------------------------------------------*/
+/* Build the metrics page in buf, returns its length.                */
+/*-------------------------------------------------------------------*/
+static int metrics_page(char *buf, int size) {
+   static uint64_t prev_ns = 0, prev_instr = 0, prev_time[6];
+   static const char *lat_dir[2] = { "out", "in" };
+   struct LAT_HIST *h;
+   struct CA_STATS *cs;
+   uint64_t cum;
+   int d, b;
+   struct timespec ts;
+   uint64_t now, instr, time_ns[6], span;
+   uint8_t  lu;
+   int n = 0, i, j, ca;
+
+#define EMIT(...)  do { if (n < size) n += snprintf(buf + n, size - n, __VA_ARGS__); } while (0)
+
+   now = stats_now_ns();
+   instr = 0;
+   for (i = 1; i <= 5; i++)
+      instr += STAT_GET(cpu_stats.instr[i]);
+   for (i = 0; i <= 5; i++)
+      time_ns[i] = STAT_GET(cpu_stats.time_ns[i]);
+
+   /* Gauges over the last scrape interval; a RESET STATS in between
+      makes the counters go backwards, then report over the new run. */
+   if (prev_ns == 0 || instr < prev_instr) {
+      prev_ns = stats_reset_ns;
+      prev_instr = 0;
+      memset(prev_time, 0, sizeof(prev_time));
+   }
+   span = now - prev_ns;
+
+   /* CCU */
+   EMIT("# HELP i3705_cpu_mips CCU instructions per microsecond over the last scrape interval.\n");
+   EMIT("# TYPE i3705_cpu_mips gauge\n");
+   EMIT("i3705_cpu_mips %.3f\n", (span > 0) ? (instr - prev_instr) * 1e3 / span : 0.0);
+   EMIT("# HELP i3705_cpu_level_percent Percentage of time per program level over the last scrape interval.\n");
+   EMIT("# TYPE i3705_cpu_level_percent gauge\n");
+   for (i = 0; i <= 5; i++) {
+      if (time_ns[i] < prev_time[i])
+         prev_time[i] = 0;
+      if (i == 0)
+         EMIT("i3705_cpu_level_percent{level=\"wait\"} %.2f\n",
+              (span > 0) ? (time_ns[i] - prev_time[i]) * 100.0 / span : 0.0);
+      else
+         EMIT("i3705_cpu_level_percent{level=\"%d\"} %.2f\n", i,
+              (span > 0) ? (time_ns[i] - prev_time[i]) * 100.0 / span : 0.0);
+   }
+   EMIT("# HELP i3705_cpu_level_seconds_total Time spent per program level.\n");
+   EMIT("# TYPE i3705_cpu_level_seconds_total counter\n");
+   EMIT("i3705_cpu_level_seconds_total{level=\"wait\"} %.6f\n", time_ns[0] / 1e9);
+   for (i = 1; i <= 5; i++)
+      EMIT("i3705_cpu_level_seconds_total{level=\"%d\"} %.6f\n", i, time_ns[i] / 1e9);
+   EMIT("# HELP i3705_cpu_instructions_total Instructions executed per program level.\n");
+   EMIT("# TYPE i3705_cpu_instructions_total counter\n");
+   for (i = 1; i <= 5; i++)
+      EMIT("i3705_cpu_instructions_total{level=\"%d\"} %" PRIu64 "\n", i, STAT_GET(cpu_stats.instr[i]));
+   EMIT("# HELP i3705_cpu_level_entries_total Program level entries.\n");
+   EMIT("# TYPE i3705_cpu_level_entries_total counter\n");
+   for (i = 1; i <= 5; i++)
+      EMIT("i3705_cpu_level_entries_total{level=\"%d\"} %" PRIu64 "\n", i, STAT_GET(cpu_stats.entries[i]));
+   EMIT("# HELP i3705_cpu_jit_blocks_total Predecoded blocks entered (SET CPU JIT=ON).\n");
+   EMIT("# TYPE i3705_cpu_jit_blocks_total counter\n");
+   EMIT("i3705_cpu_jit_blocks_total %" PRIu64 "\n", STAT_GET(cpu_stats.jit_runs));
+   EMIT("# HELP i3705_cpu_idle_sleeps_total Host sleeps of an idle CCU (SET CPU IDLE=ON).\n");
+   EMIT("# TYPE i3705_cpu_idle_sleeps_total counter\n");
+   EMIT("i3705_cpu_idle_sleeps_total %" PRIu64 "\n", STAT_GET(cpu_stats.idle_sleeps));
+   EMIT("# HELP i3705_timer_ticks_total Interval timer ticks, delivered and missed.\n");
+   EMIT("# TYPE i3705_timer_ticks_total counter\n");
+   EMIT("i3705_timer_ticks_total{result=\"delivered\"} %" PRIu64 "\n", STAT_GET(cpu_stats.timer_ticks));
+   EMIT("i3705_timer_ticks_total{result=\"missed\"} %" PRIu64 "\n", STAT_GET(cpu_stats.timer_missed));
+   EMIT("# HELP i3705_cpu_utilization_ratio CCU busy share since the last OUT X'7A', as NCP reads it with IN X'7A'.\n");
+   EMIT("# TYPE i3705_cpu_utilization_ratio gauge\n");
+   EMIT("i3705_cpu_utilization_ratio %.4f\n", (now > STAT_GET(cuc_reset_ns)) ?
+        (double) cpu_cuc_busy_ns() / (now - STAT_GET(cuc_reset_ns)) : 0.0);
+   EMIT("# HELP i3705_cpu_level Current program level, 0 in wait state, -1 when stopped.\n");
+   EMIT("# TYPE i3705_cpu_level gauge\n");
+   EMIT("i3705_cpu_level %d\n", __atomic_load_n(&stat_lvl, __ATOMIC_RELAXED));
+
+   prev_ns = now;
+   prev_instr = instr;
+   memcpy(prev_time, time_ns, sizeof(prev_time));
+
+   /* Channel adapters */
+   EMIT("# HELP i3705_ca_ccw_total Channel commands received.\n");
+   EMIT("# TYPE i3705_ca_ccw_total counter\n");
+   for (ca = 0; ca < 2; ca++)
+      for (j = 0, cs = &ca_stats[ca]; j < 256; j++)
+         if (STAT_GET(cs->ccw[j]))
+            EMIT("i3705_ca_ccw_total{ca=\"%d\",cmd=\"%02X\"} %" PRIu64 "\n", ca + 1, j, STAT_GET(cs->ccw[j]));
+   EMIT("# HELP i3705_ca_ccw_seconds Time from CCW to final status.\n");
+   EMIT("# TYPE i3705_ca_ccw_seconds summary\n");
+   for (ca = 0; ca < 2; ca++)
+      for (j = 0, cs = &ca_stats[ca]; j < 256; j++)
+         if (STAT_GET(cs->ccw[j])) {
+            EMIT("i3705_ca_ccw_seconds_sum{ca=\"%d\",cmd=\"%02X\"} %.6f\n", ca + 1, j, STAT_GET(cs->ccw_ns[j]) / 1e9);
+            EMIT("i3705_ca_ccw_seconds_count{ca=\"%d\",cmd=\"%02X\"} %" PRIu64 "\n", ca + 1, j, STAT_GET(cs->ccw[j]));
+         }
+   EMIT("# TYPE i3705_ca_bytes_total counter\n");
+   for (ca = 0; ca < 2; ca++) {
+      cs = &ca_stats[ca];
+      EMIT("i3705_ca_bytes_total{ca=\"%d\",dir=\"in\"} %" PRIu64 "\n", ca + 1, STAT_GET(cs->bytes_in));
+      EMIT("i3705_ca_bytes_total{ca=\"%d\",dir=\"out\"} %" PRIu64 "\n", ca + 1, STAT_GET(cs->bytes_out));
+   }
+   EMIT("# TYPE i3705_ca_l3_requests_total counter\n");
+   for (ca = 0; ca < 2; ca++)
+      EMIT("i3705_ca_l3_requests_total{ca=\"%d\"} %" PRIu64 "\n", ca + 1, STAT_GET(ca_stats[ca].l3_req));
+   EMIT("# TYPE i3705_ca_attentions_total counter\n");
+   for (ca = 0; ca < 2; ca++)
+      EMIT("i3705_ca_attentions_total{ca=\"%d\"} %" PRIu64 "\n", ca + 1, STAT_GET(ca_stats[ca].attn));
+   EMIT("# TYPE i3705_ca_attentions_merged_total counter\n");
+   for (ca = 0; ca < 2; ca++)
+      EMIT("i3705_ca_attentions_merged_total{ca=\"%d\"} %" PRIu64 "\n", ca + 1, STAT_GET(ca_stats[ca].attn_merged));
+   EMIT("# TYPE i3705_ca_socket_errors_total counter\n");
+   for (ca = 0; ca < 2; ca++)
+      EMIT("i3705_ca_socket_errors_total{ca=\"%d\"} %" PRIu64 "\n", ca + 1, STAT_GET(ca_stats[ca].sock_err));
+   EMIT("# TYPE i3705_ca_failovers_total counter\n");
+   for (ca = 0; ca < 2; ca++)
+      EMIT("i3705_ca_failovers_total{ca=\"%d\"} %" PRIu64 "\n", ca + 1, STAT_GET(ca_stats[ca].failover));
+
+   /* Communication scanner, one line set for now */
+   EMIT("# HELP i3705_cs_frames_total SDLC frames by type, in = from the NCP.\n");
+   EMIT("# TYPE i3705_cs_frames_total counter\n");
+   for (j = 0; j < CS_FRM_TYPES; j++) {
+      EMIT("i3705_cs_frames_total{line=\"0\",dir=\"in\",type=\"%s\"} %" PRIu64 "\n",
+           cs_frm_name[j], STAT_GET(cs_stats.frm_in[j]));
+      EMIT("i3705_cs_frames_total{line=\"0\",dir=\"out\",type=\"%s\"} %" PRIu64 "\n",
+           cs_frm_name[j], STAT_GET(cs_stats.frm_out[j]));
+   }
+
+   /* PU / LU's */
+   EMIT("# TYPE i3705_pu_pius_total counter\n");
+   for (j = 0; j < 256; j++)
+      if (STAT_GET(pu_stats.piu_in[j]) || STAT_GET(pu_stats.piu_out[j])) {
+         EMIT("i3705_pu_pius_total{lu=\"%02X\",dir=\"in\"} %" PRIu64 "\n", j, STAT_GET(pu_stats.piu_in[j]));
+         EMIT("i3705_pu_pius_total{lu=\"%02X\",dir=\"out\"} %" PRIu64 "\n", j, STAT_GET(pu_stats.piu_out[j]));
+      }
+   EMIT("# HELP i3705_pu_sessions_total LU-LU sessions started and ended.\n");
+   EMIT("# TYPE i3705_pu_sessions_total counter\n");
+   for (j = 0; j < 256; j++)
+      if (STAT_GET(pu_stats.binds[j]) || STAT_GET(pu_stats.unbinds[j])) {
+         EMIT("i3705_pu_sessions_total{lu=\"%02X\",event=\"bind\"} %" PRIu64 "\n", j, STAT_GET(pu_stats.binds[j]));
+         EMIT("i3705_pu_sessions_total{lu=\"%02X\",event=\"unbind\"} %" PRIu64 "\n", j, STAT_GET(pu_stats.unbinds[j]));
+      }
+   EMIT("# HELP i3705_pu_latency_seconds Response time, out = channel WRITE to terminal, in = terminal to channel READ.\n");
+   EMIT("# TYPE i3705_pu_latency_seconds histogram\n");
+   for (d = 0; d < 2; d++)
+      for (j = 0; j < 256; j++) {
+         h = (d == 0) ? &pu_stats.lat_out[j] : &pu_stats.lat_in[j];
+         if (STAT_GET(h->count) == 0)
+            continue;
+         /* Only the power of two bucket edges, to keep the page small */
+         for (b = 0, cum = 0; b < HIST_BUCKETS; b++) {
+            cum += STAT_GET(h->bucket[b]);
+            if (b % HIST_SUB == HIST_SUB - 1) {
+               EMIT("i3705_pu_latency_seconds_bucket{lu=\"%02X\",dir=\"%s\",le=\"%g\"} %" PRIu64 "\n",
+                    j, lat_dir[d], hist_bucket_us(b) / 1e6, cum);
+               if (cum == STAT_GET(h->count))
+                  break;
+            }
+         }
+         EMIT("i3705_pu_latency_seconds_bucket{lu=\"%02X\",dir=\"%s\",le=\"+Inf\"} %" PRIu64 "\n",
+              j, lat_dir[d], STAT_GET(h->count));
+         EMIT("i3705_pu_latency_seconds_sum{lu=\"%02X\",dir=\"%s\"} %.6f\n",
+              j, lat_dir[d], STAT_GET(h->sum_ns) / 1e9);
+         EMIT("i3705_pu_latency_seconds_count{lu=\"%02X\",dir=\"%s\"} %" PRIu64 "\n",
+              j, lat_dir[d], STAT_GET(h->count));
+      }
+   EMIT("# HELP i3705_pu_sessions_active LU-LU sessions currently bound.\n");
+   EMIT("# TYPE i3705_pu_sessions_active gauge\n");
+   if (pu_session(&lu))
+      EMIT("i3705_pu_sessions_active{lu=\"%02X\"} 1\n", lu);
+   EMIT("# TYPE i3705_pu_socket_errors_total counter\n");
+   EMIT("i3705_pu_socket_errors_total %" PRIu64 "\n", STAT_GET(pu_stats.sock_err));
+
+   /* Emulator threads */
+   EMIT("# HELP i3705_thread_cpu_seconds_total CPU time used per emulator thread.\n");
+   EMIT("# TYPE i3705_thread_cpu_seconds_total counter\n");
+   pthread_mutex_lock(&thread_lock);
+   for (i = 0; i < thread_cnt; i++)
+      if (clock_gettime(thread_clk[i].cid, &ts) == 0)
+         EMIT("i3705_thread_cpu_seconds_total{thread=\"%s\"} %ld.%06ld\n",
+              thread_clk[i].name, (long) ts.tv_sec, ts.tv_nsec / 1000);
+   pthread_mutex_unlock(&thread_lock);
+
+#undef EMIT
+   return (n < size) ? n : size - 1;
+}
+
+
+/*-------------------------------------------------------------------*/
+/* Listener thread: one request per connection, whatever the path.   */
+/*-------------------------------------------------------------------*/
+void *METRICS_thread(void *arg) {
+   struct pollfd pfd;
+   char  req[1024], hdr[128];
+   char *page;
+   int   sfd, len, hlen;
+
+   page = malloc(METRICS_BUFLEN);
+   if (page == NULL)
+      return NULL;
+   stats_thread("METRICS");
+   printf("\nMETRICS: Listening on port %d\n", metrics_port);
+
+   while (metrics_run) {
+      pfd.fd = metrics_fd;
+      pfd.events = POLLIN;
+      if (poll(&pfd, 1, 500) <= 0)     // Wake up now and then to check metrics_run
+         continue;
+      sfd = accept(metrics_fd, NULL, NULL);
+      if (sfd < 0)
+         continue;
+      sock_tune(sfd);
+
+      pfd.fd = sfd;                    // Don't let a silent client block us
+      if (poll(&pfd, 1, 1000) > 0 && recv(sfd, req, sizeof(req), 0) > 0) {
+         len  = metrics_page(page, METRICS_BUFLEN);
+         hlen = snprintf(hdr, sizeof(hdr),
+                   "HTTP/1.0 200 OK\r\n"
+                   "Content-Type: text/plain; version=0.0.4\r\n"
+                   "Content-Length: %d\r\n\r\n", len);
+         send(sfd, hdr, hlen, MSG_NOSIGNAL);
+         send(sfd, page, len, MSG_NOSIGNAL);
+      }
+      close(sfd);
+   }
+   free(page);
+   return NULL;
+}
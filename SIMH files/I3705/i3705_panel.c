@@ -44,14 +44,18 @@
 #include <sys/syscall.h>
 #include "i3705_defs.h"
 #include "i3705_Eregs.h"               /* Exernal regs defs */
+#include "i3705_stats.h"
+#include "i3705_chan_T2.h"             /* CA state (A/B switch) */
+#include "i3705_sock.h"                /* TCP socket tuning */
+#include "i3705_mem.h"                 /* Storage access */
 
 extern int32 PC;
 extern int32 saved_PC;
 extern int32 opcode;
 extern int32 Eregs_Out[];
 extern int32 Eregs_Inp[];
-extern int8  timer_req_L3;
 extern int8  inter_req_L3;
+extern void  cpu_wake(void);           /* Wake an idle CCU */
 
 // CCU status flags
 extern int8  test_mode;
@@ -59,15 +63,13 @@ extern int8  load_state;
 extern int8  wait_state;
 extern int8  pgm_stop;
 
-void sig_handler (int signo);
-void timer_msec (long int msec);
+int  timer_start(void);                /* Interval timer, i3705_timer.c */
 
 int rc, inp, i;
 int32 hex_sw, rot_sw;
 
 #define IAC      255                   /* Interpret as Command */
 #define EOR_MARK 239                   /* End of record marker */
-#define MAXPORTS 4
 
 int rpfd;
 int lpfd;
@@ -115,22 +117,7 @@ uint8_t fs[10][12] = {{"\x11\xD3\x5B\x29\x03\xC0\xF0\x42\xF4\x41\xF2\0"},
                   {"\x11\xD4\xD9\x29\x03\xC0\xF0\x42\xF4\x41\xF2\0"},
                   {"\x11\xD3\xC9\x29\x03\xC0\xF0\x42\xF4\x41\xF2\0"}};
 
-extern uint8 M[MAXMEMSIZE];
 extern pthread_mutex_t r7f_lock;
-extern struct IO3705 {
-   char CA_id;
-   int CA_active;
-   int CA_socket[2];
-   uint16_t CA_mask;
-   int addrlen[MAXPORTS];
-   int bus_socket[2];
-   int tag_socket[2];
-   int abswitch;
-   uint16_t devnum;
-   uint8_t buffer[1024];               // Data buffer of 1K
-   uint32_t bufferl;                   // Received data length
-   struct sockaddr_in address[2];
-   } *iob1, *iob2;
 
 uint8_t  class;                        /* D=3270, P=3287, K=3215/1052 */
 uint8_t  model;                        /* 3270 model (2, 3, 4, 5, X)  */
@@ -161,6 +148,7 @@ char ebc2hex (char ebc0, char ebc1);
 
 void *PNL_thread(void *arg) {
    fprintf(stderr, "PNL: Thread %ld started succesfully... \n\r", syscall(SYS_gettid));
+   stats_thread("PNL");
 
    // We can set one or more bits here, each one representing a single CPU
    //cpu_set_t cpuset;
@@ -181,8 +169,7 @@ void *PNL_thread(void *arg) {
    //sched_setaffinity(0, sizeof(cpuset), &cpuset);
 
 
-   signal (SIGALRM, sig_handler);      /* Interval timer */
-   timer_msec(100);                    // <=== sets the 3705 interval timer
+   timer_start();                      // <=== starts the 3705 interval timer
 
    int disp_regA, disp_regB;
    int inp_h, inp_l;
@@ -219,6 +206,7 @@ void *PNL_thread(void *arg) {
       return NULL;
    }
    rpfd = 0;
+   sock_tune(lpfd);
    /* Start the listen */
    rc = listen(lpfd, 1);
    if (rc < 0) {
@@ -233,6 +221,7 @@ void *PNL_thread(void *arg) {
    if (rpfd < 1) {
       printf("PNL: Waiting for 3270 connection \n\r");
       rpfd = accept(lpfd, NULL, 0);
+      sock_tune(rpfd);
 
       /* Negotiate telnet parameters */
       rc = negotiate (rpfd, &class, &model, &extended, &devnum, group);
@@ -742,6 +731,7 @@ while (1) {
             Eregs_Inp[0x7F] |= 0x0200;
             pthread_mutex_unlock(&r7f_lock);
             inter_req_L3 = ON;               /* Panel L3 request flag */
+            cpu_wake();
             while (Ireg_bit(0x7F,0x0200) == ON)
                wait();
          break;
@@ -787,7 +777,7 @@ while (1) {
                   len = snprintf (buft, sizeof(buft)-1, "\x11\xC6\x7D\x40") + len;
                   strcat(buf, buft);
                   /* Byte 1 will show content of memory location */
-                  mbyte = M[maddr];
+                  mbyte = (maddr < MEMSIZE) ? M[maddr] : 0x00;  // Switches reach X'FFFFF'
                   nibble[0] = (mbyte >> 4) & 0x000F;
                   nibble[0] |= 0xF0;
                   if (nibble[0] > 0xF9) nibble[0] = nibble[0] - 0x39;
@@ -876,7 +866,7 @@ while (1) {
       printf("Display 2: %05X\n\r", Eregs_Out[0x72]);
 
       /* Pick up free buffer count */
-      freebuf = (M[0x0754] << 8) + M[0x0755];
+      freebuf = mem_rd16(0x0754);
       snprintf(bufc, 5, "%4d", freebuf);
       for (int i = 0; i < 4; i++)
          bufh[i] = (bufc[i] | 0xF0);
@@ -969,30 +959,6 @@ while (1) {
    }             /* End while (1) loop */
 }
 
-// *****************************************************
-// Interval timer definition
-// *****************************************************
-void timer_msec (long int msec) {
-   struct itimerval timer1;
-
-   timer1.it_interval.tv_usec = (1000 * msec);
-   timer1.it_interval.tv_sec = 0;
-   timer1.it_value.tv_usec = (1000 * msec);
-   timer1.it_value.tv_sec = 0;
-
-   setitimer (ITIMER_REAL, &timer1, NULL);
-}
-
-// Kick the 3705 100msec timer...
-void sig_handler (int signo) {
-   if ((test_mode == OFF) && !(Eregs_Inp[0x7F] &= 0x0004)) {
-      pthread_mutex_lock(&r7f_lock);
-      Eregs_Inp[0x7F] |= 0x0004;
-      pthread_mutex_unlock(&r7f_lock);
-      timer_req_L3 = ON;
-   }
-}
-
 char ebc2hex (char ebc0, char ebc1)
 {
    char hexbyte;
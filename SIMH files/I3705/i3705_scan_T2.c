@@ -106,6 +106,8 @@
 #include "i3705_sdlc.h"
 
 #include "i3705_Eregs.h"               /* External regs defs */
+#include "i3705_stats.h"               /* Performance counters */
+#include "i3705_ckpt.h"                /* Checkpoint state */
 #include <signal.h>
 #include <ctype.h>
 #include <time.h>
@@ -122,6 +124,7 @@ extern int32 debug_reg;
 extern int32 Eregs_Inp[];
 extern int32 Eregs_Out[];
 extern int8  svc_req_L2;               /* SVC L2 request flag */
+extern void  cpu_wake(void);           /* Wake an idle CCU */
 extern FILE *trace;
 extern int32 lvl;
 extern int32 cc;
@@ -152,11 +155,40 @@ uint8_t icw_pcf_mod = 0x00;
 int8 CS2_req_L2_int = OFF;
 uint8_t BLU_buf[65536];                   /* DLC header + TH + RH + RU + DLC trailer */
 pthread_mutex_t icw_lock;              /* ICW lock (0 - 45)  */
+
+struct CKPT_ITEM cs_ckpt[] = {         /* ICW local store, see i3705_ckpt.h */
+   CKPT(abar), CKPT(icw_scf), CKPT(icw_pdf), CKPT(icw_lcd), CKPT(icw_pcf),
+   CKPT(icw_sdf), CKPT(icw_Rflags), CKPT(icw_pcf_prev), CKPT(icw_lne_stat),
+   CKPT(icw_pcf_new), CKPT(icw_pcf_mod), CKPT(icw_pdf_reg), CKPT(CS2_req_L2_int),
+   CKPT(Rsp_buf), CKPT(Plen), CKPT(Eflg_rvcd), CKPT(BLU_buf),
+   { NULL }
+};
 extern pthread_mutex_t r77_lock;       /* I/O reg x'77' lock */
 
 void proc_BLU(char *BLU_buf, int j);
 void Put_ICW(int i);
 void Get_ICW(int i);
+t_stat cs_show_stats (FILE *st, UNIT *uptr, int32 val, void *desc);
+
+/* CS data structures
+   cs_unit      CS unit descriptor
+   cs_dev       CS device descriptor
+   cs_mod       CS modifiers list
+*/
+
+UNIT cs_unit = { UDATA (NULL, 0, 0) };
+
+MTAB cs_mod[] = {
+    { MTAB_XTD|MTAB_VDV|MTAB_NMO, 0, "STATS", NULL, NULL, &cs_show_stats },
+    { 0 }
+};
+
+DEVICE cs_dev = {
+    "CS", &cs_unit, NULL, cs_mod,
+    1, 16, 16, 1, 16, 8,
+    NULL, NULL, NULL, NULL,
+    NULL, NULL
+};
 
 /* Function to be run as a thread always must have the same signature:
    it has one void* parameter and returns void                        */
@@ -168,6 +200,7 @@ void *CS2_thread(void *arg) {
    register char *s;
 
    fprintf(stderr, "\nCS2: thread %ld started succesfully...\n",syscall(SYS_gettid));
+   stats_thread("CS2");
 
    while(1) {
 //    for (i = 0; i < MAX_TBAR; i++) {     // Pending multiple line support !!!
@@ -385,6 +418,7 @@ void *CS2_thread(void *arg) {
  //         Eregs_Inp[0x77] |= 0x4000; // Indicate L2 scanner interrupt
             pthread_mutex_unlock(&r77_lock);
             svc_req_L2 = ON;           // Issue a level 2 interrrupt
+            cpu_wake();
             CS2_req_L2_int = OFF;      // Reset int req flag
          }
          icw_pcf_prev[t] = icw_pcf[t]; // Save current pcf
@@ -428,3 +462,17 @@ void Get_ICW(int abar) {               // See 3705 CE manauls for details.
    return;
 }
 
+/* SHOW CS STATS */
+t_stat cs_show_stats (FILE *st, UNIT *uptr, int32 val, void *desc) {
+   double secs;
+   int    i;
+
+   secs = (stats_now_ns() - stats_reset_ns) / 1e9;
+   fprintf(st, "\nCS2 SDLC statistics over %.3f sec\n", secs);
+   fprintf(st, "Frame         From NCP      Frames/s        To NCP      Frames/s\n");
+   for (i = 0; i < CS_FRM_TYPES; i++)
+      fprintf(st, "%-6s  %14" PRIu64 " %13.1f %13" PRIu64 " %13.1f\n", cs_frm_name[i],
+              STAT_GET(cs_stats.frm_in[i]),  (secs > 0) ? STAT_GET(cs_stats.frm_in[i]) / secs : 0.0,
+              STAT_GET(cs_stats.frm_out[i]), (secs > 0) ? STAT_GET(cs_stats.frm_out[i]) / secs : 0.0);
+   return SCPE_OK;
+}
@@ -36,6 +36,8 @@
 #include "sim_defs.h"
 #include "i3705_defs.h"
 #include "i3705_sdlc.h"
+#include "i3705_stats.h"
+#include "i3705_ckpt.h"
 
 extern FILE *trace;
 extern int8 debug_reg;
@@ -46,10 +48,20 @@ int8 stat_mode = NDM;
 int8 new_S_Nr, new_S_Ns;               // Secondairy station frame numbers
 int8 rxtx_dir = RX;                    // Rx or Tx flag
 
+struct CKPT_ITEM sdlc_ckpt[] = {       // Secondary station state, see i3705_ckpt.h
+   CKPT(stat_mode), CKPT(new_S_Nr), CKPT(new_S_Ns), CKPT(rxtx_dir),
+   { NULL }
+};
+
+struct CS_STATS cs_stats;              // SDLC frame counters
+const char *cs_frm_name[CS_FRM_TYPES] = {
+   "I", "RR", "RNR", "REJ", "SNRM", "DISC", "UA", "Other" };
+
 void proc_BLU(unsigned char BLU_buf[], int Blen);   // SDLC frame handler
 void proc_frame(unsigned char BLU_buf[], int Fptr, int Blen); // Process frame header
 int  proc_PIU(unsigned char PIU_buf[], int Fptr, int Blen, int Ftype);   // PIU handler
 void trace_Fbuf(unsigned char BLU_buf[], int Fptr, int Blen, int rxtx_dir);   // Print trace records
+int  frm_type(uint8_t Fcntl);                                      // Frame type for counters
 
 //*********************************************************************
 //   Incomming SDLC frame (BLU) handler
@@ -87,6 +99,7 @@ void proc_frame(unsigned char BLU_buf[], int Fptr, int Blen) {
 
    if (debug_reg & 0x20)
       trace_Fbuf(BLU_buf, Fptr, Blen, TX);     // Print trace records
+   STAT_INC(cs_stats.frm_in[frm_type(BLU_buf[Fptr + FCntl])]);
 
    switch (BLU_buf[Fptr + FCntl] & 0x03) {
       case UNNUM:
@@ -124,6 +137,8 @@ void proc_frame(unsigned char BLU_buf[], int Fptr, int Blen) {
             default:
                break;
          }   // End of switch TCntl & 0xEF
+         if (BLU_buf[BFlag] != 0x00)
+            STAT_INC(cs_stats.frm_out[frm_type(BLU_buf[Fptr + FCntl])]);
          if (debug_reg & 0x20)
             trace_Fbuf(BLU_buf, Fptr, Blen - Fptr, RX); // Print trace records
          break;
@@ -165,6 +180,7 @@ void proc_frame(unsigned char BLU_buf[], int Fptr, int Blen) {
                      BLU_buf[Fptr + FCntl] = (new_S_Nr << 5) + CFinal + (new_S_Ns << 1);
                      last_S_Ns = new_S_Ns;                 //
                   }
+                  STAT_INC(cs_stats.frm_out[(Plen == 0) ? CS_FRM_RR : CS_FRM_I]);
                   if (debug_reg & 0x20)
                      trace_Fbuf(BLU_buf, Fptr, 6 + Plen, RX);       // Print trace records
                }
@@ -209,6 +225,7 @@ void proc_frame(unsigned char BLU_buf[], int Fptr, int Blen) {
                BLU_buf[Fptr + FCntl] = (new_S_Nr << 5) + CFinal + (new_S_Ns << 1);
                last_S_Ns = new_S_Ns;                 //
             }
+         STAT_INC(cs_stats.frm_out[(Plen == 0) ? CS_FRM_RR : CS_FRM_I]);
          if (debug_reg & 0x20)
             trace_Fbuf(BLU_buf, Fptr, 6 + Plen, RX);
          }
@@ -217,6 +234,30 @@ void proc_frame(unsigned char BLU_buf[], int Fptr, int Blen) {
    }  // End of switch (rxtx_Fbuf[FCntl] & 0x03)
 }
 
+//*********************************************************************
+//   Classify a frame control byte for the CS frame counters
+//*********************************************************************
+int frm_type(uint8_t Fcntl) {
+   switch (Fcntl & 0x03) {
+      case UNNUM:
+         switch (Fcntl & 0xEF) {
+            case SNRM: return CS_FRM_SNRM;
+            case DISC: return CS_FRM_DISC;
+            case UA:   return CS_FRM_UA;
+         }
+         return CS_FRM_OTHER;
+      case SUPRV:
+         switch (Fcntl & 0x0F) {
+            case RR:   return CS_FRM_RR;
+            case RNR:  return CS_FRM_RNR;
+            case REJ:  return CS_FRM_REJ;
+         }
+         return CS_FRM_OTHER;
+      default:
+         return CS_FRM_I;
+   }
+}
+
 //*********************************************************************
 //   Print trace records of frame buffer (Fbuf)
 //*********************************************************************
@@ -0,0 +1,204 @@
+/* i3705_shm.h: IBM 3705 shared memory channel transport
+
+   Copyright (c) 2021, Henk Stegeman & Edwin Freekenhorst
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+   ROBERT M SUPNIK BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+   IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+   Except as contained in this notice, the name of Charles E. Owen shall not be
+   used in advertising or otherwise to promote the sale, use or other dealings
+   in this Software without prior written authorization from Charles E. Owen.
+
+   ------------------------------------------------------------------------------
+
+   Shared memory replacement for the bus and tag TCP connections between
+   Hercules (comm3705.c) and the 3705 channel adapter, for when both run
+   on the same Linux host.  This header is used by both sides: copy it
+   next to comm3705.c when building Hercules.
+
+   The segment holds four single producer / single consumer rings, one per
+   direction of the bus and tag connections.  A ring carries records: a
+   4 byte length followed by the data, padded to 4 bytes.  shm_send() puts
+   one record, shm_recv() takes up to len bytes of the oldest record, so
+   each send on one side matches one recv on the other, just as the
+   lock-step channel protocol uses the sockets.  A short recv leaves the
+   rest of the record for the next one, like a stream socket.
+
+   Every move of head or tail bumps the ring's doorbell word.  A side that
+   has to sleep counts itself in waiters and does a FUTEX_WAIT on the
+   doorbell value it last saw; the bell only makes the FUTEX_WAKE call when
+   waiters is non zero, so while both sides keep up a message costs no
+   system call at all.  Both sides use sequentially consistent updates of
+   bell and waiters: either the ringer sees the waiter, or the waiter's
+   FUTEX_WAIT sees the new doorbell value and returns at once.  The tag
+   ring doorbell is the attention signal.
+
+   The 3705 side creates the segment (SET CAn TRANSPORT=SHM:name) and sets
+   ccu_up, Hercules attaches (SHM=name on the device statement), resets the
+   rings, bumps host_gen and sets host_up, then sends the device number on
+   the bus ring exactly as on the TCP bus socket.  A recv returns 0, like
+   a closed socket, once the other side has dropped its up flag and the
+   ring is empty.
+*/
+
+#ifndef _I3705_SHM_H_
+#define _I3705_SHM_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/futex.h>
+
+#define SHM_MAGIC       0x33373035      // "3705"
+#define SHM_VERSION     2
+#define SHM_RING_SIZE   (256 * 1024)    // Power of two, holds a full 64K CCW
+#define SHM_WAIT_MS     200             // Recheck the peer up flag this often
+
+#define SHM_BUS_H2C     0               // Bus: host -> 3705
+#define SHM_BUS_C2H     1               // Bus: 3705 -> host
+#define SHM_TAG_H2C     2               // Tag: host -> 3705 (attention acks)
+#define SHM_TAG_C2H     3               // Tag: 3705 -> host (attentions)
+
+struct SHM_RING {
+   uint32_t head __attribute__ ((aligned (64)));   // Producer position
+   uint32_t tail __attribute__ ((aligned (64)));   // Consumer position
+   uint32_t part;                                  // Consumer: bytes taken of current record
+   uint32_t bell __attribute__ ((aligned (64)));   // Futex doorbell
+   uint32_t waiters;                               // Sides sleeping on bell
+   uint8_t  data[SHM_RING_SIZE] __attribute__ ((aligned (64)));
+};
+
+struct SHM_CHAN {
+   uint32_t magic;
+   uint32_t version;
+   uint32_t ccu_up;                     // 3705 side has the segment open
+   uint32_t host_up;                    // Hercules side is attached
+   uint32_t host_gen;                   // Bumped on every Hercules attach
+   struct SHM_RING ring[4];
+};
+
+static inline void shm_bell(struct SHM_RING *r) {
+   __atomic_add_fetch(&r->bell, 1, __ATOMIC_SEQ_CST);
+   if (__atomic_load_n(&r->waiters, __ATOMIC_SEQ_CST))
+      syscall(SYS_futex, &r->bell, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static inline void shm_wait(struct SHM_RING *r, uint32_t bell) {
+   struct timespec ts = { 0, SHM_WAIT_MS * 1000000L };
+
+   __atomic_add_fetch(&r->waiters, 1, __ATOMIC_SEQ_CST);
+   syscall(SYS_futex, &r->bell, FUTEX_WAIT, bell, &ts, NULL, 0);
+   __atomic_sub_fetch(&r->waiters, 1, __ATOMIC_SEQ_CST);
+}
+
+/* Copy in/out of the ring, wrapping at the end */
+static inline void shm_put(struct SHM_RING *r, uint32_t pos, const void *buf, uint32_t len) {
+   uint32_t off = pos & (SHM_RING_SIZE - 1);
+   uint32_t n = (len < SHM_RING_SIZE - off) ? len : SHM_RING_SIZE - off;
+
+   memcpy(&r->data[off], buf, n);
+   memcpy(&r->data[0], (const uint8_t *) buf + n, len - n);
+}
+
+static inline void shm_get(struct SHM_RING *r, uint32_t pos, void *buf, uint32_t len) {
+   uint32_t off = pos & (SHM_RING_SIZE - 1);
+   uint32_t n = (len < SHM_RING_SIZE - off) ? len : SHM_RING_SIZE - off;
+
+   memcpy(buf, &r->data[off], n);
+   memcpy((uint8_t *) buf + n, &r->data[0], len - n);
+}
+
+/* Send one record gathered from iovcnt pieces, returns len or -1 if the peer is gone */
+static inline int shm_sendv(struct SHM_RING *r, const struct iovec *iov, int iovcnt, uint32_t *peer_up) {
+   uint32_t head, tail, bell, need, pos;
+   int len, i;
+
+   for (len = 0, i = 0; i < iovcnt; i++)
+      len += iov[i].iov_len;
+   need = 4 + ((len + 3) & ~3);
+   if (len <= 0 || need > SHM_RING_SIZE)
+      return -1;
+   head = r->head;
+   for (;;) {
+      bell = __atomic_load_n(&r->bell, __ATOMIC_ACQUIRE);
+      tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+      if (SHM_RING_SIZE - (head - tail) >= need)
+         break;
+      if (!__atomic_load_n(peer_up, __ATOMIC_ACQUIRE))
+         return -1;
+      shm_wait(r, bell);
+   }
+   shm_put(r, head, &len, 4);
+   for (pos = head + 4, i = 0; i < iovcnt; pos += iov[i].iov_len, i++)
+      shm_put(r, pos, iov[i].iov_base, iov[i].iov_len);
+   __atomic_store_n(&r->head, head + need, __ATOMIC_RELEASE);
+   shm_bell(r);
+   return len;
+}
+
+/* Send one record, returns len or -1 if the peer is gone */
+static inline int shm_send(struct SHM_RING *r, const void *buf, int len, uint32_t *peer_up) {
+   struct iovec iov = { (void *) buf, len };
+
+   return shm_sendv(r, &iov, 1, peer_up);
+}
+
+/* Receive up to len bytes of the next record, 0 if the peer is gone */
+static inline int shm_recv(struct SHM_RING *r, void *buf, int len, uint32_t *peer_up) {
+   uint32_t head, tail, bell, reclen, n;
+
+   tail = r->tail;
+   for (;;) {
+      bell = __atomic_load_n(&r->bell, __ATOMIC_ACQUIRE);
+      head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+      if (head != tail)
+         break;
+      if (!__atomic_load_n(peer_up, __ATOMIC_ACQUIRE))
+         return 0;
+      shm_wait(r, bell);
+   }
+   shm_get(r, tail, &reclen, 4);
+   n = reclen - r->part;
+   if (n > (uint32_t) len)
+      n = len;
+   shm_get(r, tail + 4 + r->part, buf, n);
+   if (r->part + n < reclen) {
+      r->part += n;                     // Rest stays for the next recv
+   } else {
+      r->part = 0;
+      __atomic_store_n(&r->tail, tail + 4 + ((reclen + 3) & ~3), __ATOMIC_RELEASE);
+      shm_bell(r);
+   }
+   return n;
+}
+
+/* Empty all rings; only while the other side is not using them */
+static inline void shm_reset(struct SHM_CHAN *ch) {
+   int i;
+
+   for (i = 0; i < 4; i++) {
+      ch->ring[i].head = 0;
+      ch->ring[i].tail = 0;
+      ch->ring[i].part = 0;             // waiters is live, a side may sleep
+   }
+}
+
+#endif
@@ -0,0 +1,80 @@
+/* i3705_sock.h: IBM 3705 TCP socket tuning
+
+   Copyright (c) 2021, Henk Stegeman & Edwin Freekenhorst
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+   ROBERT M SUPNIK BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+   IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+   Except as contained in this notice, the name of Charles E. Owen shall not be
+   used in advertising or otherwise to promote the sale, use or other dealings
+   in this Software without prior written authorization from Charles E. Owen.
+
+   ------------------------------------------------------------------------------
+
+   One place to set the TCP options of every emulator socket: the CA bus,
+   tag and listen sockets, the 3270 client and panel sockets and the
+   metrics listener.  Call sock_tune() on a listen socket before listen()
+   (accepted sockets inherit the buffer sizes, and the window scale is
+   fixed by then) and again on each accepted or connected socket.
+
+   The channel protocol is lock-step with 1 byte acks and status, so Nagle
+   plus delayed ack stalls every CCW; nodelay (the default) sets
+   TCP_NODELAY and TCP_QUICKACK.  The kernel drops QUICKACK again after a
+   while, it only speeds up the start of a connection.
+
+   The options are set with SET CA NODELAY|NONODELAY, SNDBUF=bytes,
+   RCVBUF=bytes and BUSYPOLL=usec (0 = system default / off) and apply
+   to sockets created afterwards.
+*/
+
+#ifndef _I3705_SOCK_H_
+#define _I3705_SOCK_H_
+
+#include <stdio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+struct SOCK_OPT {
+   int nodelay;                         // TCP_NODELAY and TCP_QUICKACK
+   int sndbuf;                          // SO_SNDBUF bytes, 0 = system default
+   int rcvbuf;                          // SO_RCVBUF bytes, 0 = system default
+   int busy_poll;                       // SO_BUSY_POLL usec, 0 = off
+};
+
+extern struct SOCK_OPT sock_opt;
+
+static inline void sock_tune(int fd) {
+   int on = 1;
+
+   if (fd < 0)
+      return;
+   if (sock_opt.nodelay) {
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+      setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &on, sizeof(on));
+   }
+   if (sock_opt.sndbuf && setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sock_opt.sndbuf, sizeof(int)))
+      perror("ERROR: setsockopt(), SO_SNDBUF");
+   if (sock_opt.rcvbuf && setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &sock_opt.rcvbuf, sizeof(int)))
+      perror("ERROR: setsockopt(), SO_RCVBUF");
+#ifdef SO_BUSY_POLL
+   if (sock_opt.busy_poll && setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &sock_opt.busy_poll, sizeof(int)))
+      perror("ERROR: setsockopt(), SO_BUSY_POLL");
+#endif
+}
+
+#endif
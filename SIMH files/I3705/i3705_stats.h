@@ -0,0 +1,137 @@
+/* i3705_stats.h: IBM 3705 performance counters
+
+   Copyright (c) 2021, Henk Stegeman & Edwin Freekenhorst
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+   ROBERT M SUPNIK BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+   IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+   Except as contained in this notice, the name of Charles E. Owen shall not be
+   used in advertising or otherwise to promote the sale, use or other dealings
+   in this Software without prior written authorization from Charles E. Owen.
+
+   ------------------------------------------------------------------------------
+
+   Counters are updated by the CCU, CA, CS and PU threads with relaxed
+   atomics: they are statistics, not synchronisation, so no ordering is
+   needed.  Each counter has a single writer or is only ever incremented,
+   which keeps the cost in the CCU loop to a plain locked add.
+
+   SHOW CPU STATS / SHOW CA STATS / SHOW CS STATS / SHOW PU STATS display
+   them, RESET STATS clears them.  SET METRICS PORT=n serves them over
+   HTTP in Prometheus text format (i3705_metrics.c).
+*/
+
+#ifndef _I3705_STATS_H_
+#define _I3705_STATS_H_
+
+#include <inttypes.h>
+
+#define STAT_INC(c)     __atomic_fetch_add(&(c), 1, __ATOMIC_RELAXED)
+#define STAT_ADD(c, n)  __atomic_fetch_add(&(c), (n), __ATOMIC_RELAXED)
+#define STAT_GET(c)     __atomic_load_n(&(c), __ATOMIC_RELAXED)
+
+/* CCU: index 1-5 is the program level, index 0 of time_ns is wait state */
+struct CPU_STATS {
+   uint64_t instr[6];                  // Instructions executed per level
+   uint64_t entries[6];                // Program level entries
+   uint64_t time_ns[6];                // Time per level, [0] = wait state
+   uint64_t jit_runs;                  // Predecoded blocks entered (SET CPU JIT)
+   uint64_t jit_built;                 // Blocks predecoded
+   uint64_t jit_inval;                 // Watched pages hit by a store
+   uint64_t idle_sleeps;               // Host sleeps in wait state or idle loop (SET CPU IDLE)
+   uint64_t idle_loops;                // Of which for a level 5 idle loop
+   uint64_t timer_ticks;               // Interval timer ticks (i3705_timer.c)
+   uint64_t timer_missed;              // Ticks lost to a late timer thread
+};
+
+/* Channel adapter, one per CA */
+struct CA_STATS {
+   uint64_t ccw[256];                  // CCWs received by command code
+   uint64_t ccw_ns[256];               // CCW to final status time, summed
+   uint64_t bytes_in;                  // Host -> 3705 (Write) data bytes
+   uint64_t bytes_out;                 // 3705 -> host (Read) data bytes
+   uint64_t l3_req;                    // L3 data/status interrupt requests
+   uint64_t attn;                      // Attentions presented to the host
+   uint64_t attn_merged;               // Attentions folded into an outstanding one
+   uint64_t sock_err;                  // Socket errors
+   uint64_t failover;                  // Automatic switches to the other channel port
+};
+
+/* Communication scanner: SDLC frames by type */
+#define CS_FRM_I        0
+#define CS_FRM_RR       1
+#define CS_FRM_RNR      2
+#define CS_FRM_REJ      3
+#define CS_FRM_SNRM     4
+#define CS_FRM_DISC     5
+#define CS_FRM_UA       6
+#define CS_FRM_OTHER    7
+#define CS_FRM_TYPES    8
+
+struct CS_STATS {
+   uint64_t frm_in[CS_FRM_TYPES];      // Frames from the NCP (primary)
+   uint64_t frm_out[CS_FRM_TYPES];     // Frames to the NCP (secondary)
+};
+
+/* Log-linear latency histogram in microseconds, HDR style: values below
+   HIST_SUB get their own bucket, above that every power of two is split
+   in HIST_SUB buckets, so the relative error stays under 1/HIST_SUB.   */
+#define HIST_SUB        4
+#define HIST_BUCKETS    128             // Up to 2**32 us, about 71 minutes
+
+struct LAT_HIST {
+   uint64_t bucket[HIST_BUCKETS];
+   uint64_t count;
+   uint64_t sum_ns;
+   uint64_t max_ns;
+};
+
+/* 3274 / LU's: indexed by LU local address */
+struct PU_STATS {
+   uint64_t piu_in[256];               // PIU's host -> LU
+   uint64_t piu_out[256];              // PIU's LU -> host
+   uint64_t binds[256];                // Sessions started (+BIND)
+   uint64_t unbinds[256];              // Sessions ended (UNBIND)
+   struct LAT_HIST lat_out[256];       // Channel WRITE -> terminal send
+   struct LAT_HIST lat_in[256];        // Terminal read -> channel READ
+   uint64_t sock_err;                  // Terminal socket errors
+};
+
+extern struct CPU_STATS cpu_stats;
+extern struct CA_STATS  ca_stats[2];
+extern struct CS_STATS  cs_stats;
+extern struct PU_STATS  pu_stats;
+extern uint64_t stats_reset_ns;        // Time of last RESET STATS
+extern uint64_t cuc_reset_ns;          // Time of the last OUT X'7A'
+
+extern const char *cs_frm_name[CS_FRM_TYPES];
+
+uint64_t stats_now_ns(void);
+void     stats_lvl_time(int lvl);
+uint64_t cpu_cuc_busy_ns(void);
+void     cpu_cuc_reset(void);
+void     stats_reset(void);
+void     stats_thread(const char *name);
+int      pu_session(uint8_t *lu);
+
+void     hist_record(struct LAT_HIST *h, uint64_t ns);
+uint64_t hist_bucket_us(int b);
+uint64_t hist_percentile_us(struct LAT_HIST *h, double pct);
+void     lat_chan_write(void);
+void     lat_chan_read(void);
+
+#endif
@@ -26,17 +26,26 @@
 */
 
 #include <ctype.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "i3705_defs.h"
+#include "i3705_stats.h"
+#include "i3705_ckpt.h"
 
 extern DEVICE cpu_dev;
+extern DEVICE ca_dev;
+extern DEVICE cs_dev;
+extern DEVICE pu_dev;
+extern DEVICE metrics_dev;
 extern UNIT cpu_unit;
 extern REG cpu_reg[];
 extern FILE *trace;        // DEBUG HJS
 
 extern int32 lvl;
 extern int32 Grp;
-extern int32 GR[8][4];
-extern int8  CL_C[4], CL_Z[4];
+extern int32 GR[4][8];
+extern int32 cc_c(int32 g);
+extern int32 cc_z(int32 g);
 extern int8  test_mode;
 extern int32 Eregs_Inp[128];
 extern int32 Eregs_Out[128];
@@ -44,6 +53,11 @@ extern unsigned char M[];
 extern int32 saved_PC;   
 //extern unsigned char ebcdic_to_ascii[];
 char *parse_addr(char *cptr,  char *gbuf, t_addr *addr, int32 *addrtype);
+char *get_glyph (char *iptr, char *optr, char mchar);
+t_stat reset_cmd (int32 flag, char *cptr);
+extern CTAB *sim_vm_cmd;
+t_stat i3705_reset_cmd (int32 flag, char *cptr);
+void i3705_init (void);
 
 int32 printf_sym (FILE *of, char *strg, t_addr addr, uint32 *val,
     UNIT *uptr, int32 sw);
@@ -69,6 +83,10 @@ REG  *sim_PC = &cpu_reg[0];
 int32 sim_emax = 4;
 DEVICE *sim_devices[] = { 	
      &cpu_dev, 
+     &ca_dev,
+     &cs_dev,
+     &pu_dev,
+     &metrics_dev,
      NULL };
 const char *sim_stop_messages[] = {
     "Unknown error",
@@ -82,6 +100,52 @@ const char *sim_stop_messages[] = {
     "ATTN Card Reader"
 };
 
+/* VM specific commands, searched before the standard SCP commands.
+   RESET STATS clears the performance counters, any other RESET is
+   passed on to SCP.  WARMSTART saves or restores a snapshot of the
+   whole 3705 (i3705_ckpt.c); no standard command starts with W, so
+   the abbreviation does not hide one.
+*/
+
+CTAB i3705_cmd[] = {
+    { "RESET", &i3705_reset_cmd, 0,
+      "r{eset} {ALL|<device>}   reset simulator\n"
+      "r{eset} STATS            reset performance counters\n" },
+    { "WARMSTART", &ckpt_cmd, 0,
+      "w{armstart} SAVE {-Z} <file>  save storage and CCU/CA/CS state\n"
+      "w{armstart} LOAD <file>       restore it, CONT resumes\n" },
+    { NULL }
+};
+
+/* Called on the first cpu_reset, scp.c owns sim_vm_init */
+
+void i3705_init (void) {
+    sim_vm_cmd = i3705_cmd;
+    stats_thread("CPU");
+    stats_reset();
+}
+
+t_stat i3705_reset_cmd (int32 flag, char *cptr) {
+    char gbuf[CBUFSIZE];
+
+    get_glyph (cptr, gbuf, 0);
+    if (strcmp (gbuf, "STATS") == 0) {
+        stats_reset();
+        return SCPE_OK;
+    }
+    return reset_cmd (flag, cptr);
+}
+
+/* Clear all performance counters and restart the measurement interval */
+
+void stats_reset (void) {
+    memset(&cpu_stats, 0, sizeof(cpu_stats));
+    memset(ca_stats, 0, sizeof(ca_stats));
+    memset(&cs_stats, 0, sizeof(cs_stats));
+    memset(&pu_stats, 0, sizeof(pu_stats));
+    stats_reset_ns = stats_now_ns();
+}
+
 /* This is the opcode master defintion table.  Each possible instr mnemonic
    is defined here, with enough information to translate to and from
    symbolic to binary machine code.  
@@ -91,100 +155,230 @@ const char *sim_stop_messages[] = {
 int32 nopcode = 55;
 
 struct opdef optable[55] = {
-//    Mnem   opcode  opmask frm grp  
-    {"B  " , 0xA800, 0xF800, 3, 0},
-    {"BCL" , 0x9800, 0xF800, 3, 0},
-    {"BZL" , 0x8800, 0xF800, 3, 0},
-    {"BCT" , 0xB880, 0xF880,10, 0},
-    {"BB " , 0xC800, 0xF800, 6, 0},
-    {"BB " , 0xD800, 0xF800, 6, 0},
-    {"BB " , 0xE800, 0xF800, 6, 0},
-    {"BB " , 0xF800, 0xF800, 6, 0},
-
-    {"LRI" , 0x8000, 0xF800, 2, 0},
-    {"ARI" , 0x9000, 0xF800, 2, 0},
-    {"SRI" , 0xA000, 0xF800, 2, 0},
-    {"CRI" , 0xB000, 0xF800, 2, 0},
-    {"XRI" , 0xC000, 0xF800, 2, 0},
-    {"ORI" , 0xD000, 0xF800, 2, 0},
-    {"NRI" , 0xE000, 0xF800, 2, 0},
-    {"TRM" , 0xF000, 0xF800, 2, 0},
-
-    {"LCR" , 0x0008, 0x88FF, 1, 0},
-    {"ACR" , 0x0018, 0x88FF, 1, 0},
-    {"SCR" , 0x0028, 0x88FF, 1, 0},
-    {"CCR" , 0x0038, 0x88FF, 1, 0},
-    {"XCR" , 0x0048, 0x88FF, 1, 0},
-    {"OCR" , 0x0058, 0x88FF, 1, 0},
-    {"NCR" , 0x0068, 0x88FF, 1, 0},
-    {"LCOR", 0x0078, 0x88FF, 1, 0},
-
-    {"ICT" , 0x0010, 0x88FF, 5, 0},
-    {"STCT", 0x0030, 0x88FF, 5, 0},
-    {"IC " , 0x0800, 0x8880, 5, 1},
-    {"STC" , 0x0880, 0x8880, 5, 1},
-
-    {"LH " , 0x0001, 0x8881, 7, 0},
-    {"STH" , 0x0081, 0x8881, 7, 0},
-    {"L  " , 0x0002, 0x8883, 7, 1},
-    {"ST " , 0x0082, 0x8883, 7, 1},
-
-    {"LHR" , 0x0080, 0x88FF, 0, 0},
-    {"AHR" , 0x0090, 0x88FF, 0, 0},
-    {"SHR" , 0x00A0, 0x88FF, 0, 0},
-    {"CHR" , 0x00B0, 0x88FF, 0, 0},
-    {"XHR" , 0x00C0, 0x88FF, 0, 0},
-    {"OHR" , 0x00D0, 0x88FF, 0, 0},
-    {"NHR" , 0x00E0, 0x88FF, 0, 0},
-    {"LHOR", 0x00F0, 0x88FF, 0, 0},
-    {"LR " , 0x0088, 0x88FF, 0, 0},
-    {"AR " , 0x0098, 0x88FF, 0, 0},
-    {"SR " , 0x00A8, 0x88FF, 0, 0},
-    {"CR " , 0x00B8, 0x88FF, 0, 0},
-    {"XR " , 0x00C8, 0x88FF, 0, 0},
-    {"OR " , 0x00D8, 0x88FF, 0, 0},
-    {"NR " , 0x00E8, 0x88FF, 0, 0},
-    {"LOR" , 0x00F8, 0x88FF, 0, 0},
-    {"BALR", 0x0040, 0x88FF, 0, 0},
-
-    {"IN " , 0x000C, 0x880F, 8, 1},
-    {"OUT" , 0x0004, 0x880F, 8, 0},
-
-    {"BAL" , 0xB800, 0xF8F0, 4, 0},
-    {"LA " , 0xB820, 0xF8F0, 4, 0},
-
-    {"EXIT", 0xB840, 0xFFFF, 9, 0},
-
-    {"INV",  0x0000, 0xFFFF,11, 0}   
+//    Mnem   opcode  opmask frm grp handler
+    {"B  " , 0xA800, 0xF800, 3, 0, OP_B},
+    {"BCL" , 0x9800, 0xF800, 3, 0, OP_BCL},
+    {"BZL" , 0x8800, 0xF800, 3, 0, OP_BZL},
+    {"BCT" , 0xB880, 0xF880,10, 0, OP_BCT},
+    {"BB " , 0xC800, 0xF800, 6, 0, OP_BB},
+    {"BB " , 0xD800, 0xF800, 6, 0, OP_BB},
+    {"BB " , 0xE800, 0xF800, 6, 0, OP_BB},
+    {"BB " , 0xF800, 0xF800, 6, 0, OP_BB},
+
+    {"LRI" , 0x8000, 0xF800, 2, 0, OP_LRI},
+    {"ARI" , 0x9000, 0xF800, 2, 0, OP_ARI},
+    {"SRI" , 0xA000, 0xF800, 2, 0, OP_SRI},
+    {"CRI" , 0xB000, 0xF800, 2, 0, OP_CRI},
+    {"XRI" , 0xC000, 0xF800, 2, 0, OP_XRI},
+    {"ORI" , 0xD000, 0xF800, 2, 0, OP_ORI},
+    {"NRI" , 0xE000, 0xF800, 2, 0, OP_NRI},
+    {"TRM" , 0xF000, 0xF800, 2, 0, OP_TRM},
+
+    {"LCR" , 0x0008, 0x88FF, 1, 0, OP_LCR},
+    {"ACR" , 0x0018, 0x88FF, 1, 0, OP_ACR},
+    {"SCR" , 0x0028, 0x88FF, 1, 0, OP_SCR},
+    {"CCR" , 0x0038, 0x88FF, 1, 0, OP_CCR},
+    {"XCR" , 0x0048, 0x88FF, 1, 0, OP_XCR},
+    {"OCR" , 0x0058, 0x88FF, 1, 0, OP_OCR},
+    {"NCR" , 0x0068, 0x88FF, 1, 0, OP_NCR},
+    {"LCOR", 0x0078, 0x88FF, 1, 0, OP_LCOR},
+
+    {"ICT" , 0x0010, 0x88FF, 5, 0, OP_ICT},
+    {"STCT", 0x0030, 0x88FF, 5, 0, OP_STCT},
+    {"IC " , 0x0800, 0x8880, 5, 1, OP_IC},
+    {"STC" , 0x0880, 0x8880, 5, 1, OP_STC},
+
+    {"LH " , 0x0001, 0x8881, 7, 0, OP_LH},
+    {"STH" , 0x0081, 0x8881, 7, 0, OP_STH},
+    {"L  " , 0x0002, 0x8883, 7, 1, OP_L},
+    {"ST " , 0x0082, 0x8883, 7, 1, OP_ST},
+
+    {"LHR" , 0x0080, 0x88FF, 0, 0, OP_LHR},
+    {"AHR" , 0x0090, 0x88FF, 0, 0, OP_AHR},
+    {"SHR" , 0x00A0, 0x88FF, 0, 0, OP_SHR},
+    {"CHR" , 0x00B0, 0x88FF, 0, 0, OP_CHR},
+    {"XHR" , 0x00C0, 0x88FF, 0, 0, OP_XHR},
+    {"OHR" , 0x00D0, 0x88FF, 0, 0, OP_OHR},
+    {"NHR" , 0x00E0, 0x88FF, 0, 0, OP_NHR},
+    {"LHOR", 0x00F0, 0x88FF, 0, 0, OP_LHOR},
+    {"LR " , 0x0088, 0x88FF, 0, 0, OP_LR},
+    {"AR " , 0x0098, 0x88FF, 0, 0, OP_AR},
+    {"SR " , 0x00A8, 0x88FF, 0, 0, OP_SR},
+    {"CR " , 0x00B8, 0x88FF, 0, 0, OP_CR},
+    {"XR " , 0x00C8, 0x88FF, 0, 0, OP_XR},
+    {"OR " , 0x00D8, 0x88FF, 0, 0, OP_OR},
+    {"NR " , 0x00E8, 0x88FF, 0, 0, OP_NR},
+    {"LOR" , 0x00F8, 0x88FF, 0, 0, OP_LOR},
+    {"BALR", 0x0040, 0x88FF, 0, 0, OP_BALR},
+
+    {"IN " , 0x000C, 0x880F, 8, 1, OP_IN},
+    {"OUT" , 0x0004, 0x880F, 8, 0, OP_OUT},
+
+    {"BAL" , 0xB800, 0xF8F0, 4, 0, OP_BAL},
+    {"LA " , 0xB820, 0xF8F0, 4, 0, OP_LA},
+
+    {"EXIT", 0xB840, 0xFFFF, 9, 0, OP_EXIT},
+
+    {"INV",  0x0000, 0xFFFF,11, 0, OP_INV}   
 };
 
-/* This is the binary loader.  The input file is considered to be
-   a string of literal bytes with no special format. The
-   load starts at the addr specified in the TXT record.
+/* This is the binary loader.
+
+   LOAD accepts two formats:
+   - an object deck: 80 byte card images, TXT/ESD/RLD/END records with
+     the 24 bit address in columns 6-8 and the byte count in columns
+     11-12.  The deck is mapped into memory, every record is validated
+     and each TXT run is copied into M[] with one memcpy.
+   - a storage image written by DUMP: an IMG_MAGIC header with the start
+     address and length, followed by the storage bytes, which is read
+     into M[] with a single fread.
+
+   DUMP writes the storage range filled by the last deck load (or all of
+   storage up to the last non-zero byte) as such an image, so that a
+   large NCP gen loads in one read the next time.
+
+   The deck is expected to be link edited for its load address, so the
+   RLD items are validated and counted but no relocation is applied.
 */
 
+#define IMG_MAGIC   "I3705IMG"                        /* Image file header */
+#define IMG_HDRLEN  16                                /* Magic + addr + len */
+
+static int32 load_lo = -1, load_hi = -1;              /* Range of last deck load */
+
+static uint32 get_be (uint8 *p, int n) {
+   uint32 v = 0;
+
+   while (n--)
+      v = (v << 8) | *p++;
+   return v;
+}
+
+static void put_be (uint8 *p, uint32 v, int n) {
+   while (n--) {
+      p[n] = v & 0xFF;
+      v >>= 8;
+   }
+}
+
+static t_stat dump_image (FILE *fileref) {
+   uint8 hdr[IMG_HDRLEN];
+   int32 lo, hi;
+
+   if (load_lo >= 0) {
+      lo = load_lo;
+      hi = load_hi;
+   } else {
+      lo = 0;
+      for (hi = MEMSIZE - 1; hi > 0 && M[hi] == 0; hi--) ;
+   }
+   memcpy(hdr, IMG_MAGIC, 8);
+   put_be(&hdr[8], lo, 4);
+   put_be(&hdr[12], hi - lo + 1, 4);
+   if (fwrite(hdr, 1, IMG_HDRLEN, fileref) != IMG_HDRLEN ||
+       fwrite(&M[lo], 1, hi - lo + 1, fileref) != (size_t)(hi - lo + 1))
+      return SCPE_IOERR;
+   printf ("%d Bytes dumped from loc %05X to %05X.\n", hi - lo + 1, lo, hi);
+   return SCPE_OK;
+}
+
+static t_stat load_image (FILE *fileref, uint8 *hdr) {
+   uint32 addr, len;
+
+   addr = get_be(&hdr[8], 4);
+   len  = get_be(&hdr[12], 4);
+   if (len == 0 || addr >= MEMSIZE || len > MEMSIZE - addr)   /* No uint32 wrap */
+      return SCPE_FMT;
+   if (fseek(fileref, IMG_HDRLEN, SEEK_SET) != 0 ||
+       fread(&M[addr], 1, len, fileref) != len)
+      return SCPE_IOERR;
+   printf ("%d Bytes loaded from image. Last byte stored at loc %05X.\n", len, addr + len - 1);
+   return SCPE_OK;
+}
+
 t_stat sim_load (FILE *fileref, char *cptr, char *fnam, int flag) {
-   int32 i, j, addr = 0x0000, cnt = 0;
-
-   if ((*cptr != 0) || (flag != 0)) return SCPE_ARG;
-   addr = 0x0000;
-   i = 0;
-
-   while (fread(&buff, 1, 80, fileref) == 80) {
-      if (buff[2] == 0xE7) {                          /* TXT record ? */
-         cnt = buff[11];                              /* Get byte count */
-         addr = (buff[6] << 8) | buff[7];             /* Get address to store */
-         for (j = cnt; j > 0; j--) {
-            M[addr] = buff[16 + (cnt - j) ];          /* Store it */
-            addr++;
-            i++;                                      /* Bump byte count */
+   struct stat st;
+   uint8 *deck, *rec;
+   int32 nrec, r, nbytes = 0, nesd = 0, nrld = 0, entry = -1;
+   uint32 addr, cnt, lo = MAXMEMSIZE, hi = 0, ip, same;
+
+   if (*cptr != 0) return SCPE_ARG;
+   if (flag != 0)                                     /* DUMP */
+      return dump_image(fileref);
+
+   if (fstat(fileno(fileref), &st) != 0 || st.st_size < IMG_HDRLEN)
+      return SCPE_FMT;
+   deck = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(fileref), 0);
+   if (deck == MAP_FAILED)
+      return SCPE_IOERR;
+   if (memcmp(deck, IMG_MAGIC, 8) == 0) {             /* Image from DUMP ? */
+      r = load_image(fileref, deck);
+      munmap(deck, st.st_size);
+      return r;
+   }
+
+   nrec = st.st_size / 80;
+   for (r = 0; r < nrec; r++) {
+      rec = deck + r * 80;
+      if (rec[0] != 0x02)                             /* Not an object record */
+         continue;
+      if (memcmp(&rec[1], "\xE3\xE7\xE3", 3) == 0) {  /* TXT */
+         addr = get_be(&rec[5], 3);
+         cnt  = get_be(&rec[10], 2);
+         if (cnt > 56 || addr + cnt > MEMSIZE) {
+            printf ("Invalid TXT record %d: addr %06X count %d\n", r + 1, addr, cnt);
+            munmap(deck, st.st_size);
+            return SCPE_FMT;
          }
-      } else {
-         continue;                                    /* Next record please */
+         memcpy(&M[addr], &rec[16], cnt);
+         nbytes += cnt;
+         if (cnt && addr < lo) lo = addr;
+         if (cnt && addr + cnt - 1 > hi) hi = addr + cnt - 1;
+      } else if (memcmp(&rec[1], "\xC5\xE2\xC4", 3) == 0) {  /* ESD */
+         cnt = get_be(&rec[10], 2);
+         if (cnt > 48 || cnt % 16) {
+            printf ("Invalid ESD record %d: count %d\n", r + 1, cnt);
+            munmap(deck, st.st_size);
+            return SCPE_FMT;
+         }
+         nesd += cnt / 16;
+      } else if (memcmp(&rec[1], "\xD9\xD3\xC4", 3) == 0) {  /* RLD */
+         cnt = get_be(&rec[10], 2);
+         if (cnt > 56) {
+            printf ("Invalid RLD record %d: count %d\n", r + 1, cnt);
+            munmap(deck, st.st_size);
+            return SCPE_FMT;
+         }
+         /* Items: R/P ESDID pair, then flag + 3 byte address; a set
+            'same' flag bit means the next item omits the ESDID pair. */
+         for (ip = 0, same = 0; ip < cnt; nrld++) {
+            if (!same)
+               ip += 4;
+            if (ip + 4 > cnt) {
+               printf ("Invalid RLD record %d: truncated item\n", r + 1);
+               munmap(deck, st.st_size);
+               return SCPE_FMT;
+            }
+            same = rec[16 + ip] & 0x01;
+            ip += 4;
+         }
+      } else if (memcmp(&rec[1], "\xC5\xD5\xC4", 3) == 0) {  /* END */
+         if (get_be(&rec[5], 3) != 0x404040)          /* Entry point given ? */
+            entry = get_be(&rec[5], 3);
+         break;
       }
    }
+   munmap(deck, st.st_size);
+
+   if (nbytes) {
+      load_lo = lo;
+      load_hi = hi;
+   }
    printf("\n\r");
-   printf ("%d Bytes loaded. Last byte stored at loc %05X.\n", i, addr-1);
+   printf ("%d Bytes loaded from %d records (%d ESD, %d RLD items). Range %05X-%05X.\n",
+           nbytes, nrec, nesd, nrld, (nbytes) ? lo : 0, hi);
+   if (entry >= 0)
+      printf ("Entry point %05X.\n", entry);
    return (SCPE_OK);
 }
 
@@ -334,11 +528,11 @@ switch (optable[i].form) {
       else
          Nfld = 'H';
       if (optable[i].group == 0) {     // No displacement instr.
-         sprintf(bldaddr, " R%01X(%1c),B=R%01X  [0x%04X] ", Rfld, Nfld, Bfld, GR[Bfld][Grp]);
+         sprintf(bldaddr, " R%01X(%1c),B=R%01X  [0x%04X] ", Rfld, Nfld, Bfld, GR[Grp][Bfld]);
       } else {
          if (Bfld > 0)  
             sprintf(bldaddr, " R%01X(%1c),D=%02d(B=R%01X)  [0x%02X]+[0x%04X] ", 
-                    Rfld, Nfld, Dfld, Bfld, Dfld, GR[Bfld][Grp] );
+                    Rfld, Nfld, Dfld, Bfld, Dfld, GR[Grp][Bfld] );
          else
             sprintf(bldaddr, " R%01X(%1c),D=%02d(B=R%01X)  [0x%02X]+[0x%04X] ", 
                     Rfld, Nfld, Dfld, Bfld, Dfld, 0x0680 );
@@ -364,14 +558,14 @@ switch (optable[i].form) {
       if (optable[i].group == 0) {     // LH / STH with 6 bits displacement
          if (Bfld > 0)
             sprintf(bldaddr, " R%01X,(D=%02d)B=R%01X  [0x%02X]+[0x%04X] ", 
-                    Rfld, Dfld, Bfld, Dfld & 0x7E, GR[Bfld][Grp]);
+                    Rfld, Dfld, Bfld, Dfld & 0x7E, GR[Grp][Bfld]);
          else
             sprintf(bldaddr, " R%01X,(D=%02d)B=R%01X  [0x%02X]+[0x%04X] ", 
                     Rfld, Dfld, Bfld, Dfld & 0x7E, 0x0700);
       } else {                         // L / ST with 5 bits displacement 
          if (Bfld > 0)
             sprintf(bldaddr, " R%01X,(D=%02d)B=R%01X  [0x%02X]+[0x%05X] ", 
-                    Rfld, Dfld, Bfld, Dfld & 0x7C, GR[Bfld][Grp]);
+                    Rfld, Dfld, Bfld, Dfld & 0x7C, GR[Grp][Bfld]);
          else 
             sprintf(bldaddr, " R%01X,(D=%02d)B=R%01X  [0x%02X]+[0x%05X] ", 
                     Rfld, Dfld, Bfld, Dfld & 0x7C, 0x0780);
@@ -381,14 +575,14 @@ switch (optable[i].form) {
       Efld = (val[0] & 0x70) | (val[1] >> 4);
       Rfld = (val[0] & 0x07);
       if (Efld < 0x20) 
-         sprintf(bldaddr, " R%01X,E=%02X --- [0x%04X]", Rfld, Efld, GR[Efld & 0x07][Efld >> 3]); 
+         sprintf(bldaddr, " R%01X,E=%02X --- [0x%04X]", Rfld, Efld, GR[Efld >> 3][Efld & 0x07]); 
       else {   // 0x20 - 0x7F
          if (optable[i].group == 1) {        // Input instruction ?  
             sprintf(bldaddr, " R%01X,E=%02X <-  [0x%04X] ", Rfld, Efld, Eregs_Inp[Efld]);
          } else {                            // Output instruction ? 
-            sprintf(bldaddr, " R%01X,E=%02X  -> [0x%04X] ", Rfld, Efld, GR[Rfld][Grp]);
+            sprintf(bldaddr, " R%01X,E=%02X  -> [0x%04X] ", Rfld, Efld, GR[Grp][Rfld]);
             if (Efld == 0x45)    // DEBUG HJS 
-               fprintf(trace, ">>> OUT  R%01X,E=%02X  -> [0x%04X] ", Rfld, Efld, GR[Rfld][Grp]);
+               fprintf(trace, ">>> OUT  R%01X,E=%02X  -> [0x%04X] ", Rfld, Efld, GR[Grp][Rfld]);
          }
       }
       break;
@@ -414,9 +608,9 @@ switch (optable[i].form) {
 
 sprintf(bldregs, "Lvl=%d Grp=%d | %05X %05X %05X %05X  %05X %05X %05X %05X | C=%d Z=%d T=%d",
         lvl, Grp,
-        GR[0][Grp], GR[1][Grp], GR[2][Grp], GR[3][Grp],
-        GR[4][Grp], GR[5][Grp], GR[6][Grp], GR[7][Grp],
-        CL_C[Grp], CL_Z[Grp], test_mode);
+        GR[Grp][0], GR[Grp][1], GR[Grp][2], GR[Grp][3],
+        GR[Grp][4], GR[Grp][5], GR[Grp][6], GR[Grp][7],
+        cc_c(Grp), cc_z(Grp), test_mode);
 
 sprintf(strg, "%s%s\n%s", bld, bldaddr, bldregs);
 }
@@ -0,0 +1,166 @@
+/* i3705_timer.c: IBM 3705 interval timer
+
+   Copyright (c) 2021, Henk Stegeman & Edwin Freekenhorst
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+   ROBERT M SUPNIK BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+   IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+   Except as contained in this notice, the name of Charles E. Owen shall not be
+   used in advertising or otherwise to promote the sale, use or other dealings
+   in this Software without prior written authorization from Charles E. Owen.
+
+   ------------------------------------------------------------------------------
+
+   The 100 msec interval timer (X'7F' bit X'0004', L3) runs on its own
+   thread, blocked on a CLOCK_MONOTONIC timerfd.  The timerfd keeps
+   absolute deadlines, so the ticks do not drift under load, and a read
+   returns how many expired: ticks that could not be delivered in time
+   are counted, not queued, as a 3705 has only the one request latch.
+   The request is posted under r7f_lock and cpu_wake(), like the other
+   interrupt sources, so no signal reaches the CA and CS threads.
+
+   SET CPU TIMER=n sets the host msec per 3705 tick, 100 by default:
+   50 runs the NCP clock twice as fast, 200 at half speed.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include "i3705_defs.h"
+#include "i3705_stats.h"
+
+#define TIMER_MS_DFLT   100            // 3705 interval timer period
+#define TIMER_MS_MAX    10000
+
+extern int32 Eregs_Inp[];
+extern int8  timer_req_L3;
+extern int8  test_mode;
+extern pthread_mutex_t r7f_lock;
+extern void  cpu_wake(void);
+
+t_value get_uint (char *cptr, uint32 radix, t_value max, t_stat *status);
+
+static int32 timer_ms = TIMER_MS_DFLT; // Host msec per tick
+static int   timer_fd = -1;
+static pthread_t timer_tid;
+
+void  *TMR_thread(void *arg);
+t_stat timer_set (UNIT *uptr, int32 val, char *cptr, void *desc);
+t_stat timer_show (FILE *st, UNIT *uptr, int32 val, void *desc);
+
+
+/*-------------------------------------------------------------------*/
+/* (Re)arm the timerfd: first expiry one period from now             */
+/*-------------------------------------------------------------------*/
+static int timer_arm(void) {
+   struct itimerspec its;
+
+   its.it_interval.tv_sec  = timer_ms / 1000;
+   its.it_interval.tv_nsec = (timer_ms % 1000) * 1000000L;
+   its.it_value = its.it_interval;
+   return timerfd_settime(timer_fd, 0, &its, NULL);
+}
+
+/*-------------------------------------------------------------------*/
+/* Start the timer thread, once                                      */
+/*-------------------------------------------------------------------*/
+int timer_start(void) {
+   if (timer_fd >= 0)
+      return 0;
+   timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+   if (timer_fd < 0 || timer_arm() < 0) {
+      fprintf(stderr, "TMR: Cannot create interval timer: %s\n\r", strerror(errno));
+      return -1;
+   }
+   if (pthread_create(&timer_tid, NULL, TMR_thread, NULL) != 0) {
+      fprintf(stderr, "TMR: Cannot start timer thread: %s\n\r", strerror(errno));
+      close(timer_fd);
+      timer_fd = -1;
+      return -1;
+   }
+   return 0;
+}
+
+/*-------------------------------------------------------------------*/
+/* One tick: set the L3 interval timer request unless still pending  */
+/*-------------------------------------------------------------------*/
+static void timer_tick(void) {
+   int post = 0;
+
+   if (test_mode != OFF)
+      return;
+   pthread_mutex_lock(&r7f_lock);
+   if (!(Eregs_Inp[0x7F] & 0x0004)) {
+      Eregs_Inp[0x7F] |= 0x0004;
+      timer_req_L3 = ON;
+      post = 1;
+   }
+   pthread_mutex_unlock(&r7f_lock);
+   if (post)
+      cpu_wake();
+}
+
+void *TMR_thread(void *arg) {
+   uint64_t exp;
+   ssize_t  n;
+
+   fprintf(stderr, "TMR: Thread %ld started succesfully... \n\r", syscall(SYS_gettid));
+   stats_thread("TMR");
+
+   while (1) {
+      n = read(timer_fd, &exp, sizeof(exp));   // Blocks until the next deadline
+      if (n != sizeof(exp)) {
+         if (n < 0 && errno == EINTR)
+            continue;
+         fprintf(stderr, "TMR: Timer read failed: %s\n\r", strerror(errno));
+         return NULL;
+      }
+      STAT_INC(cpu_stats.timer_ticks);
+      if (exp > 1)                             // Late: the rest is lost
+         STAT_ADD(cpu_stats.timer_missed, exp - 1);
+      timer_tick();
+   }
+}
+
+/*-------------------------------------------------------------------*/
+/* SET CPU TIMER=n, SHOW CPU TIMER                                   */
+/*-------------------------------------------------------------------*/
+t_stat timer_set (UNIT *uptr, int32 val, char *cptr, void *desc) {
+   t_stat r;
+   int32  ms;
+
+   if (cptr == NULL)
+      return SCPE_ARG;
+   ms = (int32) get_uint (cptr, 10, TIMER_MS_MAX, &r);
+   if (r != SCPE_OK)
+      return r;
+   if (ms == 0)
+      return SCPE_ARG;
+   timer_ms = ms;
+   if ((timer_fd >= 0) && (timer_arm() < 0))
+      return SCPE_IERR;
+   return SCPE_OK;
+}
+
+t_stat timer_show (FILE *st, UNIT *uptr, int32 val, void *desc) {
+   fprintf(st, "TIMER=%dms", timer_ms);
+   return SCPE_OK;
+}